@@ -1,4 +1,54 @@
 #include "QuantalAudio.hpp"
+#include "core/Simd.hpp"
+
+using quantal::float4;
+
+/**
+ * Which channels of its input an output copies, and in what order
+ */
+struct MultRoute {
+    // First input channel copied, from 0
+    int first = 0;
+    // Number of channels copied; 0 for all of them from `first` on, or as
+    // many as the input has when mapped
+    int count = 0;
+    // Copy the channels last to first
+    bool reverse = false;
+
+    // Copy each output channel from the input channel in `sources` rather
+    // than from the range above
+    bool mapped = false;
+    int sources[16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+
+    /**
+     * Start a map from the channels the range copies, so editing one
+     * channel leaves the others where they were
+     */
+    void mapRange() {
+        const int channels = (count > 0) ? std::min(count, 16 - first) : 16 - first;
+        for (int c = 0; c < 16; c++) {
+            const int offset = (c < channels && reverse) ? channels - 1 - c : c;
+            sources[c] = std::min(first + offset, 15);
+        }
+        mapped = true;
+    }
+};
+
+/**
+ * One patched output's copy, worked out when the patching or routing
+ * changes
+ */
+struct MultCopy {
+    int output = 0;
+    int input = 0;
+    int channels = 0;
+    // Input channel for each output channel
+    int sources[16] = {};
+    // The sources run on from sources[0], so they copy as whole float4s up
+    // to `vectorEnd` and one by one after that
+    bool contiguous = false;
+    int vectorEnd = 0;
+};
 
 struct BufferedMult : Module {
     enum ParamIds {
@@ -17,6 +67,15 @@ struct BufferedMult : Module {
         NUM_LIGHTS
     };
 
+    MultRoute routes[6];
+    // Set from the menu when a route is edited, so the copy plan is rebuilt
+    std::atomic<bool> routesChanged{true};
+
+    // Copies for the patched outputs, and the patching they were made for
+    MultCopy plan[6];
+    int planSize = 0;
+    int planKey = -1;
+
     BufferedMult() {
         config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
         configSwitch(CONNECT_PARAM, 0.0f, 1.0f, 1.0f, "connect mode", {"Group All (2:6)", "Groups A, B (1:3 x 2)"});
@@ -32,28 +91,140 @@ struct BufferedMult : Module {
         configOutput(CH_OUTPUT + 5, "B3");
     }
 
+    json_t* dataToJson() override {
+        json_t* rootJ = json_object();
+
+        json_t* routesJ = json_array();
+        for (const MultRoute &route : routes) {
+            json_t* routeJ = json_object();
+            json_object_set_new(routeJ, "first", json_integer(route.first));
+            json_object_set_new(routeJ, "count", json_integer(route.count));
+            json_object_set_new(routeJ, "reverse", json_boolean(route.reverse));
+            if (route.mapped) {
+                json_t* sourcesJ = json_array();
+                for (int c = 0; c < 16; c++) {
+                    json_array_append_new(sourcesJ, json_integer(route.sources[c]));
+                }
+                json_object_set_new(routeJ, "sources", sourcesJ);
+            }
+            json_array_append_new(routesJ, routeJ);
+        }
+        json_object_set_new(rootJ, "routes", routesJ);
+
+        return rootJ;
+    }
+
+    void dataFromJson(json_t* rootJ) override {
+        // routes, one per output
+        const json_t* routesJ = json_object_get(rootJ, "routes");
+        if (json_is_array(routesJ)) {
+            for (int i = 0; i < 6 && i < static_cast<int>(json_array_size(routesJ)); i++) {
+                const json_t* routeJ = json_array_get(routesJ, i);
+                routes[i].first = clamp(static_cast<int>(json_integer_value(json_object_get(routeJ, "first"))), 0, 15);
+                routes[i].count = clamp(static_cast<int>(json_integer_value(json_object_get(routeJ, "count"))), 0, 16);
+                routes[i].reverse = json_is_true(json_object_get(routeJ, "reverse"));
+
+                const json_t* sourcesJ = json_object_get(routeJ, "sources");
+                routes[i].mapped = json_is_array(sourcesJ);
+                for (int c = 0; c < 16 && c < static_cast<int>(json_array_size(sourcesJ)); c++) {
+                    routes[i].sources[c] = clamp(static_cast<int>(json_integer_value(json_array_get(sourcesJ, c))), 0, 15);
+                }
+            }
+        }
+        routesChanged = true;
+    }
+
+    /**
+     * When user resets this module
+     */
+    void onReset() override {
+        for (MultRoute &route : routes) {
+            route = MultRoute();
+        }
+        routesChanged = true;
+    }
+
+    /**
+     * Work out the copies for the patched outputs, and set their channel
+     * counts, which only change along with the plan
+     */
+    void buildPlan(bool unconnect) {
+        planSize = 0;
+        for (int i = 0; i < 6; i++) {
+            Output &output = outputs[CH_OUTPUT + i];
+            if (!output.isConnected()) {
+                continue;
+            }
+
+            // Outputs 3 4 5 copy input 1, or input 0 when grouped
+            MultCopy &copy = plan[planSize];
+            copy.output = CH_OUTPUT + i;
+            copy.input = (i >= 3 && unconnect) ? CH_INPUT + 1 : CH_INPUT + 0;
+
+            const MultRoute &route = routes[i];
+            const int inputChannels = inputs[copy.input].getChannels();
+            if (inputChannels == 0) {
+                // Unpatched input: one channel of 0V
+                output.setVoltage(0.f);
+                output.setChannels(1);
+                continue;
+            }
+            // Channels above the input's count read as 0V, as Rack clears them
+            if (route.mapped) {
+                copy.channels = (route.count > 0) ? route.count : inputChannels;
+                std::copy(route.sources, route.sources + copy.channels, copy.sources);
+            } else {
+                copy.channels = (route.count > 0) ? route.count : std::max(inputChannels - route.first, 1);
+                copy.channels = std::min(copy.channels, 16 - route.first);
+                for (int c = 0; c < copy.channels; c++) {
+                    copy.sources[c] = route.first + (route.reverse ? copy.channels - 1 - c : c);
+                }
+            }
+            copy.contiguous = true;
+            for (int c = 1; c < copy.channels; c++) {
+                copy.contiguous = copy.contiguous && copy.sources[c] == copy.sources[0] + c;
+            }
+            // Whole float4s, without reading past the input's 16 channels
+            copy.vectorEnd = std::min((copy.channels + 3) & ~3, (16 - copy.sources[0]) & ~3);
+
+            output.setChannels(copy.channels);
+            planSize++;
+        }
+    }
+
     void process(const ProcessArgs &args) override {
         bool unconnect = (params[CONNECT_PARAM].getValue() > 0.0f);
 
-        // Input 0 -> Outputs 0 1 2
-        float signals[16] = {};
-        inputs[CH_INPUT + 0].readVoltages(signals);
-        int channels = inputs[CH_INPUT + 0].getChannels();
-        for (int i = 0; i <= 2; i++) {
-            outputs[CH_OUTPUT + i].setChannels(channels);
-            outputs[CH_OUTPUT + i].writeVoltages(signals);
+        // Everything the plan depends on except the routes themselves
+        int key = unconnect;
+        for (int i = 0; i < 6; i++) {
+            key |= outputs[CH_OUTPUT + i].isConnected() << (1 + i);
         }
-
-        // Input 1 -> Outputs 3 4 5
-        // otherwise Outputs 3 4 5 is copy of Input 0
-        if (unconnect) {
-            inputs[CH_INPUT + 1].readVoltages(signals);
-            channels = inputs[CH_INPUT + 1].getChannels();
+        key |= inputs[CH_INPUT + 0].getChannels() << 7;
+        key |= inputs[CH_INPUT + 1].getChannels() << 12;
+        if (routesChanged.exchange(false) || key != planKey) {
+            planKey = key;
+            buildPlan(unconnect);
         }
 
-        for (int i = 3; i <= 5; i++) {
-            outputs[CH_OUTPUT + i].setChannels(channels);
-            outputs[CH_OUTPUT + i].writeVoltages(signals);
+        for (int p = 0; p < planSize; p++) {
+            const MultCopy &copy = plan[p];
+            const float* in = inputs[copy.input].getVoltages();
+            float* out = outputs[copy.output].getVoltages();
+            if (copy.contiguous) {
+                const float* from = in + copy.sources[0];
+                int c = 0;
+                for (; c < copy.vectorEnd; c += 4) {
+                    float4::load(from + c).store(out + c);
+                }
+                for (; c < copy.channels; c++) {
+                    out[c] = from[c];
+                }
+            } else {
+                for (int c = 0; c < copy.channels; c++) {
+                    out[c] = in[copy.sources[c]];
+                }
+            }
         }
     }
 };
@@ -87,6 +258,91 @@ struct BufferedMultWidget : ModuleWidget {
         addOutput(createOutput<ThemedPJ301MPort>(Vec(RACK_GRID_WIDTH - 12.5f, 292.0), module, BufferedMult::CH_OUTPUT + 4));
         addOutput(createOutput<ThemedPJ301MPort>(Vec(RACK_GRID_WIDTH - 12.5f, 320.0), module, BufferedMult::CH_OUTPUT + 5));
     }
+
+    void appendContextMenu(Menu *menu) override {
+        BufferedMult* module = getModule<BufferedMult>();
+
+        std::vector<std::string> firstLabels;
+        std::vector<std::string> countLabels = {"All"};
+        for (int c = 1; c <= 16; c++) {
+            firstLabels.push_back(string::f("%d", c));
+            countLabels.push_back(string::f("%d", c));
+        }
+
+        menu->addChild(new MenuSeparator);
+        menu->addChild(createMenuLabel("Output channels"));
+        for (int i = 0; i < 6; i++) {
+            MultRoute* route = &module->routes[i];
+
+            // e.g. "All", "From 3", "3-6, reversed" or "4 mapped"
+            std::string summary = "All";
+            if (route->mapped) {
+                summary = (route->count > 0) ? string::f("%d mapped", route->count) : "All mapped";
+            } else if (route->count > 0) {
+                summary = string::f("%d-%d", route->first + 1, std::min(route->first + route->count, 16));
+            } else if (route->first > 0) {
+                summary = string::f("From %d", route->first + 1);
+            }
+            if (route->reverse && !route->mapped) {
+                summary += ", reversed";
+            }
+
+            menu->addChild(createSubmenuItem(module->outputInfos[BufferedMult::CH_OUTPUT + i]->name, summary, [ = ](Menu * menu) {
+                menu->addChild(createIndexSubmenuItem("First channel", firstLabels,
+                [ = ]() {
+                    return static_cast<size_t>(route->first);
+                },
+                [ = ](size_t index) {
+                    route->first = index;
+                    route->mapped = false;
+                    module->routesChanged = true;
+                }));
+                menu->addChild(createIndexSubmenuItem("Channels", countLabels,
+                [ = ]() {
+                    return static_cast<size_t>(route->count);
+                },
+                [ = ](size_t index) {
+                    route->count = index;
+                    module->routesChanged = true;
+                }));
+                menu->addChild(createBoolMenuItem("Reverse order", "",
+                [ = ]() {
+                    return route->reverse;
+                },
+                [ = ](bool reverse) {
+                    route->reverse = reverse;
+                    route->mapped = false;
+                    module->routesChanged = true;
+                }));
+
+                // Any input channel for each output channel
+                menu->addChild(createSubmenuItem("Channel map", route->mapped ? "On" : "", [ = ](Menu * menu) {
+                    const int channels = (route->count > 0) ? route->count : 16;
+                    for (int c = 0; c < channels; c++) {
+                        menu->addChild(createIndexSubmenuItem(string::f("Channel %d from", c + 1), firstLabels,
+                        [ = ]() {
+                            MultRoute mapped = *route;
+                            if (!mapped.mapped) {
+                                mapped.mapRange();
+                            }
+                            return static_cast<size_t>(mapped.sources[c]);
+                        },
+                        [ = ](size_t index) {
+                            if (!route->mapped) {
+                                route->mapRange();
+                            }
+                            route->sources[c] = index;
+                            module->routesChanged = true;
+                        }));
+                    }
+                    menu->addChild(createMenuItem("Use the range instead", "", [ = ]() {
+                        route->mapped = false;
+                        module->routesChanged = true;
+                    }, !route->mapped));
+                }));
+            }));
+        }
+    }
 };
 
 Model* modelBufferedMult = createModel<BufferedMult, BufferedMultWidget>("BufferedMult");
@@ -1,10 +1,12 @@
 #if !defined(DAISY_CONSTANTS_H)
 #define DAISY_CONSTANTS_H 1
 
-#include "QuantalAudio.hpp"
+#include <atomic>
 
-// Hypothetically the max number of channels that could be chained
-constexpr float DAISY_DIVISOR = 16.f;
+#include "QuantalAudio.hpp"
+#include "core/DaisyProtocol.hpp"
+#include "core/Mixing.hpp"
+#include "core/SceneMorph.hpp"
 
 // How frequently the light draw step is processed
 constexpr int DAISY_LIGHT_DIVISION = 512;
@@ -12,86 +14,268 @@ constexpr int DAISY_LIGHT_DIVISION = 512;
 // How frequently the UI step is processed
 constexpr int DAISY_UI_DIVISION = 128;
 
+// For smoothing out CV
+constexpr float SLEW_SPEED = 6.f;
+
+// Values of the mute switch of a channel strip or group
+constexpr float VALUE_MUTE = 1.f;
+constexpr float VALUE_SOLO = -1.f;
+constexpr float VALUE_OFF = 0.f;
+
+// How long to hold the mute button to solo instead
+constexpr int HOLD_TRIGGER_DURATION = 50;
+
+// IDs that pair a bridge send with a bridge receive
+constexpr int DAISY_BRIDGE_IDS = 8;
+
+// Frames a chain message spends in a bridge, between its send and receive
+constexpr int DAISY_BRIDGE_LATENCY = 1;
+
+// Whether Daisy modules stamp and verify their chain messages, patch-wide;
+// a developer-mode debug aid, see MessageCheck. Set from the UI thread and
+// read by every engine thread.
+extern std::atomic<bool> checkDaisyMessages;
+
+/**
+ * Copy `channels` channels of an input to `v`, repeating a monophonic input
+ * across all of them
+ */
+inline void readPolyVoltages(Input &input, float* v, const int channels) {
+    for (int c = 0; c < channels; c++) {
+        v[c] = input.getPolyVoltage(c);
+    }
+}
+
+/** Reads two adjacent lightIds, so `lightId` and `lightId + 1` must be defined */
+template <typename TBase = GrayModuleLightWidget>
+struct TRedGreenLight : TBase {
+    TRedGreenLight() {
+        this->addBaseColor(SCHEME_RED);
+        this->addBaseColor(SCHEME_GREEN);
+    }
+};
+using RedGreenLight = TRedGreenLight<>;
+
 /**
- * Object to hold stereo polyphonic voltages
+ * QuantalDualLatch
+ *
+ * A switch button that can have multiple states. The way to get to the max
+ * state is to hold down the button for a few moments.
  */
-struct StereoVoltages {
-    int channels = 0;
-    float voltages_l[16] = {};
-    float voltages_r[16] = {};
+template <typename TLight>
+struct QuantalDualLatch : VCVLatch {
+    // Keep track of how long user kept mouse button down
+    int holdDuration = 0;
+
+    // Whether hold duration was long enough to trigger max latch state
+    bool holdSucceed = false;
+
+    app::ModuleLightWidget* light;
+
+    QuantalDualLatch() {
+        light = new TLight;
+        // Move center of light to center of box
+        light->box.pos = box.size.div(2).minus(light->box.size.div(2));
+        addChild(light);
+    }
+
+    app::ModuleLightWidget* getLight() {
+        return light;
+    }
 
     /**
-     * Copies an array of size at least `channels` to this obj's voltages.
-     * Remember to set the number of channels *before* calling this method.
+     * When user starts clicking on latch
      */
-    void writeVoltages(const float* v_l, const float* v_r) {
-        for (int c = 0; c < channels; c++) {
-            voltages_l[c] = v_l[c];
-            voltages_r[c] = v_r[c];
+    void onDragStart(const DragStartEvent& e) override {
+        if (e.button != GLFW_MOUSE_BUTTON_LEFT) {
+            return;
         }
     }
 
-    void writeVoltages(const StereoVoltages sv, int channels) {
-        this->channels = channels;
-        for (int c = 0; c < channels; c++) {
-            voltages_l[c] = sv.voltages_l[c];
-            voltages_r[c] = sv.voltages_r[c];
+    /**
+     * While user is holding down mouse button
+     */
+    void onDragMove(const DragMoveEvent& e) override {
+        holdDuration++;
+        if (!holdSucceed && holdDuration >= HOLD_TRIGGER_DURATION) {
+            engine::ParamQuantity* pq = getParamQuantity();
+            float oldValue = pq->getValue();
+            pq->setValue(VALUE_SOLO);
+            saveHistory(oldValue, pq);
+            holdSucceed = true;
         }
     }
 
     /**
-     * Copies this objs voltages to an array of size at least `channels`
+     * When user stops mouse click on latch
      */
-    void sendVoltages(float* v_l, float* v_r) {
-        for (int c = 0; c < channels; c++) {
-            v_l[c] = voltages_l[c];
-            v_r[c] = voltages_r[c];
+    void onDragEnd(const DragEndEvent& e) override {
+        SvgSwitch::onDragEnd(e);
+
+        if (e.button != GLFW_MOUSE_BUTTON_LEFT) {
+            return;
+        }
+
+        engine::ParamQuantity* pq = getParamQuantity();
+        if (pq && holdDuration < HOLD_TRIGGER_DURATION) {
+            // Don't do this logic if user JUST triggered hold state
+
+            float oldValue = pq->getValue();
+            if (pq->getValue() == VALUE_SOLO || pq->getValue() == VALUE_MUTE) {
+                // Going off mute or solo
+                pq->setValue(VALUE_OFF);
+            } else {
+                // Muting
+                pq->setValue(VALUE_MUTE);
+            }
+            saveHistory(oldValue, pq);
         }
+
+        holdDuration = 0;
+        holdSucceed = false;
     }
-};
 
-struct DaisyMessage {
-    // Daisy-chained mix signal
-    StereoVoltages signals = {};
+    /**
+     * Save history of param change (for undo/redo integration)
+     */
+    void saveHistory(float oldValue, ParamQuantity* pq) {
+        float newValue = pq->getValue();
+        if (oldValue != newValue) {
+            // Push ParamChange history action
+            history::ParamChange* h = new history::ParamChange;
+            h->name = "move switch";
+            h->moduleId = module->id;
+            h->paramId = paramId;
+            h->oldValue = oldValue;
+            h->newValue = newValue;
+            APP->history->push(h);
+        }
+    }
+};
 
-    // Single module's signal
-    StereoVoltages singleSignals = {};
+/**
+ * Whether a module passes the Daisy chain messages along to its right, and
+ * so takes return messages from there
+ */
+inline bool isDaisyChainModule(const Module* m) {
+    return m->model == modelDaisyChannel2
+           || m->model == modelDaisyChannelVu
+           || m->model == modelDaisyChannelSends2
+           || m->model == modelDaisyBlank;
+}
 
-    // Aux 1 send signal
-    StereoVoltages aux1Signals = {};
+/**
+ * Keep the chain's return from the right of `module` between control
+ * frames, clearing it once it's no longer linked
+ */
+inline void receiveDaisyReturn(Module* module, DaisyReturn &returned) {
+    const Module* right = module->rightExpander.module;
+    if (!right || !(isDaisyChainModule(right) || right->model == modelDaisyMaster2 || right->model == modelDaisyGroup
+                    || right->model == modelDaisyBridgeSend)) {
+        returned = DaisyReturn();
+        return;
+    }
+    const DaisyReturnMessage* msg = static_cast<DaisyReturnMessage*>(module->rightExpander.consumerMessage);
+    if (msg->hasControl) {
+        returned = msg->control;
+    }
+}
 
-    // Aux 2 send signal
-    StereoVoltages aux2Signals = {};
+/**
+ * Pass the chain's return back to the module on the left of `module`, on
+ * control frames
+ */
+inline void sendDaisyReturn(Module* module, const bool controlFrame, const DaisyReturn &returned) {
+    Module* left = module->leftExpander.module;
+    if (!left || !(isDaisyChainModule(left) || left->model == modelDaisyBridgeReceive)) {
+        return;
+    }
+    DaisyReturnMessage* msg = static_cast<DaisyReturnMessage*>(left->rightExpander.producerMessage);
+    msg->hasControl = controlFrame;
+    if (controlFrame) {
+        msg->control = returned;
+    }
+    left->rightExpander.messageFlipRequested = true;
+}
 
-    // Solo signals
-    StereoVoltages soloSignals = {};
+/**
+ * The bridge send paired with a bridge receive module, or null
+ */
+Module* findDaisyBridgeSend(const Module* receive);
 
-    // Meta data about this daisy chain
-    int channel_strip_id = 1;
-    float first_pos_x = 0.0f;
-    float first_pos_y = 0.0f;
+/**
+ * What a module's replacement takes over when a v1 Daisy cable chain is
+ * migrated to expanders: its settings, and the ids of its signal and level
+ * CV ports and the chain's ports, or -1 where it has none
+ */
+struct DaisyMigration {
+    float level = 1.f;
+    bool muted = false;
+    int signalInput = -1;
+    int levelCvInput = -1;
+    int signalOutput = -1;
+    int chainInput = -1;
+    int chainOutput = -1;
 };
 
-struct SimpleSlewer {
-    float value = 0.f;
+/**
+ * The migration of a v1 DaisyChannel strip
+ */
+DaisyMigration getDaisyChannelMigration(Module* channel);
 
-    void setSlewSpeed(const float speed) {
-        float sampleRate = APP->engine->getSampleRate();
-        delta = 1.f / (sampleRate * 0.001f * speed);
-    }
+/**
+ * The migration of a v1 DaisyMaster
+ */
+DaisyMigration getDaisyMasterMigration(Module* master);
 
-    float process(float new_value) {
-        if (new_value == value) {
-            return value;
-        }
+/**
+ * The ports of a DaisyChannel2 that take over from a v1 strip's
+ */
+DaisyMigration getDaisyChannel2Migration();
 
-        value += math::clamp(new_value - value, -delta, delta);
-        return value;
-    }
+/**
+ * Replace the v1 Daisy cable chain that `module` is part of, up to its
+ * DaisyMaster, with DaisyChannel2 strips and a DaisyMaster2, as one undo
+ * step; false if it doesn't end in a DaisyMaster
+ */
+bool migrateDaisyChain(Module* module);
 
-private:
+/**
+ * The scene settings of a DaisyChannel2 strip
+ */
+quantal::StripSettings getDaisyStripSettings(Module* strip);
 
-    float delta = 0.0005f;
-};
+/**
+ * Set a DaisyChannel2 strip's level, pan, mute switch and send amounts
+ * straight from scene settings
+ */
+void setDaisyStripSettings(Module* strip, const quantal::StripSettings &settings);
+
+/**
+ * Add the developer-mode menu items to check the chain's messages, with the
+ * counts for the hop into this module
+ */
+inline void appendMessageCheckMenu(Menu* menu, MessageCheck* check) {
+    if (!settings::devMode) {
+        return;
+    }
+
+    menu->addChild(new MenuSeparator);
+    menu->addChild(createBoolMenuItem("Check chain messages", "",
+    []() {
+        return checkDaisyMessages.load(std::memory_order_relaxed);
+    },
+    [](bool check) {
+        checkDaisyMessages.store(check, std::memory_order_relaxed);
+    }));
+    if (checkDaisyMessages.load(std::memory_order_relaxed)) {
+        menu->addChild(createMenuLabel(string::f("Torn reads: %u", check->torn)));
+        menu->addChild(createMenuLabel(string::f("Stale reads: %u", check->stale)));
+        menu->addChild(createMenuLabel(string::f("Skipped flips: %u", check->skipped)));
+        menu->addChild(createMenuItem("Reset counts", "", [ = ]() {
+            check->reset();
+        }));
+    }
+}
 
 #endif
@@ -24,9 +24,16 @@ struct DaisyBlank : Module {
     Vec widgetPos;
 
     dsp::ClockDivider lightDivider;
+    dsp::ClockDivider controlDivider;
 
-    DaisyMessage daisyInputMessage[2][1];
-    DaisyMessage daisyOutputMessage[2][1];
+    // Control data last received from the left, and the chain's return
+    // from the right
+    DaisyControl control;
+    DaisyReturn returned;
+
+    DaisyInputMessages daisyInputMessages;
+    ExpanderMessages<DaisyReturnMessage> daisyReturnMessages;
+    MessageCheck messageCheck;
 
     DaisyBlank() {
         config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
@@ -35,12 +42,13 @@ struct DaisyBlank : Module {
         configLight(LINK_LIGHT_R, "Daisy chain link output");
 
         // Set the expander messages
-        leftExpander.producerMessage = &daisyInputMessage[0];
-        leftExpander.consumerMessage = &daisyInputMessage[1];
-        rightExpander.producerMessage = &daisyOutputMessage[0];
-        rightExpander.consumerMessage = &daisyOutputMessage[1];
+        leftExpander.producerMessage = daisyInputMessages.producer();
+        leftExpander.consumerMessage = daisyInputMessages.consumer();
+        rightExpander.producerMessage = daisyReturnMessages.producer();
+        rightExpander.consumerMessage = daisyReturnMessages.consumer();
 
         lightDivider.setDivision(DAISY_LIGHT_DIVISION);
+        controlDivider.setDivision(DAISY_CONTROL_DIVISION);
     }
 
     void setWidgetPosition(Vec pos) {
@@ -48,59 +56,57 @@ struct DaisyBlank : Module {
     }
 
     void process(const ProcessArgs &args) override {
-
-        // Assume this module is the first in the chain; it will get
-        // overwritten if we receive a value from the left expander
-        Vec firstPos = widgetPos;
+        const bool controlFrame = controlDivider.process();
 
         // Get daisy-chained data from left-side linked module
-        if (leftExpander.module && (
-                leftExpander.module->model == modelDaisyChannel2
-                || leftExpander.module->model == modelDaisyChannelVu
-                || leftExpander.module->model == modelDaisyChannelSends2
-                || leftExpander.module->model == modelDaisyBlank
-            )) {
+        if (leftExpander.module && (isDaisyChainModule(leftExpander.module)
+                                    || leftExpander.module->model == modelDaisyBridgeReceive)) {
             const DaisyMessage* msgFromModule = static_cast<DaisyMessage*>(leftExpander.consumerMessage);
+            messageCheck.check(*msgFromModule, leftExpander.module);
 
-            firstPos = Vec(msgFromModule->first_pos_x, msgFromModule->first_pos_y);
-            channelStripId = msgFromModule->channel_strip_id;
+            if (msgFromModule->hasControl) {
+                control = daisyInputMessages.control.consumer(args.frame);
+            }
+            channelStripId = control.channel_strip_id;
 
             // Set daisy-chained output to right-side linked module
-            if (rightExpander.module && (
-                    rightExpander.module->model == modelDaisyMaster2
-                    || rightExpander.module->model == modelDaisyChannel2
-                    || rightExpander.module->model == modelDaisyChannelVu
-                    || rightExpander.module->model == modelDaisyChannelSends2
-                    || rightExpander.module->model == modelDaisyBlank
-                )) {
+            if (rightExpander.module && (isDaisyChainModule(rightExpander.module)
+                                         || rightExpander.module->model == modelDaisyMaster2
+                                         || rightExpander.module->model == modelDaisyGroup
+                                         || rightExpander.module->model == modelDaisyBridgeSend)) {
                 DaisyMessage* msgToModule = static_cast<DaisyMessage*>(rightExpander.module->leftExpander.producerMessage);
 
                 msgToModule->signals = msgFromModule->signals;
                 msgToModule->aux1Signals = msgFromModule->aux1Signals;
                 msgToModule->aux2Signals = msgFromModule->aux2Signals;
                 msgToModule->soloSignals = msgFromModule->soloSignals;
+                msgToModule->stemSignals = msgFromModule->stemSignals;
+                msgToModule->silent = msgFromModule->silent;
 
-                msgToModule->first_pos_x = firstPos.x;
-                msgToModule->first_pos_y = firstPos.y;
-                msgToModule->channel_strip_id = channelStripId;
+                msgToModule->hasControl = controlFrame;
+                if (controlFrame) {
+                    msgToModule->controlMessage->producer(args.frame) = control;
+                }
 
+                messageCheck.stamp(*msgToModule, checkDaisyMessages.load(std::memory_order_relaxed));
                 rightExpander.module->leftExpander.messageFlipRequested = true;
             }
 
             link_l = 0.8f;
         } else {
+            control = DaisyControl();
             channelStripId = 1;
             link_l = 0.0f;
         }
 
+        receiveDaisyReturn(this, returned);
+        sendDaisyReturn(this, controlFrame, returned);
+
         // Make sure link light to the right is correct
-        if (rightExpander.module && (
-                rightExpander.module->model == modelDaisyMaster2
-                || rightExpander.module->model == modelDaisyChannel2
-                || rightExpander.module->model == modelDaisyChannelVu
-                || rightExpander.module->model == modelDaisyChannelSends2
-                || rightExpander.module->model == modelDaisyBlank
-            )) {
+        if (rightExpander.module && (isDaisyChainModule(rightExpander.module)
+                                     || rightExpander.module->model == modelDaisyMaster2
+                                     || rightExpander.module->model == modelDaisyGroup
+                                     || rightExpander.module->model == modelDaisyBridgeSend)) {
             link_r = 0.8f;
         } else {
             link_r = 0.0f;
@@ -149,6 +155,12 @@ struct DaisyBlankWidget : ModuleWidget {
 
         ModuleWidget::step();
     }
+
+    void appendContextMenu(Menu *menu) override {
+        DaisyBlank *module = getModule<DaisyBlank>();
+
+        appendMessageCheckMenu(menu, &module->messageCheck);
+    }
 };
 
 Model* modelDaisyBlank = createModel<DaisyBlank, DaisyBlankWidget>("DaisyBlank");
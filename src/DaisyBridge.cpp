@@ -0,0 +1,516 @@
+#include "QuantalAudio.hpp"
+#include "Daisy.hpp"
+#include "core/SpscRing.hpp"
+
+// Frames a bridge holds; the send stays at most a frame ahead of its
+// receive, so this only covers the frame or two it takes to pair up
+constexpr size_t DAISY_BRIDGE_RING_FRAMES = 4;
+
+/**
+ * A chain message on its way across a bridge, with the frame it was sent
+ * and the control data when the message flags some
+ */
+struct DaisyBridgeFrame {
+    int64_t frame = -1;
+    DaisyMessage message;
+    DaisyControl control;
+};
+
+/**
+ * The link between the bridge send and the bridge receive with the same ID
+ *
+ * Each side claims its end before touching the ring, so the ring only ever
+ * has one writer and one reader, whichever engine threads they run on.
+ */
+struct DaisyBridge {
+    quantal::SpscRing<DaisyBridgeFrame> ring{DAISY_BRIDGE_RING_FRAMES};
+    std::atomic<Module*> send{nullptr};
+    std::atomic<Module*> receive{nullptr};
+
+    // Mute groups, VCA group levels, worst latency and stem bank returned
+    // from the receive's side of the chain
+    std::atomic<uint8_t> mutedGroups{0};
+    std::atomic<float> vcaLevels[DAISY_VCA_GROUPS];
+    std::atomic<int> latency{0};
+    std::atomic<int> stemBank{-1};
+
+    DaisyBridge() {
+        for (std::atomic<float> &level : vcaLevels) {
+            level.store(1.f);
+        }
+    }
+};
+
+static DaisyBridge daisyBridges[DAISY_BRIDGE_IDS];
+
+/**
+ * One module's hold on one end of a bridge, following the ID it's set to
+ */
+struct DaisyBridgeEnd {
+    std::atomic<Module*> DaisyBridge::*end;
+    DaisyBridge* bridge = nullptr;
+    int index = 0;
+
+    explicit DaisyBridgeEnd(std::atomic<Module*> DaisyBridge::*end) : end(end) {}
+
+    /**
+     * The bridge at `wanted` if `owner` holds its end, trying to claim it
+     * when not; null while the other module with that ID holds it
+     */
+    DaisyBridge* follow(Module* owner, const int wanted) {
+        if (wanted != index) {
+            release();
+            index = wanted;
+        }
+        if (!bridge) {
+            DaisyBridge* b = &daisyBridges[index];
+            Module* expected = nullptr;
+            if ((b->*end).load(std::memory_order_relaxed) == nullptr && (b->*end).compare_exchange_strong(expected, owner)) {
+                bridge = b;
+            }
+        }
+        return bridge;
+    }
+
+    void release() {
+        if (bridge) {
+            (bridge->*end).store(nullptr);
+            bridge = nullptr;
+        }
+    }
+};
+
+/**
+ * Add the bridge ID submenu, with whether this end got the ID
+ */
+static void appendBridgeMenu(Menu* menu, int* index, const bool held) {
+    std::vector<std::string> labels;
+    for (int i = 0; i < DAISY_BRIDGE_IDS; i++) {
+        labels.push_back(std::to_string(i + 1));
+    }
+
+    menu->addChild(new MenuSeparator);
+    menu->addChild(createIndexPtrSubmenuItem("Bridge ID", labels, index));
+    if (!held) {
+        menu->addChild(createMenuLabel("Another bridge of this kind has this ID"));
+    }
+    const int latency = DAISY_BRIDGE_LATENCY + 1;
+    menu->addChild(createMenuLabel(string::f("Latency: %d samples (%.2f ms)", latency,
+                                   1000.f * latency / APP->engine->getSampleRate())));
+}
+
+static json_t* bridgeToJson(const int index) {
+    json_t* rootJ = json_object();
+
+    json_object_set_new(rootJ, "bridge_id", json_integer(index + 1));
+
+    return rootJ;
+}
+
+static void bridgeFromJson(json_t* rootJ, int &index) {
+    const json_t* bridgeJ = json_object_get(rootJ, "bridge_id");
+    if (bridgeJ) {
+        index = clamp(static_cast<int>(json_integer_value(bridgeJ)), 1, DAISY_BRIDGE_IDS) - 1;
+    }
+}
+
+struct DaisyBridgeSend : Module {
+    enum ParamIds {
+        NUM_PARAMS
+    };
+    enum InputIds {
+        NUM_INPUTS
+    };
+    enum OutputIds {
+        NUM_OUTPUTS
+    };
+    enum LightsIds {
+        LINK_LIGHT_L,
+        PAIRED_LIGHT,
+        NUM_LIGHTS
+    };
+
+    float link_l = 0.f;
+    bool held = true;
+    bool paired = false;
+
+    // Index of the bridge ID, 0 for ID 1
+    int bridgeIndex = 0;
+    DaisyBridgeEnd bridgeEnd{&DaisyBridge::send};
+
+    dsp::ClockDivider lightDivider;
+    dsp::ClockDivider controlDivider;
+
+    // Control data last received from the chain
+    DaisyControl control;
+
+    DaisyInputMessages daisyMessages;
+    MessageCheck messageCheck;
+    DaisyBridgeFrame frame;
+
+    DaisyBridgeSend() {
+        config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
+
+        configLight(LINK_LIGHT_L, "Daisy chain link input");
+        configLight(PAIRED_LIGHT, "Paired with a bridge receive");
+
+        // Set the left expander message instances
+        leftExpander.producerMessage = daisyMessages.producer();
+        leftExpander.consumerMessage = daisyMessages.consumer();
+
+        lightDivider.setDivision(DAISY_LIGHT_DIVISION);
+        controlDivider.setDivision(DAISY_CONTROL_DIVISION);
+    }
+
+    ~DaisyBridgeSend() override {
+        bridgeEnd.release();
+    }
+
+    json_t* dataToJson() override {
+        return bridgeToJson(bridgeIndex);
+    }
+
+    void dataFromJson(json_t* rootJ) override {
+        bridgeFromJson(rootJ, bridgeIndex);
+    }
+
+    /**
+     * When user resets this module
+     */
+    void onReset() override {
+        bridgeIndex = 0;
+    }
+
+    void process(const ProcessArgs &args) override {
+        const bool controlFrame = controlDivider.process();
+
+        DaisyBridge* bridge = bridgeEnd.follow(this, bridgeIndex);
+        held = bridge != nullptr;
+        paired = held && bridge->receive.load(std::memory_order_relaxed) != nullptr;
+
+        // Get daisy-chained data from left-side linked module
+        const DaisyMessage* msgFromExpander = nullptr;
+        const Module* left = leftExpander.module;
+        if (left && (isDaisyChainModule(left) || left->model == modelDaisyBridgeReceive)) {
+            msgFromExpander = static_cast<DaisyMessage*>(leftExpander.consumerMessage);
+            messageCheck.check(*msgFromExpander, leftExpander.module);
+
+            if (msgFromExpander->hasControl) {
+                control = daisyMessages.control.consumer(args.frame);
+            }
+
+            link_l = 0.8f;
+        } else {
+            control = DaisyControl();
+            link_l = 0.0f;
+        }
+
+        // Pass the chain's message across the bridge whole, stamped with
+        // the frame for the receive to pick it up on the next one
+        if (paired) {
+            frame.frame = args.frame;
+            if (msgFromExpander) {
+                frame.message = *msgFromExpander;
+            } else {
+                frame.message.signals.channels = 0;
+                frame.message.aux1Signals.channels = 0;
+                frame.message.aux2Signals.channels = 0;
+                frame.message.soloSignals.channels = 0;
+                frame.message.stemSignals.channels = 0;
+                frame.message.silent = true;
+            }
+            frame.message.hasControl = controlFrame;
+            frame.control = control;
+            bridge->ring.write(&frame, 1);
+        }
+
+        // The return from the other side of the bridge goes back along this
+        // side
+        DaisyReturn bridged;
+        if (paired) {
+            bridged.mutedGroups = bridge->mutedGroups.load(std::memory_order_relaxed);
+            for (int g = 0; g < DAISY_VCA_GROUPS; g++) {
+                bridged.vcaLevels[g] = bridge->vcaLevels[g].load(std::memory_order_relaxed);
+            }
+            bridged.latency = bridge->latency.load(std::memory_order_relaxed);
+            bridged.stemBank = bridge->stemBank.load(std::memory_order_relaxed);
+        }
+        sendDaisyReturn(this, controlFrame, bridged);
+
+        // Set lights
+        if (lightDivider.process()) {
+            lights[LINK_LIGHT_L].setBrightness(link_l);
+            lights[PAIRED_LIGHT].setBrightness(paired ? 0.8f : 0.f);
+        }
+    }
+};
+
+struct DaisyBridgeReceive : Module {
+    enum ParamIds {
+        NUM_PARAMS
+    };
+    enum InputIds {
+        NUM_INPUTS
+    };
+    enum OutputIds {
+        NUM_OUTPUTS
+    };
+    enum LightsIds {
+        LINK_LIGHT_R,
+        PAIRED_LIGHT,
+        NUM_LIGHTS
+    };
+
+    float link_r = 0.f;
+    bool held = true;
+    bool paired = false;
+
+    // Index of the bridge ID, 0 for ID 1
+    int bridgeIndex = 0;
+    DaisyBridgeEnd bridgeEnd{&DaisyBridge::receive};
+
+    Vec widgetPos;
+
+    dsp::ClockDivider lightDivider;
+    dsp::ClockDivider controlDivider;
+
+    // Control data last received across the bridge, and the chain's return
+    // from the right
+    DaisyControl control;
+    DaisyReturn returned;
+
+    ExpanderMessages<DaisyReturnMessage> daisyReturnMessages;
+    MessageCheck messageCheck;
+
+    // The next frame out of the bridge, read ahead of its turn
+    DaisyBridgeFrame pending;
+    bool hasPending = false;
+    DaisyBridge* pendingBridge = nullptr;
+
+    DaisyBridgeReceive() {
+        config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
+
+        configLight(LINK_LIGHT_R, "Daisy chain link output");
+        configLight(PAIRED_LIGHT, "Paired with a bridge send");
+
+        // Set the right expander message instances
+        rightExpander.producerMessage = daisyReturnMessages.producer();
+        rightExpander.consumerMessage = daisyReturnMessages.consumer();
+
+        lightDivider.setDivision(DAISY_LIGHT_DIVISION);
+        controlDivider.setDivision(DAISY_CONTROL_DIVISION);
+    }
+
+    ~DaisyBridgeReceive() override {
+        bridgeEnd.release();
+    }
+
+    json_t* dataToJson() override {
+        return bridgeToJson(bridgeIndex);
+    }
+
+    void dataFromJson(json_t* rootJ) override {
+        bridgeFromJson(rootJ, bridgeIndex);
+    }
+
+    /**
+     * When user resets this module
+     */
+    void onReset() override {
+        bridgeIndex = 0;
+    }
+
+    void setWidgetPosition(Vec pos) {
+        widgetPos = pos;
+    }
+
+    /**
+     * The bridge send this receive is paired with, or null
+     */
+    Module* getSend() const {
+        const DaisyBridge &bridge = daisyBridges[bridgeIndex];
+        if (bridge.receive.load() != this) {
+            return nullptr;
+        }
+        return bridge.send.load();
+    }
+
+    /**
+     * What the send wrote on `frame`, or null if there isn't anything;
+     * older frames are dropped and newer ones kept for their turn, unless
+     * they're too far ahead to be from this run of the engine
+     */
+    const DaisyBridgeFrame* take(DaisyBridge* bridge, const int64_t frame) {
+        if (bridge != pendingBridge) {
+            pendingBridge = bridge;
+            hasPending = false;
+        }
+        while (!hasPending || pending.frame < frame || pending.frame > frame + static_cast<int64_t>(DAISY_BRIDGE_RING_FRAMES)) {
+            hasPending = bridge->ring.read(&pending, 1) == 1;
+            if (!hasPending) {
+                return nullptr;
+            }
+        }
+        if (pending.frame != frame) {
+            return nullptr;
+        }
+        hasPending = false;
+        return &pending;
+    }
+
+    void process(const ProcessArgs &args) override {
+        const bool controlFrame = controlDivider.process();
+
+        DaisyBridge* bridge = bridgeEnd.follow(this, bridgeIndex);
+        held = bridge != nullptr;
+        paired = held && bridge->send.load(std::memory_order_relaxed) != nullptr;
+
+        const DaisyBridgeFrame* fromBridge = paired ? take(bridge, args.frame - DAISY_BRIDGE_LATENCY) : nullptr;
+        const DaisyMessage* msgFromBridge = fromBridge ? &fromBridge->message : nullptr;
+        if (msgFromBridge) {
+            if (msgFromBridge->hasControl) {
+                control = fromBridge->control;
+            }
+        } else if (!paired) {
+            // The first in the chain starts the control data
+            control = DaisyControl();
+            control.first_pos_x = widgetPos.x;
+            control.first_pos_y = widgetPos.y;
+        }
+
+        receiveDaisyReturn(this, returned);
+        if (held) {
+            bridge->mutedGroups.store(returned.mutedGroups, std::memory_order_relaxed);
+            for (int g = 0; g < DAISY_VCA_GROUPS; g++) {
+                bridge->vcaLevels[g].store(returned.vcaLevels[g], std::memory_order_relaxed);
+            }
+            bridge->latency.store(returned.latency, std::memory_order_relaxed);
+            bridge->stemBank.store(returned.stemBank, std::memory_order_relaxed);
+        }
+
+        // Set daisy-chained output to right-side linked module, empty and
+        // silent on a frame with nothing from the bridge
+        const Module* right = rightExpander.module;
+        if (right && (isDaisyChainModule(right) || right->model == modelDaisyMaster2 || right->model == modelDaisyGroup
+                      || right->model == modelDaisyBridgeSend)) {
+            DaisyMessage* msgToModule = static_cast<DaisyMessage*>(rightExpander.module->leftExpander.producerMessage);
+
+            if (msgFromBridge) {
+                msgToModule->signals = msgFromBridge->signals;
+                msgToModule->aux1Signals = msgFromBridge->aux1Signals;
+                msgToModule->aux2Signals = msgFromBridge->aux2Signals;
+                msgToModule->soloSignals = msgFromBridge->soloSignals;
+                msgToModule->stemSignals = msgFromBridge->stemSignals;
+                msgToModule->silent = msgFromBridge->silent;
+            } else {
+                msgToModule->signals.channels = 0;
+                msgToModule->aux1Signals.channels = 0;
+                msgToModule->aux2Signals.channels = 0;
+                msgToModule->soloSignals.channels = 0;
+                msgToModule->stemSignals.channels = 0;
+                msgToModule->silent = true;
+            }
+            msgToModule->singleSignals.channels = 0;
+
+            msgToModule->hasControl = controlFrame;
+            if (controlFrame) {
+                msgToModule->controlMessage->producer(args.frame) = control;
+            }
+
+            messageCheck.stamp(*msgToModule, checkDaisyMessages.load(std::memory_order_relaxed));
+            rightExpander.module->leftExpander.messageFlipRequested = true;
+
+            link_r = 0.8f;
+        } else {
+            link_r = 0.0f;
+        }
+
+        // Set lights
+        if (lightDivider.process()) {
+            lights[LINK_LIGHT_R].setBrightness(link_r);
+            lights[PAIRED_LIGHT].setBrightness(paired ? 0.8f : 0.f);
+        }
+    }
+};
+
+Module* findDaisyBridgeSend(const Module* receive) {
+    return static_cast<const DaisyBridgeReceive*>(receive)->getSend();
+}
+
+struct DaisyBridgeSendWidget : ModuleWidget {
+    explicit DaisyBridgeSendWidget(DaisyBridgeSend *module) {
+        setModule(module);
+        setPanel(
+            createPanel(
+                asset::plugin(pluginInstance, "res/DaisyBridgeSend.svg"),
+                asset::plugin(pluginInstance, "res/DaisyBridgeSend-dark.svg")
+            )
+        );
+
+        // Screws
+        addChild(createWidget<ThemedScrew>(Vec(RACK_GRID_WIDTH, 0)));
+        addChild(createWidget<ThemedScrew>(Vec(0, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
+
+        // Paired light
+        addChild(createLightCentered<MediumLight<GreenLight>>(Vec(RACK_GRID_WIDTH, 66.0f), module, DaisyBridgeSend::PAIRED_LIGHT));
+
+        // Link light
+        addChild(createLightCentered<TinyLight<YellowLight>>(Vec(RACK_GRID_WIDTH - 4, 361.0f), module, DaisyBridgeSend::LINK_LIGHT_L));
+    }
+
+    void appendContextMenu(Menu *menu) override {
+        DaisyBridgeSend *module = getModule<DaisyBridgeSend>();
+
+        appendBridgeMenu(menu, &module->bridgeIndex, module->held);
+        appendMessageCheckMenu(menu, &module->messageCheck);
+    }
+};
+
+struct DaisyBridgeReceiveWidget : ModuleWidget {
+
+    dsp::ClockDivider uiDivider;
+
+    explicit DaisyBridgeReceiveWidget(DaisyBridgeReceive *module) {
+        setModule(module);
+        setPanel(
+            createPanel(
+                asset::plugin(pluginInstance, "res/DaisyBridgeReceive.svg"),
+                asset::plugin(pluginInstance, "res/DaisyBridgeReceive-dark.svg")
+            )
+        );
+
+        // Screws
+        addChild(createWidget<ThemedScrew>(Vec(RACK_GRID_WIDTH, 0)));
+        addChild(createWidget<ThemedScrew>(Vec(0, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
+
+        // Paired light
+        addChild(createLightCentered<MediumLight<GreenLight>>(Vec(RACK_GRID_WIDTH, 66.0f), module, DaisyBridgeReceive::PAIRED_LIGHT));
+
+        // Link light
+        addChild(createLightCentered<TinyLight<YellowLight>>(Vec(RACK_GRID_WIDTH + 4, 361.0f), module, DaisyBridgeReceive::LINK_LIGHT_R));
+
+        uiDivider.setDivision(DAISY_UI_DIVISION);
+    }
+
+    void step() override {
+        if (uiDivider.process()) {
+            DaisyBridgeReceive *module = getModule<DaisyBridgeReceive>();
+
+            if (module && this->box.pos.x > 0.00) {
+                module->setWidgetPosition(this->box.pos);
+            }
+        }
+
+        ModuleWidget::step();
+    }
+
+    void appendContextMenu(Menu *menu) override {
+        DaisyBridgeReceive *module = getModule<DaisyBridgeReceive>();
+
+        appendBridgeMenu(menu, &module->bridgeIndex, module->held);
+        appendMessageCheckMenu(menu, &module->messageCheck);
+    }
+};
+
+Model* modelDaisyBridgeSend = createModel<DaisyBridgeSend, DaisyBridgeSendWidget>("DaisyBridgeSend");
+Model* modelDaisyBridgeReceive = createModel<DaisyBridgeReceive, DaisyBridgeReceiveWidget>("DaisyBridgeReceive");
@@ -128,6 +128,27 @@ struct DaisyChannelWidget : ModuleWidget {
         addInput(createInput<ThemedPJ301MPort>(Vec(RACK_GRID_WIDTH - 12.5f, 290.5), module, DaisyChannel::CHAIN_INPUT));
         addOutput(createOutput<ThemedPJ301MPort>(Vec(RACK_GRID_WIDTH - 12.5f, 320.0), module, DaisyChannel::CHAIN_OUTPUT));
     }
+
+    void appendContextMenu(Menu *menu) override {
+        DaisyChannel* module = getModule<DaisyChannel>();
+
+        menu->addChild(new MenuSeparator);
+        menu->addChild(createMenuItem("Migrate chain to Daisy Mix 2", "", [ = ]() {
+            migrateDaisyChain(module);
+        }));
+    }
 };
 
+DaisyMigration getDaisyChannelMigration(Module* channel) {
+    DaisyMigration migration;
+    migration.level = channel->params[DaisyChannel::CH_LVL_PARAM].getValue();
+    migration.muted = static_cast<DaisyChannel*>(channel)->muted;
+    migration.signalInput = DaisyChannel::CH_INPUT;
+    migration.levelCvInput = DaisyChannel::LVL_CV_INPUT;
+    migration.signalOutput = DaisyChannel::CH_OUTPUT;
+    migration.chainInput = DaisyChannel::CHAIN_INPUT;
+    migration.chainOutput = DaisyChannel::CHAIN_OUTPUT;
+    return migration;
+}
+
 Model* modelDaisyChannel = createModel<DaisyChannel, DaisyChannelWidget>("DaisyChannel");
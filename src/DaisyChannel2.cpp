@@ -1,12 +1,8 @@
 #include "QuantalAudio.hpp"
 #include "Daisy.hpp"
 
-constexpr float SLEW_SPEED = 6.f; // For smoothing out CV
-constexpr float VALUE_MUTE = 1.f;
-constexpr float VALUE_SOLO = -1.f;
-constexpr float VALUE_OFF = 0.f;
-
-constexpr int HOLD_TRIGGER_DURATION = 50;
+// Weakest ping that counts as heard when measuring an insert
+constexpr float PING_THRESHOLD = 0.1f;
 
 struct DaisyChannel2 : Module {
     enum ParamIds {
@@ -45,16 +41,52 @@ struct DaisyChannel2 : Module {
     float aux1_send_amt = 0.f;
     float aux2_send_amt = 0.f;
 
+    // Mute group from 1 to DAISY_MUTE_GROUPS, or 0 for none; muting any
+    // strip in a group mutes the whole group along the chain
+    int muteGroup = 0;
+    bool groupMuted = false;
+
+    // VCA group from 1 to DAISY_VCA_GROUPS, or 0 for none; the level knob
+    // of a strip leading the group also sets the level of the others in it
+    // along the chain
+    int vcaGroup = 0;
+    bool vcaLead = false;
+    GainSlewer vcaSlewer;
+
+    // Latency of an external insert feeding this strip, in frames; the
+    // other strips along the chain are delayed to line up with the worst
+    int latency = 0;
+
+    // Delay lining this strip up with the chain's worst latency, long
+    // enough for any latency so the audio thread only moves its tap
+    StereoDelay delay{DAISY_MAX_LATENCY};
+    int delayFrames = 0;
+
+    // Set from the menu to measure the insert's latency: the direct outs
+    // send a ping, and the frame it comes back on the inputs is the answer
+    std::atomic<bool> measureRequested{false};
+    int measureFrame = -1;
+    int pingFrame = 0;
+    float pingPeak = 0.f;
+    bool measureFailed = false;
+
     int channelStripId = 1;
     std::string label;
 
     Vec widgetPos;
 
     dsp::ClockDivider lightDivider;
+    dsp::ClockDivider controlDivider;
 
-    DaisyMessage daisyInputMessage[2][1];
-    DaisyMessage daisyOutputMessage[2][1];
-    SimpleSlewer levelSlewer[16];
+    // Control data last received from the left, and the chain's return
+    // from the right
+    DaisyControl control;
+    DaisyReturn returned;
+
+    DaisyInputMessages daisyInputMessages;
+    ExpanderMessages<DaisyReturnMessage> daisyReturnMessages;
+    MessageCheck messageCheck;
+    PolySlewer levelSlewer;
 
     /**
      * Constructor
@@ -75,17 +107,17 @@ struct DaisyChannel2 : Module {
         configLight(LINK_LIGHT_L, "Daisy chain link input");
         configLight(LINK_LIGHT_R, "Daisy chain link output");
 
-        for (int c = 0; c < 16; c++) {
-            levelSlewer[c].setSlewSpeed(SLEW_SPEED);
-        }
+        levelSlewer.setSlewSpeed(SLEW_SPEED, APP->engine->getSampleRate());
+        vcaSlewer.setSlewSpeed(SLEW_SPEED, APP->engine->getSampleRate());
 
         // Set the expander messages
-        leftExpander.producerMessage = &daisyInputMessage[0];
-        leftExpander.consumerMessage = &daisyInputMessage[1];
-        rightExpander.producerMessage = &daisyOutputMessage[0];
-        rightExpander.consumerMessage = &daisyOutputMessage[1];
+        leftExpander.producerMessage = daisyInputMessages.producer();
+        leftExpander.consumerMessage = daisyInputMessages.consumer();
+        rightExpander.producerMessage = daisyReturnMessages.producer();
+        rightExpander.consumerMessage = daisyReturnMessages.consumer();
 
         lightDivider.setDivision(DAISY_LIGHT_DIVISION);
+        controlDivider.setDivision(DAISY_CONTROL_DIVISION);
     }
 
     /**
@@ -100,6 +132,10 @@ struct DaisyChannel2 : Module {
         json_object_set_new(rootJ, "level_slew", json_boolean(levelSlew));
         json_object_set_new(rootJ, "aux1_send_amt", json_real(aux1_send_amt));
         json_object_set_new(rootJ, "aux2_send_amt", json_real(aux2_send_amt));
+        json_object_set_new(rootJ, "mute_group", json_integer(muteGroup));
+        json_object_set_new(rootJ, "vca_group", json_integer(vcaGroup));
+        json_object_set_new(rootJ, "vca_lead", json_boolean(vcaLead));
+        json_object_set_new(rootJ, "latency", json_integer(latency));
 
         return rootJ;
     }
@@ -143,6 +179,28 @@ struct DaisyChannel2 : Module {
         if (aux2_send_amtJ) {
             aux2_send_amt = std::max(0.0f, static_cast<float>(json_real_value(aux2_send_amtJ)));
         }
+
+        // mute group
+        const json_t* muteGroupJ = json_object_get(rootJ, "mute_group");
+        if (muteGroupJ) {
+            muteGroup = clamp(static_cast<int>(json_integer_value(muteGroupJ)), 0, DAISY_MUTE_GROUPS);
+        }
+
+        // VCA group
+        const json_t* vcaGroupJ = json_object_get(rootJ, "vca_group");
+        if (vcaGroupJ) {
+            vcaGroup = clamp(static_cast<int>(json_integer_value(vcaGroupJ)), 0, DAISY_VCA_GROUPS);
+        }
+        const json_t* vcaLeadJ = json_object_get(rootJ, "vca_lead");
+        if (vcaLeadJ) {
+            vcaLead = json_is_true(vcaLeadJ);
+        }
+
+        // insert latency
+        const json_t* latencyJ = json_object_get(rootJ, "latency");
+        if (latencyJ) {
+            latency = clamp(static_cast<int>(json_integer_value(latencyJ)), 0, DAISY_MAX_LATENCY);
+        }
     }
 
     /**
@@ -163,12 +221,15 @@ struct DaisyChannel2 : Module {
         levelSlew = true;
         aux1_send_amt = 0.0f;
         aux2_send_amt = 0.0f;
+        muteGroup = 0;
+        vcaGroup = 0;
+        vcaLead = false;
+        latency = 0;
     }
 
     void onSampleRateChange() override {
-        for (int c = 0; c < 16; c++) {
-            levelSlewer[c].setSlewSpeed(SLEW_SPEED);
-        }
+        levelSlewer.setSlewSpeed(SLEW_SPEED, APP->engine->getSampleRate());
+        vcaSlewer.setSlewSpeed(SLEW_SPEED, APP->engine->getSampleRate());
     }
 
     StereoVoltages signals = {};
@@ -176,6 +237,16 @@ struct DaisyChannel2 : Module {
     StereoVoltages aux1Signals = {};
     StereoVoltages aux2Signals = {};
     StereoVoltages soloSignals = {};
+    StereoVoltages stemSignals = {};
+
+    // Idle while this strip adds nothing to a silent chain: the voltages
+    // above stay at 0V and only channel counts and layout are passed along
+    bool idle = false;
+    SilenceDetector inputSilence;
+    // Module whose message buffers have been zeroed since idling, and how
+    // many of its two buffers
+    Module* clearedModule = nullptr;
+    int clearedBuffers = 0;
 
     /**
      * PROCESS
@@ -183,30 +254,78 @@ struct DaisyChannel2 : Module {
      * Called at sample rate
      */
     void process(const ProcessArgs &args) override {
-        muted = params[MUTE_PARAM].getValue() > VALUE_OFF;
+        const bool controlFrame = controlDivider.process();
+
+        // Muted by the button, or by another strip in the same mute group
+        receiveDaisyReturn(this, returned);
+        const uint8_t muteGroupBit = (muteGroup > 0) ? 1 << (muteGroup - 1) : 0;
+        const bool mutedHere = params[MUTE_PARAM].getValue() > VALUE_OFF;
+        groupMuted = (returned.mutedGroups & muteGroupBit) != 0;
+        muted = mutedHere || groupMuted;
         solo = params[MUTE_PARAM].getValue() < VALUE_OFF;
 
-        signals = {};
-        daisySignals = {};
-        aux1Signals = {};
-        aux2Signals = {};
-        soloSignals = {};
+        // Level set by the strips leading this one's VCA group, which comes
+        // back along the chain at control rate and so is slewed
+        const bool vcaFollower = vcaGroup > 0 && !vcaLead;
+        const float vcaLevel = vcaSlewer.process(vcaFollower ? returned.vcaLevels[vcaGroup - 1] : 1.f);
 
         // Assume this module is the first in the chain; it will get
         // overwritten if we receive a value from the left expander
         Vec firstPos = widgetPos;
 
+        // Daisy-chained data from left-side linked module
+        const DaisyMessage* msgFromModule = nullptr;
+        const Module* left = leftExpander.module;
+        if (left && (isDaisyChainModule(left) || left->model == modelDaisyBridgeReceive)) {
+            msgFromModule = static_cast<DaisyMessage*>(leftExpander.consumerMessage);
+            messageCheck.check(*msgFromModule, leftExpander.module);
+        }
+
+        // Idle when the chain so far is silent and this strip's inputs are
+        // unpatched, silent or muted off the direct outs too
+        const bool patched = inputs[CH_INPUT_1].isConnected() || inputs[CH_INPUT_2].isConnected();
+        const float peak = std::max(
+                               SilenceDetector::peak(inputs[CH_INPUT_1].getVoltages(), inputs[CH_INPUT_1].getChannels()),
+                               SilenceDetector::peak(inputs[CH_INPUT_2].getVoltages(), inputs[CH_INPUT_2].getChannels())
+                           );
+        const bool inputsSilent = inputSilence.process(peak) || !patched;
+        const bool wasIdle = idle;
+        idle = (!msgFromModule || msgFromModule->silent) && (inputsSilent || (muted && !directOutsPremute));
+        if (idle && !wasIdle) {
+            clearedModule = nullptr;
+        }
+
+        // Once idle, the voltages are left at 0V and only the channel
+        // counts need clearing
+        if (idle && wasIdle) {
+            signals.channels = 0;
+            daisySignals.channels = 0;
+            aux1Signals.channels = 0;
+            aux2Signals.channels = 0;
+            soloSignals.channels = 0;
+            stemSignals.channels = 0;
+        } else {
+            signals = {};
+            daisySignals = {};
+            aux1Signals = {};
+            aux2Signals = {};
+            soloSignals = {};
+            stemSignals = {};
+        }
+
         // Get inputs from this channel strip
         if (!muted || directOutsPremute) {
-            const float gain = params[CH_LVL_PARAM].getValue();
-            const float pan = params[PAN_PARAM].getValue();
-
             signals.channels = std::max(inputs[CH_INPUT_1].getChannels(), inputs[CH_INPUT_2].getChannels());
             if (solo && signals.channels == 0) {
                 // Force it to be one if this channel strip is solo so we pull
                 // in even blank input
                 signals.channels = 1;
             }
+        }
+
+        if (!idle && (!muted || directOutsPremute)) {
+            const float gain = params[CH_LVL_PARAM].getValue() * vcaLevel;
+            const float pan = params[PAN_PARAM].getValue();
 
             inputs[CH_INPUT_1].readVoltages(signals.voltages_l);
             if (inputs[CH_INPUT_2].isConnected()) {
@@ -216,21 +335,15 @@ struct DaisyChannel2 : Module {
                 inputs[CH_INPUT_1].readVoltages(signals.voltages_r);
             }
 
-            for (int c = 0; c < signals.channels; c++) {
-                signals.voltages_l[c] *= std::cos(M_PI * (pan + 1.0f) / 4.0f) * std::pow(gain, 2.f);
-                signals.voltages_r[c] *= std::sin(M_PI * (pan + 1.0f) / 4.0f) * std::pow(gain, 2.f);
+            float levels[16];
+            const bool cvConnected = inputs[LVL_CV_INPUT].isConnected();
+            if (cvConnected) {
+                float cv[16];
+                readPolyVoltages(inputs[LVL_CV_INPUT], cv, signals.channels);
+                levelSlewer.process(cv, levels, signals.channels, levelSlew);
             }
 
-            if (inputs[LVL_CV_INPUT].isConnected()) {
-                for (int c = 0; c < signals.channels; c++) {
-                    float _cv = clamp(inputs[LVL_CV_INPUT].getPolyVoltage(c) / 10.f, 0.f, 1.f);
-                    if (levelSlew) {
-                        _cv = levelSlewer[c].process(_cv);
-                    }
-                    signals.voltages_l[c] *= _cv;
-                    signals.voltages_r[c] *= _cv;
-                }
-            }
+            stripLevel(signals, gain, pan, cvConnected ? levels : nullptr);
         }
 
         // Set output for this channel strip
@@ -244,25 +357,79 @@ struct DaisyChannel2 : Module {
             signals = {};
         }
 
-        // Get daisy-chained data from left-side linked module
-        if (leftExpander.module && (
-                leftExpander.module->model == modelDaisyChannel2
-                || leftExpander.module->model == modelDaisyChannelVu
-                || leftExpander.module->model == modelDaisyChannelSends2
-                || leftExpander.module->model == modelDaisyBlank
-            )) {
-            const DaisyMessage* msgFromModule = static_cast<DaisyMessage*>(leftExpander.consumerMessage);
+        // Measuring, the direct outs carry only the ping and nothing from
+        // this strip goes along the chain
+        if (measureFrame < 0 && measureRequested.load()) {
+            measureFrame = 0;
+            pingFrame = 0;
+            pingPeak = 0.f;
+        }
+        if (measureFrame >= 0) {
+            outputs[CH_OUTPUT_1].setChannels(1);
+            outputs[CH_OUTPUT_1].setVoltage((measureFrame == 0) ? 10.f : 0.f);
+            outputs[CH_OUTPUT_2].setChannels(1);
+            outputs[CH_OUTPUT_2].setVoltage((measureFrame == 0) ? 10.f : 0.f);
+            signals = {};
+
+            if (measureFrame > 0 && peak > pingPeak) {
+                pingPeak = peak;
+                pingFrame = measureFrame;
+            }
+            // The ping takes a frame to reach the insert through its cable,
+            // as does the signal it stands in for
+            if (++measureFrame > DAISY_MAX_LATENCY + 1) {
+                measureFailed = pingPeak < PING_THRESHOLD;
+                if (!measureFailed) {
+                    latency = clamp(pingFrame - 1, 0, DAISY_MAX_LATENCY);
+                }
+                measureFrame = -1;
+                measureRequested.store(false);
+            }
+        }
+
+        // Delay this strip to line up with the latest along the chain
+        const int compensation = clamp(returned.latency - latency, 0, DAISY_MAX_LATENCY);
+        if (compensation != delayFrames || (idle && !wasIdle && !inputsSilent)) {
+            // A new tap starts out silent, so a change to the chain's latency
+            // is heard as a short gap rather than a repeat. Idled by a mute
+            // rather than by silence, the delay still holds the strip's last
+            // moments.
+            if (delayFrames > 0) {
+                delay.clear();
+            }
+            delayFrames = compensation;
+        }
+        if (!idle && delayFrames > 0) {
+            delay.process(signals, delayFrames);
+        }
 
-            daisySignals = msgFromModule->signals;
-            aux1Signals = msgFromModule->aux1Signals;
-            aux2Signals = msgFromModule->aux2Signals;
-            soloSignals = msgFromModule->soloSignals;
+        if (msgFromModule) {
+            if (idle) {
+                // The buses are silent, so only their channel counts matter
+                daisySignals.channels = msgFromModule->signals.channels;
+                aux1Signals.channels = msgFromModule->aux1Signals.channels;
+                aux2Signals.channels = msgFromModule->aux2Signals.channels;
+                soloSignals.channels = msgFromModule->soloSignals.channels;
+                stemSignals.channels = msgFromModule->stemSignals.channels;
+            } else {
+                daisySignals = msgFromModule->signals;
+                aux1Signals = msgFromModule->aux1Signals;
+                aux2Signals = msgFromModule->aux2Signals;
+                soloSignals = msgFromModule->soloSignals;
+                if (returned.stemBank >= 0) {
+                    stemSignals = msgFromModule->stemSignals;
+                }
+            }
 
-            firstPos = Vec(msgFromModule->first_pos_x, msgFromModule->first_pos_y);
-            channelStripId = msgFromModule->channel_strip_id;
+            if (msgFromModule->hasControl) {
+                control = daisyInputMessages.control.consumer(args.frame);
+            }
+            firstPos = Vec(control.first_pos_x, control.first_pos_y);
+            channelStripId = control.channel_strip_id;
 
             link_l = 0.8f;
         } else {
+            control = DaisyControl();
             channelStripId = 1;
             link_l = 0.0f;
         }
@@ -271,55 +438,94 @@ struct DaisyChannel2 : Module {
         daisySignals.channels = maxChannels;
 
         // Set daisy-chained output to right-side linked module
-        if (rightExpander.module && (
-                rightExpander.module->model == modelDaisyMaster2
-                || rightExpander.module->model == modelDaisyChannel2
-                || rightExpander.module->model == modelDaisyChannelVu
-                || rightExpander.module->model == modelDaisyChannelSends2
-                || rightExpander.module->model == modelDaisyBlank
-            )) {
+        const Module* right = rightExpander.module;
+        if (right && (isDaisyChainModule(right) || right->model == modelDaisyMaster2 || right->model == modelDaisyGroup
+                      || right->model == modelDaisyBridgeSend)) {
             DaisyMessage* msgToModule = static_cast<DaisyMessage*>(rightExpander.module->leftExpander.producerMessage);
 
-            // Write this module's output along to single voltages pipe
-            msgToModule->singleSignals = signals;
-
-            msgToModule->aux1Signals.channels = maxChannels;
-            msgToModule->aux2Signals.channels = maxChannels;
-
-            for (int c = 0; c < maxChannels; c++) {
-                // Combine this module's signal with daisy-chain
-                daisySignals.voltages_l[c] += signals.voltages_l[c] / DAISY_DIVISOR;
-                daisySignals.voltages_r[c] += signals.voltages_r[c] / DAISY_DIVISOR;
+            if (idle) {
+                // Zero both of the message buffers the engine swaps between,
+                // then leave their voltages alone
+                if (clearedModule != rightExpander.module) {
+                    clearedModule = rightExpander.module;
+                    clearedBuffers = 0;
+                }
+                if (clearedBuffers < 2) {
+                    msgToModule->signals = {};
+                    msgToModule->singleSignals = {};
+                    msgToModule->aux1Signals = {};
+                    msgToModule->aux2Signals = {};
+                    msgToModule->soloSignals = {};
+                    msgToModule->stemSignals = {};
+                    clearedBuffers++;
+                }
 
-                msgToModule->aux1Signals.voltages_l[c] = aux1Signals.voltages_l[c]
-                    + (aux1_send_amt * signals.voltages_l[c]);
-                msgToModule->aux1Signals.voltages_r[c] = aux1Signals.voltages_r[c]
-                    + (aux1_send_amt * signals.voltages_r[c]);
+                msgToModule->singleSignals.channels = signals.channels;
+                msgToModule->signals.channels = maxChannels;
+                msgToModule->aux1Signals.channels = maxChannels;
+                msgToModule->aux2Signals.channels = maxChannels;
+                msgToModule->soloSignals.channels = solo ? std::max(signals.channels, soloSignals.channels) : soloSignals.channels;
+                msgToModule->stemSignals.channels = (returned.stemBank >= 0) ? stemSignals.channels : 0;
+            } else {
+                // Write this module's output along to single voltages pipe
+                msgToModule->singleSignals = signals;
+
+                msgToModule->aux1Signals.channels = maxChannels;
+                msgToModule->aux2Signals.channels = maxChannels;
+
+                // Combine this module's signal with daisy-chain and aux sends
+                busSend(daisySignals, daisySignals, signals, 1.f / DAISY_DIVISOR, maxChannels);
+                busSend(msgToModule->aux1Signals, aux1Signals, signals, aux1_send_amt, maxChannels);
+                busSend(msgToModule->aux2Signals, aux2Signals, signals, aux2_send_amt, maxChannels);
+
+                // Write daisy-chain signal to producer message
+                msgToModule->signals.writeVoltages(daisySignals, maxChannels * 1);
+
+                if (solo) {
+                    // Sum the daisy received solo signals with this module's signals
+                    msgToModule->soloSignals.channels = std::max(signals.channels, soloSignals.channels);
+                    busSend(msgToModule->soloSignals, soloSignals, signals, 1.f, msgToModule->soloSignals.channels);
+                } else {
+                    msgToModule->soloSignals = soloSignals;
+                }
 
-                msgToModule->aux2Signals.voltages_l[c] = aux2Signals.voltages_l[c]
-                    + (aux2_send_amt * signals.voltages_l[c]);
-                msgToModule->aux2Signals.voltages_r[c] = aux2Signals.voltages_r[c]
-                    + (aux2_send_amt * signals.voltages_r[c]);
+                // This strip's stem, if it's in the bank D-MX2 wants
+                msgToModule->stemSignals.channels = 0;
+                if (returned.stemBank >= 0) {
+                    const int stem = channelStripId - 1 - returned.stemBank * DAISY_STEM_BANK_SIZE;
+                    if (stem >= 0 && stem < DAISY_STEM_BANK_SIZE) {
+                        for (int c = stemSignals.channels; c < stem; c++) {
+                            stemSignals.voltages_l[c] = 0.f;
+                            stemSignals.voltages_r[c] = 0.f;
+                        }
+                        stemSignals.voltages_l[stem] = 0.f;
+                        stemSignals.voltages_r[stem] = 0.f;
+                        for (int c = 0; c < signals.channels; c++) {
+                            stemSignals.voltages_l[stem] += signals.voltages_l[c];
+                            stemSignals.voltages_r[stem] += signals.voltages_r[c];
+                        }
+                        stemSignals.channels = std::max(stemSignals.channels, stem + 1);
+                    }
+                    msgToModule->stemSignals = stemSignals;
+                }
             }
-
-            // Write daisy-chain signal to producer message
-            msgToModule->signals.writeVoltages(daisySignals, maxChannels * 1);
-
-            if (solo) {
-                // Sum the daisy received solo signals with this module's signals
-                msgToModule->soloSignals.channels = std::max(signals.channels, soloSignals.channels);
-                for (int c = 0; c < msgToModule->soloSignals.channels; c++) {
-                    msgToModule->soloSignals.voltages_l[c] = soloSignals.voltages_l[c] + signals.voltages_l[c];
-                    msgToModule->soloSignals.voltages_r[c] = soloSignals.voltages_r[c] + signals.voltages_r[c];
+            msgToModule->silent = idle;
+
+            msgToModule->hasControl = controlFrame;
+            if (controlFrame) {
+                DaisyControl &controlToModule = msgToModule->controlMessage->producer(args.frame);
+                controlToModule = control;
+                controlToModule.channel_strip_id = channelStripId + 1;
+                controlToModule.first_pos_x = firstPos.x;
+                controlToModule.first_pos_y = firstPos.y;
+                controlToModule.mutedGroups = control.mutedGroups | (mutedHere ? muteGroupBit : 0);
+                controlToModule.latency = std::max(control.latency, latency);
+                if (vcaGroup > 0 && vcaLead) {
+                    controlToModule.vcaLevels[vcaGroup - 1] *= params[CH_LVL_PARAM].getValue();
                 }
-            } else {
-                msgToModule->soloSignals = soloSignals;
             }
 
-            msgToModule->first_pos_x = firstPos.x;
-            msgToModule->first_pos_y = firstPos.y;
-            msgToModule->channel_strip_id = channelStripId + 1;
-
+            messageCheck.stamp(*msgToModule, checkDaisyMessages.load(std::memory_order_relaxed));
             rightExpander.module->leftExpander.messageFlipRequested = true;
 
             link_r = 0.8f;
@@ -327,6 +533,8 @@ struct DaisyChannel2 : Module {
             link_r = 0.0f;
         }
 
+        sendDaisyReturn(this, controlFrame, returned);
+
         if (link_l > 0.0f || link_r > 0.0f) {
             label = std::to_string(channelStripId);
         } else {
@@ -462,110 +670,20 @@ struct DaisyDisplay : LedDisplay {
     }
 };
 
-/** Reads two adjacent lightIds, so `lightId` and `lightId + 1` must be defined */
-template <typename TBase = GrayModuleLightWidget>
-struct TRedGreenLight : TBase {
-    TRedGreenLight() {
-        this->addBaseColor(SCHEME_RED);
-        this->addBaseColor(SCHEME_GREEN);
-    }
-};
-using RedGreenLight = TRedGreenLight<>;
-
 /**
- * QuantalDualLatch
- *
- * A switch button that can have multiple states. The way to get to the max
- * state is to hold down the button for a few moments.
+ * Menu entry for a strip's insert latency, in samples
  */
-template <typename TLight>
-struct QuantalDualLatch : VCVLatch {
-    // Keep track of how long user kept mouse button down
-    int holdDuration = 0;
-
-    // Whether hold duration was long enough to trigger max latch state
-    bool holdSucceed = false;
-
-    app::ModuleLightWidget* light;
-
-    QuantalDualLatch() {
-        light = new TLight;
-        // Move center of light to center of box
-        light->box.pos = box.size.div(2).minus(light->box.size.div(2));
-        addChild(light);
-    }
-
-    app::ModuleLightWidget* getLight() {
-        return light;
-    }
-
-    /**
-     * When user starts clicking on latch
-     */
-    void onDragStart(const DragStartEvent& e) override {
-        if (e.button != GLFW_MOUSE_BUTTON_LEFT) {
-            return;
-        }
-    }
-
-    /**
-     * While user is holding down mouse button
-     */
-    void onDragMove(const DragMoveEvent& e) override {
-        holdDuration++;
-        if (!holdSucceed && holdDuration >= HOLD_TRIGGER_DURATION) {
-            engine::ParamQuantity* pq = getParamQuantity();
-            float oldValue = pq->getValue();
-            pq->setValue(VALUE_SOLO);
-            saveHistory(oldValue, pq);
-            holdSucceed = true;
-        }
-    }
-
-    /**
-     * When user stops mouse click on latch
-     */
-    void onDragEnd(const DragEndEvent& e) override {
-        SvgSwitch::onDragEnd(e);
-
-        if (e.button != GLFW_MOUSE_BUTTON_LEFT) {
-            return;
-        }
-
-        engine::ParamQuantity* pq = getParamQuantity();
-        if (pq && holdDuration < HOLD_TRIGGER_DURATION) {
-            // Don't do this logic if user JUST triggered hold state
-
-            float oldValue = pq->getValue();
-            if (pq->getValue() == VALUE_SOLO || pq->getValue() == VALUE_MUTE) {
-                // Going off mute or solo
-                pq->setValue(VALUE_OFF);
-            } else {
-                // Muting
-                pq->setValue(VALUE_MUTE);
-            }
-            saveHistory(oldValue, pq);
-        }
+struct LatencyField : ui::TextField {
+    DaisyChannel2* module;
 
-        holdDuration = 0;
-        holdSucceed = false;
+    explicit LatencyField(DaisyChannel2* module) : module(module) {
+        box.size.x = 120.f;
+        placeholder = "Samples";
+        setText(std::to_string(module->latency));
     }
 
-    /**
-     * Save history of param change (for undo/redo integration)
-     */
-    void saveHistory(float oldValue, ParamQuantity* pq) {
-        float newValue = pq->getValue();
-        if (oldValue != newValue) {
-            // Push ParamChange history action
-            history::ParamChange* h = new history::ParamChange;
-            h->name = "move switch";
-            h->moduleId = module->id;
-            h->paramId = paramId;
-            h->oldValue = oldValue;
-            h->newValue = newValue;
-            APP->history->push(h);
-        }
+    void onChange(const ChangeEvent& e) override {
+        module->latency = clamp(std::atoi(getText().c_str()), 0, DAISY_MAX_LATENCY);
     }
 };
 
@@ -646,6 +764,23 @@ struct DaisyChannelWidget2 : ModuleWidget {
         menu->addChild(new DaisyMenuSlider<SendQuantity, 2>(module)); // Aux send group 2
         menu->addChild(createBoolPtrMenuItem("Direct outs pre-mute", "", &module->directOutsPremute));
         menu->addChild(createBoolPtrMenuItem("Smooth level CV", "", &module->levelSlew));
+        menu->addChild(createIndexPtrSubmenuItem("Mute group", {"None", "A", "B", "C", "D"}, &module->muteGroup));
+        menu->addChild(createIndexPtrSubmenuItem("VCA group", {"None", "A", "B", "C", "D"}, &module->vcaGroup));
+        menu->addChild(createBoolPtrMenuItem("Lead VCA group", "", &module->vcaLead));
+
+        menu->addChild(new MenuSeparator);
+        menu->addChild(createMenuLabel("Insert latency (samples)"));
+        menu->addChild(new LatencyField(module));
+        menu->addChild(createMenuItem("Measure insert latency", module->measureFailed ? "No ping heard" : "", [ = ]() {
+            module->measureRequested = true;
+        }, module->measureRequested.load()));
+        const int compensation = std::max(module->returned.latency - module->latency, 0);
+        menu->addChild(createMenuLabel(string::f("Delayed to match chain: %d samples", compensation)));
+
+        menu->addChild(new MenuSeparator);
+        menu->addChild(createMenuLabel(string::f("DSP kernels: %s", kernels->name)));
+
+        appendMessageCheckMenu(menu, &module->messageCheck);
     }
 
     /**
@@ -656,7 +791,8 @@ struct DaisyChannelWidget2 : ModuleWidget {
             if (e.keyName[0] == 'm') {
                 DaisyChannel2 *module = getModule<DaisyChannel2>();
                 // Toggle mute
-                module->params[DaisyChannel2::MUTE_PARAM].setValue(module->muted ? VALUE_OFF : VALUE_MUTE);
+                const bool mutedHere = module->params[DaisyChannel2::MUTE_PARAM].getValue() > VALUE_OFF;
+                module->params[DaisyChannel2::MUTE_PARAM].setValue(mutedHere ? VALUE_OFF : VALUE_MUTE);
                 e.consume(this);
             }
             if (e.keyName[0] == 's') {
@@ -670,4 +806,33 @@ struct DaisyChannelWidget2 : ModuleWidget {
     }
 };
 
+DaisyMigration getDaisyChannel2Migration() {
+    DaisyMigration migration;
+    migration.signalInput = DaisyChannel2::CH_INPUT_1;
+    migration.levelCvInput = DaisyChannel2::LVL_CV_INPUT;
+    migration.signalOutput = DaisyChannel2::CH_OUTPUT_1;
+    return migration;
+}
+
+quantal::StripSettings getDaisyStripSettings(Module* strip) {
+    DaisyChannel2* channel = static_cast<DaisyChannel2*>(strip);
+    quantal::StripSettings settings;
+    settings.level = channel->params[DaisyChannel2::CH_LVL_PARAM].getValue();
+    settings.pan = channel->params[DaisyChannel2::PAN_PARAM].getValue();
+    settings.muted = channel->params[DaisyChannel2::MUTE_PARAM].getValue() > VALUE_OFF;
+    settings.solo = channel->params[DaisyChannel2::MUTE_PARAM].getValue() < VALUE_OFF;
+    settings.aux1 = channel->aux1_send_amt;
+    settings.aux2 = channel->aux2_send_amt;
+    return settings;
+}
+
+void setDaisyStripSettings(Module* strip, const quantal::StripSettings &settings) {
+    DaisyChannel2* channel = static_cast<DaisyChannel2*>(strip);
+    channel->params[DaisyChannel2::CH_LVL_PARAM].setValue(settings.level);
+    channel->params[DaisyChannel2::PAN_PARAM].setValue(settings.pan);
+    channel->params[DaisyChannel2::MUTE_PARAM].setValue(settings.solo ? VALUE_SOLO : (settings.muted ? VALUE_MUTE : VALUE_OFF));
+    channel->aux1_send_amt = settings.aux1;
+    channel->aux2_send_amt = settings.aux2;
+}
+
 Model* modelDaisyChannel2 = createModel<DaisyChannel2, DaisyChannelWidget2>("DaisyChannel2");
@@ -33,16 +33,24 @@ struct DaisyChannelSends2 : Module {
     Vec widgetPos;
 
     dsp::ClockDivider lightDivider;
+    dsp::ClockDivider controlDivider;
     dsp::SchmittTrigger groupChangeTrigger;
 
-    DaisyMessage daisyInputMessage[2][1];
-    DaisyMessage daisyOutputMessage[2][1];
+    // Control data last received from the left, and the chain's return
+    // from the right
+    DaisyControl control;
+    DaisyReturn returned;
+
+    DaisyInputMessages daisyInputMessages;
+    ExpanderMessages<DaisyReturnMessage> daisyReturnMessages;
+    MessageCheck messageCheck;
 
     StereoVoltages daisySignals = {};
     StereoVoltages auxSignals = {};
     StereoVoltages aux1Signals = {};
     StereoVoltages aux2Signals = {};
     StereoVoltages soloSignals = {};
+    StereoVoltages stemSignals = {};
 
     DaisyChannelSends2() {
         config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
@@ -56,12 +64,13 @@ struct DaisyChannelSends2 : Module {
         configLight(LINK_LIGHT_R, "Daisy chain link output");
 
         // Set the expander messages
-        leftExpander.producerMessage = &daisyInputMessage[0];
-        leftExpander.consumerMessage = &daisyInputMessage[1];
-        rightExpander.producerMessage = &daisyOutputMessage[0];
-        rightExpander.consumerMessage = &daisyOutputMessage[1];
+        leftExpander.producerMessage = daisyInputMessages.producer();
+        leftExpander.consumerMessage = daisyInputMessages.consumer();
+        rightExpander.producerMessage = daisyReturnMessages.producer();
+        rightExpander.consumerMessage = daisyReturnMessages.consumer();
 
         lightDivider.setDivision(DAISY_LIGHT_DIVISION);
+        controlDivider.setDivision(DAISY_CONTROL_DIVISION);
     }
 
     json_t* dataToJson() override {
@@ -91,10 +100,12 @@ struct DaisyChannelSends2 : Module {
         aux1Signals = {};
         aux2Signals = {};
         soloSignals = {};
+        stemSignals = {};
+
+        const bool controlFrame = controlDivider.process();
 
-        // Assume this module is the first in the chain; it will get
-        // overwritten if we receive a value from the left expander
-        Vec firstPos = widgetPos;
+        // The buses are silent unless the chain carries them here
+        bool silent = true;
 
         bool groupButton = params[GROUP_PARAM].getValue() > 0.f;
         if (groupChangeTrigger.process(params[GROUP_PARAM].getValue())) {
@@ -105,13 +116,10 @@ struct DaisyChannelSends2 : Module {
         }
 
         // Get daisy-chained data from left-side linked module
-        if (leftExpander.module && (
-                leftExpander.module->model == modelDaisyChannel2
-                || leftExpander.module->model == modelDaisyChannelVu
-                || leftExpander.module->model == modelDaisyChannelSends2
-                || leftExpander.module->model == modelDaisyBlank
-            )) {
+        if (leftExpander.module && (isDaisyChainModule(leftExpander.module)
+                                    || leftExpander.module->model == modelDaisyBridgeReceive)) {
             DaisyMessage* msgFromModule = static_cast<DaisyMessage*>(leftExpander.consumerMessage);
+            messageCheck.check(*msgFromModule, leftExpander.module);
 
             daisySignals = msgFromModule->signals;
             aux1Signals = msgFromModule->aux1Signals;
@@ -124,34 +132,42 @@ struct DaisyChannelSends2 : Module {
             }
 
             soloSignals = msgFromModule->soloSignals;
+            stemSignals = msgFromModule->stemSignals;
+            silent = msgFromModule->silent;
 
-            firstPos = Vec(msgFromModule->first_pos_x, msgFromModule->first_pos_y);
-            channelStripId = msgFromModule->channel_strip_id;
+            if (msgFromModule->hasControl) {
+                control = daisyInputMessages.control.consumer(args.frame);
+            }
+            channelStripId = control.channel_strip_id;
 
             link_l = 0.8f;
         } else {
+            // The first in the chain starts the control data
+            control = DaisyControl();
+            control.first_pos_x = widgetPos.x;
+            control.first_pos_y = widgetPos.y;
             channelStripId = 1;
             link_l = 0.0f;
         }
 
         // Set daisy-chained output to right-side linked module
-        if (rightExpander.module && (
-                rightExpander.module->model == modelDaisyMaster2
-                || rightExpander.module->model == modelDaisyChannel2
-                || rightExpander.module->model == modelDaisyChannelVu
-                || rightExpander.module->model == modelDaisyChannelSends2
-                || rightExpander.module->model == modelDaisyBlank
-            )) {
+        if (rightExpander.module && (isDaisyChainModule(rightExpander.module)
+                                     || rightExpander.module->model == modelDaisyMaster2
+                                     || rightExpander.module->model == modelDaisyGroup
+                                     || rightExpander.module->model == modelDaisyBridgeSend)) {
             DaisyMessage* msgToModule = static_cast<DaisyMessage*>(rightExpander.module->leftExpander.producerMessage);
 
             msgToModule->signals = daisySignals;
             msgToModule->aux1Signals = aux1Signals;
             msgToModule->aux2Signals = aux2Signals;
             msgToModule->soloSignals = soloSignals;
+            msgToModule->stemSignals = stemSignals;
+            msgToModule->silent = silent;
 
-            msgToModule->first_pos_x = firstPos.x;
-            msgToModule->first_pos_y = firstPos.y;
-            msgToModule->channel_strip_id = channelStripId;
+            msgToModule->hasControl = controlFrame;
+            if (controlFrame) {
+                msgToModule->controlMessage->producer(args.frame) = control;
+            }
 
             link_r = 0.8f;
         } else {
@@ -166,9 +182,13 @@ struct DaisyChannelSends2 : Module {
         }
 
         if (rightExpander.module && link_r > 0.0f) {
+            messageCheck.stamp(*static_cast<DaisyMessage*>(rightExpander.module->leftExpander.producerMessage), checkDaisyMessages.load(std::memory_order_relaxed));
             rightExpander.module->leftExpander.messageFlipRequested = true;
         }
 
+        receiveDaisyReturn(this, returned);
+        sendDaisyReturn(this, controlFrame, returned);
+
         // Set aggregated decoded output
         outputs[CH_OUTPUT_1].setChannels(auxSignals.channels);
         outputs[CH_OUTPUT_1].writeVoltages(auxSignals.voltages_l);
@@ -234,6 +254,12 @@ struct DaisyChannelSendsWidget2 : ModuleWidget {
 
         ModuleWidget::step();
     }
+
+    void appendContextMenu(Menu *menu) override {
+        DaisyChannelSends2 *module = getModule<DaisyChannelSends2>();
+
+        appendMessageCheckMenu(menu, &module->messageCheck);
+    }
 };
 
 Model* modelDaisyChannelSends2 = createModel<DaisyChannelSends2, DaisyChannelSendsWidget2>("DaisyChannelSends2");
@@ -37,10 +37,17 @@ struct DaisyChannelVu : Module {
     Vec widgetPos;
 
     dsp::ClockDivider lightDivider;
+    dsp::ClockDivider controlDivider;
     dsp::VuMeter2 vuMeter[2];
 
-    DaisyMessage daisyInputMessage[2][1];
-    DaisyMessage daisyOutputMessage[2][1];
+    // Control data last received from the left, and the chain's return
+    // from the right
+    DaisyControl control;
+    DaisyReturn returned;
+
+    DaisyInputMessages daisyInputMessages;
+    ExpanderMessages<DaisyReturnMessage> daisyReturnMessages;
+    MessageCheck messageCheck;
 
     DaisyChannelVu() {
         config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
@@ -49,12 +56,13 @@ struct DaisyChannelVu : Module {
         configLight(LINK_LIGHT_R, "Daisy chain link output");
 
         // Set the expander messages
-        leftExpander.producerMessage = &daisyInputMessage[0];
-        leftExpander.consumerMessage = &daisyInputMessage[1];
-        rightExpander.producerMessage = &daisyOutputMessage[0];
-        rightExpander.consumerMessage = &daisyOutputMessage[1];
+        leftExpander.producerMessage = daisyInputMessages.producer();
+        leftExpander.consumerMessage = daisyInputMessages.consumer();
+        rightExpander.producerMessage = daisyReturnMessages.producer();
+        rightExpander.consumerMessage = daisyReturnMessages.consumer();
 
         lightDivider.setDivision(DAISY_LIGHT_DIVISION);
+        controlDivider.setDivision(DAISY_CONTROL_DIVISION);
     }
 
     void setWidgetPosition(Vec pos) {
@@ -62,20 +70,15 @@ struct DaisyChannelVu : Module {
     }
 
     void process(const ProcessArgs &args) override {
-
-        // Assume this module is the first in the chain; it will get
-        // overwritten if we receive a value from the left expander
-        Vec firstPos = widgetPos;
+        const bool controlFrame = controlDivider.process();
 
         // Get daisy-chained data from left-side linked module
-        if (leftExpander.module && (
-                leftExpander.module->model == modelDaisyChannel2
-                || leftExpander.module->model == modelDaisyChannelVu
-                || leftExpander.module->model == modelDaisyChannelSends2
-                || leftExpander.module->model == modelDaisyMaster2
-                || leftExpander.module->model == modelDaisyBlank
-            )) {
+        if (leftExpander.module && (isDaisyChainModule(leftExpander.module)
+                                    || leftExpander.module->model == modelDaisyMaster2
+                                    || leftExpander.module->model == modelDaisyGroup
+                                    || leftExpander.module->model == modelDaisyBridgeReceive)) {
             const DaisyMessage* msgFromModule = static_cast<DaisyMessage*>(leftExpander.consumerMessage);
+            messageCheck.check(*msgFromModule, leftExpander.module);
 
             // Use the single channel to display in VU meter
             vuMeter[0].process(
@@ -87,28 +90,31 @@ struct DaisyChannelVu : Module {
                 getVoltageSum(msgFromModule->singleSignals.channels, msgFromModule->singleSignals.voltages_r) / 10.f
             );
 
-            firstPos = Vec(msgFromModule->first_pos_x, msgFromModule->first_pos_y);
-            channelStripId = msgFromModule->channel_strip_id;
+            if (msgFromModule->hasControl) {
+                control = daisyInputMessages.control.consumer(args.frame);
+            }
+            channelStripId = control.channel_strip_id;
 
             // Set daisy-chained output to right-side linked module
-            if (rightExpander.module && (
-                    rightExpander.module->model == modelDaisyMaster2
-                    || rightExpander.module->model == modelDaisyChannel2
-                    || rightExpander.module->model == modelDaisyChannelVu
-                    || rightExpander.module->model == modelDaisyChannelSends2
-                    || rightExpander.module->model == modelDaisyBlank
-                )) {
+            if (rightExpander.module && (isDaisyChainModule(rightExpander.module)
+                                         || rightExpander.module->model == modelDaisyMaster2
+                                         || rightExpander.module->model == modelDaisyGroup
+                                         || rightExpander.module->model == modelDaisyBridgeSend)) {
                 DaisyMessage* msgToModule = static_cast<DaisyMessage*>(rightExpander.module->leftExpander.producerMessage);
 
                 msgToModule->signals = msgFromModule->signals;
                 msgToModule->aux1Signals = msgFromModule->aux1Signals;
                 msgToModule->aux2Signals = msgFromModule->aux2Signals;
                 msgToModule->soloSignals = msgFromModule->soloSignals;
+                msgToModule->stemSignals = msgFromModule->stemSignals;
+                msgToModule->silent = msgFromModule->silent;
 
-                msgToModule->first_pos_x = firstPos.x;
-                msgToModule->first_pos_y = firstPos.y;
-                msgToModule->channel_strip_id = channelStripId;
+                msgToModule->hasControl = controlFrame;
+                if (controlFrame) {
+                    msgToModule->controlMessage->producer(args.frame) = control;
+                }
 
+                messageCheck.stamp(*msgToModule, checkDaisyMessages.load(std::memory_order_relaxed));
                 rightExpander.module->leftExpander.messageFlipRequested = true;
             }
 
@@ -116,18 +122,19 @@ struct DaisyChannelVu : Module {
         } else {
             vuMeter[0].process(args.sampleTime, 0.0f);
             vuMeter[1].process(args.sampleTime, 0.0f);
+            control = DaisyControl();
             channelStripId = 1;
             link_l = 0.0f;
         }
 
+        receiveDaisyReturn(this, returned);
+        sendDaisyReturn(this, controlFrame, returned);
+
         // Make sure link light to the right is correct
-        if (rightExpander.module && (
-                rightExpander.module->model == modelDaisyMaster2
-                || rightExpander.module->model == modelDaisyChannel2
-                || rightExpander.module->model == modelDaisyChannelVu
-                || rightExpander.module->model == modelDaisyChannelSends2
-                || rightExpander.module->model == modelDaisyBlank
-            )) {
+        if (rightExpander.module && (isDaisyChainModule(rightExpander.module)
+                                     || rightExpander.module->model == modelDaisyMaster2
+                                     || rightExpander.module->model == modelDaisyGroup
+                                     || rightExpander.module->model == modelDaisyBridgeSend)) {
             link_r = 0.8f;
         } else {
             link_r = 0.0f;
@@ -198,6 +205,12 @@ struct DaisyChannelVuWidget : ModuleWidget {
 
         ModuleWidget::step();
     }
+
+    void appendContextMenu(Menu *menu) override {
+        DaisyChannelVu *module = getModule<DaisyChannelVu>();
+
+        appendMessageCheckMenu(menu, &module->messageCheck);
+    }
 };
 
 Model* modelDaisyChannelVu = createModel<DaisyChannelVu, DaisyChannelVuWidget>("DaisyChannelVu");
@@ -0,0 +1,300 @@
+#include "QuantalAudio.hpp"
+#include "Daisy.hpp"
+
+// Deepest nesting of groups followed when working out the latency, which
+// also stops a loop of groups feeding each other
+constexpr int MAX_GROUP_DEPTH = 16;
+
+struct DaisyGroup : Module {
+    enum ParamIds {
+        GROUP_LVL_PARAM,
+        MUTE_PARAM,
+        NUM_PARAMS
+    };
+    enum InputIds {
+        GROUP_CV_INPUT,
+        NUM_INPUTS
+    };
+    enum OutputIds {
+        GROUP_OUTPUT_1, // Left
+        GROUP_OUTPUT_2, // Right
+        NUM_OUTPUTS
+    };
+    enum LightsIds {
+        MUTE_LIGHT,
+        MUTE2_LIGHT,
+        LINK_LIGHT_L,
+        NUM_LIGHTS
+    };
+
+    // Groups soloed across the patch; while there are any, the others are
+    // silent
+    static std::atomic<int> soloedGroups;
+
+    bool muted = false;
+    bool solo = false;
+    bool levelSlew = true;
+    float link_l = 0.f;
+
+    dsp::ClockDivider lightDivider;
+    dsp::ClockDivider controlDivider;
+
+    // Control data last received from the chain
+    DaisyControl control;
+
+    DaisyInputMessages daisyMessages;
+    MessageCheck messageCheck;
+    PolySlewer levelSlewer;
+    // Fades the group out and back in when it's muted or silenced by a solo
+    GainSlewer muteSlewer;
+    StereoVoltages signals = {};
+    StereoVoltages soloSignals = {};
+
+    DaisyGroup() {
+        config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
+        configParam(GROUP_LVL_PARAM, 0.0f, 2.0f, 1.0f, "Group level", " dB", -10, 20);
+        configSwitch(MUTE_PARAM, VALUE_SOLO, VALUE_MUTE, VALUE_OFF, "Mute", {"Solo", "Not muted", "Muted"});
+
+        configInput(GROUP_CV_INPUT, "Level CV");
+        configOutput(GROUP_OUTPUT_1, "Group L");
+        configOutput(GROUP_OUTPUT_2, "Group R");
+
+        configLight(LINK_LIGHT_L, "Daisy chain link input");
+
+        levelSlewer.setSlewSpeed(SLEW_SPEED, APP->engine->getSampleRate());
+        muteSlewer.setSlewSpeed(SLEW_SPEED, APP->engine->getSampleRate());
+
+        // Set the left expander message instances
+        leftExpander.producerMessage = daisyMessages.producer();
+        leftExpander.consumerMessage = daisyMessages.consumer();
+
+        lightDivider.setDivision(DAISY_LIGHT_DIVISION);
+        controlDivider.setDivision(DAISY_CONTROL_DIVISION);
+    }
+
+    ~DaisyGroup() override {
+        if (solo) {
+            soloedGroups--;
+        }
+    }
+
+    json_t* dataToJson() override {
+        json_t* rootJ = json_object();
+
+        json_object_set_new(rootJ, "level_slew", json_boolean(levelSlew));
+
+        return rootJ;
+    }
+
+    void dataFromJson(json_t* rootJ) override {
+        // level slew
+        const json_t* levelSlewJ = json_object_get(rootJ, "level_slew");
+        if (levelSlewJ) {
+            levelSlew = json_is_true(levelSlewJ);
+        }
+    }
+
+    /**
+     * When user resets this module
+     */
+    void onReset() override {
+        levelSlew = true;
+    }
+
+    void onSampleRateChange() override {
+        levelSlewer.setSlewSpeed(SLEW_SPEED, APP->engine->getSampleRate());
+        muteSlewer.setSlewSpeed(SLEW_SPEED, APP->engine->getSampleRate());
+    }
+
+    /**
+     * Frames the furthest signal in this group takes to reach its outputs
+     *
+     * Each module along the chain adds a frame. A strip patched from another
+     * group's outputs adds that group's latency plus a frame for the cable,
+     * so the result covers the whole tree of groups below this one. A bridge
+     * adds its latency and carries on from its send. Walks the chain and
+     * the patch's cables, so only call from the UI thread.
+     */
+    int getLatency() {
+        std::vector<Cable*> groupCables;
+        for (int64_t cableId : APP->engine->getCableIds()) {
+            Cable* cable = APP->engine->getCable(cableId);
+            if (cable && cable->outputModule && cable->outputModule->model == modelDaisyGroup) {
+                groupCables.push_back(cable);
+            }
+        }
+        return getLatency(groupCables, 0);
+    }
+
+    int getLatency(const std::vector<Cable*> &groupCables, int depth) {
+        int latency = 0;
+        int hops = 1;
+        int bridges = 0;
+        for (Module* m = leftExpander.module; m; m = m->leftExpander.module, hops++) {
+            // A bridge carries on the chain from its send, in another row;
+            // there are only so many to cross without going round a loop
+            while (m && m->model == modelDaisyBridgeReceive && bridges++ < DAISY_BRIDGE_IDS) {
+                Module* send = findDaisyBridgeSend(m);
+                m = send ? send->leftExpander.module : nullptr;
+                hops += DAISY_BRIDGE_LATENCY + 1;
+            }
+            if (!m || !isDaisyChainModule(m)) {
+                break;
+            }
+            latency = std::max(latency, hops);
+            if (depth >= MAX_GROUP_DEPTH) {
+                continue;
+            }
+            for (Cable* cable : groupCables) {
+                if (cable->inputModule == m && cable->outputModule != this) {
+                    DaisyGroup* group = static_cast<DaisyGroup*>(cable->outputModule);
+                    latency = std::max(latency, hops + 1 + group->getLatency(groupCables, depth + 1));
+                }
+            }
+        }
+        return latency;
+    }
+
+    void process(const ProcessArgs &args) override {
+        muted = params[MUTE_PARAM].getValue() > VALUE_OFF;
+
+        const bool soloNow = params[MUTE_PARAM].getValue() < VALUE_OFF;
+        if (soloNow != solo) {
+            soloedGroups += soloNow ? 1 : -1;
+            solo = soloNow;
+        }
+
+        signals = {};
+        soloSignals = {};
+
+        // Get daisy-chained data from left-side linked module
+        const bool controlFrame = controlDivider.process();
+        if (leftExpander.module && (isDaisyChainModule(leftExpander.module)
+                                    || leftExpander.module->model == modelDaisyBridgeReceive)) {
+            const DaisyMessage* msgFromExpander = static_cast<DaisyMessage*>(leftExpander.consumerMessage);
+            messageCheck.check(*msgFromExpander, leftExpander.module);
+
+            signals = msgFromExpander->signals;
+            soloSignals = msgFromExpander->soloSignals;
+            if (msgFromExpander->hasControl) {
+                control = daisyMessages.control.consumer(args.frame);
+            }
+
+            link_l = 0.8f;
+        } else {
+            control = DaisyControl();
+            link_l = 0.0f;
+        }
+
+        // The mute groups and worst latency go back along the chain; they
+        // end at the group
+        sendDaisyReturn(this, controlFrame, DaisyReturn(control));
+
+        // Muted, or silenced by another group's solo, the outputs fade to
+        // 0V and keep the chain's channel count
+        const bool silenced = muted || (!solo && soloedGroups > 0);
+        const float gain = params[GROUP_LVL_PARAM].getValue() * muteSlewer.process(silenced ? 0.f : 1.f);
+
+        // A strip soloed within the group replaces the group's mix
+        StereoVoltages &bus = (soloSignals.channels > 0) ? soloSignals : signals;
+        const float scale = (soloSignals.channels > 0) ? 1.f : DAISY_DIVISOR;
+
+        float levels[16];
+        const bool cvConnected = inputs[GROUP_CV_INPUT].isConnected();
+        if (cvConnected) {
+            float cv[16];
+            readPolyVoltages(inputs[GROUP_CV_INPUT], cv, bus.channels);
+            levelSlewer.process(cv, levels, bus.channels, levelSlew);
+        }
+        busOutput(bus, scale, gain, cvConnected ? levels : nullptr);
+
+        outputs[GROUP_OUTPUT_1].setChannels(bus.channels);
+        outputs[GROUP_OUTPUT_1].writeVoltages(bus.voltages_l);
+        outputs[GROUP_OUTPUT_2].setChannels(bus.channels);
+        outputs[GROUP_OUTPUT_2].writeVoltages(bus.voltages_r);
+
+        // Set output to right-side linked VU meter module
+        if (rightExpander.module && rightExpander.module->model == modelDaisyChannelVu) {
+            DaisyMessage* msgToModule = static_cast<DaisyMessage*>(rightExpander.module->leftExpander.producerMessage);
+            msgToModule->singleSignals = bus;
+            msgToModule->hasControl = false;
+            messageCheck.stamp(*msgToModule, checkDaisyMessages.load(std::memory_order_relaxed));
+            rightExpander.module->leftExpander.messageFlipRequested = true;
+        }
+
+        // Set lights
+        if (lightDivider.process()) {
+            lights[MUTE_LIGHT].value = (muted);
+            lights[MUTE2_LIGHT].value = (solo);
+            lights[LINK_LIGHT_L].setBrightness(link_l);
+        }
+    }
+};
+
+std::atomic<int> DaisyGroup::soloedGroups{0};
+
+struct DaisyGroupWidget : ModuleWidget {
+    explicit DaisyGroupWidget(DaisyGroup *module) {
+        setModule(module);
+        setPanel(
+            createPanel(
+                asset::plugin(pluginInstance, "res/DaisyGroup.svg"),
+                asset::plugin(pluginInstance, "res/DaisyGroup-dark.svg")
+            )
+        );
+
+        // Screws
+        addChild(createWidget<ThemedScrew>(Vec(RACK_GRID_WIDTH, 0)));
+        addChild(createWidget<ThemedScrew>(Vec(box.size.x - 2 * RACK_GRID_WIDTH, 0)));
+        addChild(createWidget<ThemedScrew>(Vec(RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
+        addChild(createWidget<ThemedScrew>(Vec(box.size.x - 2 * RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
+
+        // Level & CV
+        addParam(createParam<RoundLargeBlackKnob>(Vec(RACK_GRID_WIDTH * 1.5f - (36.0f / 2), 52.0), module, DaisyGroup::GROUP_LVL_PARAM));
+        addInput(createInput<ThemedPJ301MPort>(Vec(RACK_GRID_WIDTH * 1.5f - (25.0f / 2), 96.0), module, DaisyGroup::GROUP_CV_INPUT));
+
+        // Mute, or hold for solo
+        addParam(createLightParam<QuantalDualLatch<MediumSimpleLight<RedGreenLight>>>(Vec(RACK_GRID_WIDTH * 1.5f - 9.0f, 254.0), module, DaisyGroup::MUTE_PARAM, DaisyGroup::MUTE_LIGHT));
+
+        // Group output
+        addOutput(createOutput<ThemedPJ301MPort>(Vec((RACK_GRID_WIDTH * 1.5f) - (25.0f / 2), 290.0), module, DaisyGroup::GROUP_OUTPUT_1));
+        addOutput(createOutput<ThemedPJ301MPort>(Vec((RACK_GRID_WIDTH * 1.5f) - (25.0f / 2), 316.0), module, DaisyGroup::GROUP_OUTPUT_2));
+
+        // Link light
+        addChild(createLightCentered<TinyLight<YellowLight>>(Vec(RACK_GRID_WIDTH - 6, 361.0), module, DaisyGroup::LINK_LIGHT_L));
+    }
+
+    void appendContextMenu(Menu *menu) override {
+        DaisyGroup* module = getModule<DaisyGroup>();
+
+        menu->addChild(new MenuSeparator);
+        menu->addChild(createBoolPtrMenuItem("Smooth level CV", "", &module->levelSlew));
+
+        menu->addChild(new MenuSeparator);
+        const int latency = module->getLatency();
+        menu->addChild(createMenuLabel(string::f("Latency: %d samples (%.2f ms)", latency,
+                                       1000.f * latency / APP->engine->getSampleRate())));
+
+        appendMessageCheckMenu(menu, &module->messageCheck);
+    }
+
+    void onHoverKey(const HoverKeyEvent& e) override {
+        if (e.action == GLFW_RELEASE) {
+            if (e.keyName[0] == 'm') {
+                DaisyGroup *module = getModule<DaisyGroup>();
+                // Toggle mute
+                module->params[DaisyGroup::MUTE_PARAM].setValue(module->muted ? VALUE_OFF : VALUE_MUTE);
+                e.consume(this);
+            }
+            if (e.keyName[0] == 's') {
+                DaisyGroup *module = getModule<DaisyGroup>();
+                // Toggle solo
+                module->params[DaisyGroup::MUTE_PARAM].setValue(module->solo ? VALUE_OFF : VALUE_SOLO);
+                e.consume(this);
+            }
+        }
+        ModuleWidget::onHoverKey(e);
+    }
+};
+
+Model* modelDaisyGroup = createModel<DaisyGroup, DaisyGroupWidget>("DaisyGroup");
@@ -117,6 +117,25 @@ struct DaisyMasterWidget : ModuleWidget {
         // Chain input
         addInput(createInput<ThemedPJ301MPort>(Vec((RACK_GRID_WIDTH * 1.5f) - (25.0f / 2), 290.5), module, DaisyMaster::CHAIN_INPUT));
     }
+
+    void appendContextMenu(Menu *menu) override {
+        DaisyMaster* module = getModule<DaisyMaster>();
+
+        menu->addChild(new MenuSeparator);
+        menu->addChild(createMenuItem("Migrate chain to Daisy Mix 2", "", [ = ]() {
+            migrateDaisyChain(module);
+        }));
+    }
 };
 
+DaisyMigration getDaisyMasterMigration(Module* master) {
+    DaisyMigration migration;
+    migration.level = master->params[DaisyMaster::MIX_LVL_PARAM].getValue();
+    migration.muted = static_cast<DaisyMaster*>(master)->muted;
+    migration.levelCvInput = DaisyMaster::MIX_CV_INPUT;
+    migration.signalOutput = DaisyMaster::MIX_OUTPUT;
+    migration.chainInput = DaisyMaster::CHAIN_INPUT;
+    return migration;
+}
+
 Model* modelDaisyMaster = createModel<DaisyMaster, DaisyMasterWidget>("DaisyMaster");
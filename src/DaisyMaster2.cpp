@@ -1,21 +1,24 @@
 #include "QuantalAudio.hpp"
 #include "Daisy.hpp"
-
-constexpr float SLEW_SPEED = 6.f; // For smoothing out CV
+#include "Recorder.hpp"
 
 struct DaisyMaster2 : Module {
     enum ParamIds {
         MIX_LVL_PARAM,
         MUTE_PARAM,
+        MORPH_PARAM,
         NUM_PARAMS
     };
     enum InputIds {
         MIX_CV_INPUT,
+        MORPH_CV_INPUT,
         NUM_INPUTS
     };
     enum OutputIds {
         MIX_OUTPUT_1, // Left
         MIX_OUTPUT_2, // Right
+        STEM_OUTPUT_1, // Left
+        STEM_OUTPUT_2, // Right
         NUM_OUTPUTS
     };
     enum LightsIds {
@@ -28,9 +31,17 @@ struct DaisyMaster2 : Module {
     float link_l = 0.f;
     bool levelSlew = true;
 
+    // Bank of DAISY_STEM_BANK_SIZE strips on the stem outputs, from 0 for
+    // strips 1 to 16
+    int stemBank = 0;
+
     Vec widgetPos;
 
     dsp::ClockDivider lightDivider;
+    dsp::ClockDivider controlDivider;
+
+    // Control data last received from the chain
+    DaisyControl control;
 
     enum DaisyModelIds {
         CHANNEL_2,
@@ -41,31 +52,58 @@ struct DaisyMaster2 : Module {
     };
     Model* daisyModels[NUM_MODELS] {};
 
-    DaisyMessage daisyMessages[2][1];
-    SimpleSlewer levelSlewer[16];
+    DaisyInputMessages daisyMessages;
+    MessageCheck messageCheck;
+    PolySlewer levelSlewer;
     StereoVoltages signals = {};
     StereoVoltages soloSignals = {};
 
+    // Mixer scenes of the strips along the chain, only touched from the UI
+    // thread
+    std::vector<quantal::MixerScene> scenes;
+    // Scenes the morph control crossfades between, or -1 for none
+    int morphFrom = -1;
+    int morphTo = -1;
+
+    // Crossfade in use by the audio thread
+    std::atomic<quantal::SceneMorph*> sceneMorph{nullptr};
+    bool sceneMorphChanged = false;
+    uint32_t sceneMorphGeneration = 0;
+    // Counts process() calls, so the UI thread knows when a replaced morph is
+    // no longer in use
+    std::atomic<uint32_t> processedFrames{0};
+    quantal::SceneMorph* retiredSceneMorph = nullptr;
+    uint32_t retiredAtFrame = 0;
+    // Morph and position last set on the strips
+    uint32_t morphedGeneration = 0;
+    float morphedPosition = 0.f;
+
+    // Developer mode workload recording
+    ModuleRecorder recorder;
+
     DaisyMaster2() {
         config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
         configParam(MIX_LVL_PARAM, 0.0f, 2.0f, 1.0f, "Mix level", " dB", -10, 20);
         configSwitch(MUTE_PARAM, 0.f, 1.f, 0.f, "Mute", {"Not muted", "Muted"});
+        configParam(MORPH_PARAM, 0.f, 1.f, 0.f, "Scene morph", "%", 0.f, 100.f);
 
         configInput(MIX_CV_INPUT, "Level CV");
+        configInput(MORPH_CV_INPUT, "Scene morph CV");
         configOutput(MIX_OUTPUT_1, "Mix L");
         configOutput(MIX_OUTPUT_2, "Mix R");
+        configOutput(STEM_OUTPUT_1, "Stems L");
+        configOutput(STEM_OUTPUT_2, "Stems R");
 
         configLight(LINK_LIGHT_L, "Daisy chain link input");
 
-        for (int c = 0; c < 16; c++) {
-            levelSlewer[c].setSlewSpeed(SLEW_SPEED);
-        }
+        levelSlewer.setSlewSpeed(SLEW_SPEED, APP->engine->getSampleRate());
 
         // Set the left expander message instances
-        leftExpander.producerMessage = &daisyMessages[0];
-        leftExpander.consumerMessage = &daisyMessages[1];
+        leftExpander.producerMessage = daisyMessages.producer();
+        leftExpander.consumerMessage = daisyMessages.consumer();
 
         lightDivider.setDivision(512);
+        controlDivider.setDivision(DAISY_CONTROL_DIVISION);
 
         // Store all the related daisy models
         daisyModels[CHANNEL_2] = rack::plugin::getModel("QuantalAudio", "DaisyChannel2");
@@ -74,11 +112,40 @@ struct DaisyMaster2 : Module {
         daisyModels[CHANNEL_SEP] = rack::plugin::getModel("QuantalAudio", "DaisyBlank");
     }
 
+    ~DaisyMaster2() override {
+        delete sceneMorph.load();
+        delete retiredSceneMorph;
+    }
+
     json_t* dataToJson() override {
         json_t* rootJ = json_object();
 
         json_object_set_new(rootJ, "muted", json_boolean(muted));
         json_object_set_new(rootJ, "level_slew", json_boolean(levelSlew));
+        json_object_set_new(rootJ, "stem_bank", json_integer(stemBank));
+
+        json_t* scenesJ = json_array();
+        for (const quantal::MixerScene &scene : scenes) {
+            json_t* sceneJ = json_object();
+            json_object_set_new(sceneJ, "name", json_string(scene.name.c_str()));
+            json_t* stripsJ = json_array();
+            for (const auto &strip : scene.strips) {
+                json_t* stripJ = json_object();
+                json_object_set_new(stripJ, "id", json_integer(strip.first));
+                json_object_set_new(stripJ, "level", json_real(strip.second.level));
+                json_object_set_new(stripJ, "pan", json_real(strip.second.pan));
+                json_object_set_new(stripJ, "muted", json_boolean(strip.second.muted));
+                json_object_set_new(stripJ, "solo", json_boolean(strip.second.solo));
+                json_object_set_new(stripJ, "aux1_send_amt", json_real(strip.second.aux1));
+                json_object_set_new(stripJ, "aux2_send_amt", json_real(strip.second.aux2));
+                json_array_append_new(stripsJ, stripJ);
+            }
+            json_object_set_new(sceneJ, "strips", stripsJ);
+            json_array_append_new(scenesJ, sceneJ);
+        }
+        json_object_set_new(rootJ, "scenes", scenesJ);
+        json_object_set_new(rootJ, "morph_from", json_integer(morphFrom));
+        json_object_set_new(rootJ, "morph_to", json_integer(morphTo));
 
         return rootJ;
     }
@@ -95,6 +162,52 @@ struct DaisyMaster2 : Module {
         if (levelSlewJ) {
             levelSlew = json_is_true(levelSlewJ);
         }
+
+        // stem bank
+        const json_t* stemBankJ = json_object_get(rootJ, "stem_bank");
+        if (stemBankJ) {
+            stemBank = std::max(static_cast<int>(json_integer_value(stemBankJ)), 0);
+        }
+
+        // scenes
+        json_t* scenesJ = json_object_get(rootJ, "scenes");
+        if (scenesJ) {
+            scenes.clear();
+            size_t i;
+            json_t* sceneJ;
+            json_array_foreach(scenesJ, i, sceneJ) {
+                quantal::MixerScene scene;
+                const json_t* nameJ = json_object_get(sceneJ, "name");
+                if (nameJ) {
+                    scene.name = json_string_value(nameJ);
+                }
+                size_t j;
+                json_t* stripJ;
+                json_array_foreach(json_object_get(sceneJ, "strips"), j, stripJ) {
+                    quantal::StripSettings settings;
+                    settings.level = json_number_value(json_object_get(stripJ, "level"));
+                    settings.pan = json_number_value(json_object_get(stripJ, "pan"));
+                    settings.muted = json_is_true(json_object_get(stripJ, "muted"));
+                    settings.solo = json_is_true(json_object_get(stripJ, "solo"));
+                    settings.aux1 = json_number_value(json_object_get(stripJ, "aux1_send_amt"));
+                    settings.aux2 = json_number_value(json_object_get(stripJ, "aux2_send_amt"));
+                    scene.strips[json_integer_value(json_object_get(stripJ, "id"))] = settings;
+                }
+                scenes.push_back(scene);
+            }
+        }
+
+        // scenes to morph between
+        const json_t* morphFromJ = json_object_get(rootJ, "morph_from");
+        if (morphFromJ) {
+            morphFrom = json_integer_value(morphFromJ);
+        }
+        const json_t* morphToJ = json_object_get(rootJ, "morph_to");
+        if (morphToJ) {
+            morphTo = json_integer_value(morphToJ);
+        }
+        sceneMorphChanged = true;
+        updateSceneMorph();
     }
 
     /**
@@ -103,36 +216,204 @@ struct DaisyMaster2 : Module {
     void onReset() override {
         muted = false;
         levelSlew = true;
+        stemBank = 0;
+        scenes.clear();
+        morphFrom = -1;
+        morphTo = -1;
+        sceneMorphChanged = true;
     }
 
     void onSampleRateChange() override {
-        for (int c = 0; c < 16; c++) {
-            levelSlewer[c].setSlewSpeed(SLEW_SPEED);
+        levelSlewer.setSlewSpeed(SLEW_SPEED, APP->engine->getSampleRate());
+    }
+
+    /**
+     * The daisy chain feeding this master, left to right, ending with this
+     * master
+     */
+    std::vector<Module*> getChainModules() {
+        std::vector<Module*> chain = {this};
+        Module* m = leftExpander.module;
+        while (m && isDaisyChainModule(m)) {
+            chain.insert(chain.begin(), m);
+            m = m->leftExpander.module;
+        }
+        return chain;
+    }
+
+    /**
+     * Call `f` with each DaisyChannel2 strip in the chain feeding this
+     * master, from right to left, carrying on across bridges
+     */
+    template <typename F>
+    void forEachStrip(F f) {
+        int bridges = 0;
+        for (Module* m = leftExpander.module; m; m = m->leftExpander.module) {
+            while (m && m->model == modelDaisyBridgeReceive && bridges++ < DAISY_BRIDGE_IDS) {
+                Module* send = findDaisyBridgeSend(m);
+                m = send ? send->leftExpander.module : nullptr;
+            }
+            if (!m || !isDaisyChainModule(m)) {
+                break;
+            }
+            if (m->model == modelDaisyChannel2) {
+                f(m);
+            }
+        }
+    }
+
+    /**
+     * Keep the settings of every strip along the chain in `scene`
+     *
+     * Called from the UI thread.
+     */
+    void captureScene(quantal::MixerScene &scene) {
+        scene.strips.clear();
+        forEachStrip([&](Module* strip) {
+            scene.strips[strip->id] = getDaisyStripSettings(strip);
+        });
+        sceneMorphChanged = true;
+    }
+
+    /**
+     * Set every strip along the chain to its settings in `scene`, straight
+     * into the strips; strips the scene doesn't have are left as they are
+     *
+     * Called from the UI thread.
+     */
+    void recallScene(const quantal::MixerScene &scene) {
+        forEachStrip([&](Module* strip) {
+            const auto found = scene.strips.find(strip->id);
+            if (found != scene.strips.end()) {
+                setDaisyStripSettings(strip, found->second);
+            }
+        });
+    }
+
+    /**
+     * Remove a scene, keeping the morph on the same scenes where they're
+     * still there
+     */
+    void deleteScene(const int i) {
+        scenes.erase(scenes.begin() + i);
+        for (int* morphScene : {&morphFrom, &morphTo}) {
+            if (*morphScene == i) {
+                *morphScene = -1;
+            } else if (*morphScene > i) {
+                (*morphScene)--;
+            }
         }
+        sceneMorphChanged = true;
+    }
+
+    /**
+     * Hand the audio thread a morph between the scenes chosen, once they or
+     * the choice have changed
+     *
+     * Called from the UI thread. The morph replaced is deleted on a later
+     * call, once the audio thread has moved on from it.
+     */
+    void updateSceneMorph() {
+        // Any process() call that started before the swap has since finished
+        if (retiredSceneMorph && processedFrames.load() != retiredAtFrame) {
+            delete retiredSceneMorph;
+            retiredSceneMorph = nullptr;
+        }
+        if (!sceneMorphChanged || retiredSceneMorph) {
+            return;
+        }
+        sceneMorphChanged = false;
+
+        const int count = static_cast<int>(scenes.size());
+        quantal::SceneMorph* morph = nullptr;
+        if (morphFrom >= 0 && morphFrom < count && morphTo >= 0 && morphTo < count) {
+            morph = new quantal::SceneMorph(scenes[morphFrom], scenes[morphTo], ++sceneMorphGeneration);
+        }
+        retiredSceneMorph = sceneMorph.exchange(morph);
+        retiredAtFrame = processedFrames.load();
+    }
+
+    /**
+     * Set the strips to the scene morph's position, on control frames when
+     * it has moved
+     */
+    void processSceneMorph() {
+        quantal::SceneMorph* morph = sceneMorph.load();
+        if (!morph) {
+            return;
+        }
+        const float position = clamp(params[MORPH_PARAM].getValue() + inputs[MORPH_CV_INPUT].getVoltage() / 10.f, 0.f, 1.f);
+        if (morph->generation == morphedGeneration && position == morphedPosition) {
+            return;
+        }
+        morphedGeneration = morph->generation;
+        morphedPosition = position;
+
+        morph->morph(position);
+        forEachStrip([&](Module* strip) {
+            const auto found = morph->index.find(strip->id);
+            if (found != morph->index.end()) {
+                setDaisyStripSettings(strip, morph->get(found->second));
+            }
+        });
     }
 
     void process(const ProcessArgs &args) override {
+        recorder.process();
+
         muted = params[MUTE_PARAM].getValue() > 0.f;
 
-        widgetPos = Vec(0, 0);
+        // The chain's control data and stems arrive even while muted; its
+        // mute groups, latency and the stem bank wanted go back along the
+        // chain
+        const bool controlFrame = controlDivider.process();
+        const DaisyMessage* chainMessage = nullptr;
+        if (leftExpander.module && (isDaisyChainModule(leftExpander.module)
+                                    || leftExpander.module->model == modelDaisyBridgeReceive)) {
+            chainMessage = static_cast<DaisyMessage*>(leftExpander.consumerMessage);
+            if (chainMessage->hasControl) {
+                control = daisyMessages.control.consumer(args.frame);
+            }
+        } else {
+            control = DaisyControl();
+        }
+        widgetPos = Vec(control.first_pos_x, control.first_pos_y);
+        const bool stemsPatched = outputs[STEM_OUTPUT_1].isConnected() || outputs[STEM_OUTPUT_2].isConnected();
+        DaisyReturn chainReturn(control);
+        chainReturn.stemBank = stemsPatched ? stemBank : -1;
+        sendDaisyReturn(this, controlFrame, chainReturn);
+
+        // A channel for each strip in the bank, 0V for any the chain hasn't
+        // filled in yet
+        if (stemsPatched) {
+            const int stems = clamp(control.channel_strip_id - 1 - stemBank * DAISY_STEM_BANK_SIZE, 1, DAISY_STEM_BANK_SIZE);
+            const StereoVoltages* carried = chainMessage ? &chainMessage->stemSignals : nullptr;
+            const int filled = carried ? std::min(carried->channels, stems) : 0;
+            outputs[STEM_OUTPUT_1].setChannels(stems);
+            outputs[STEM_OUTPUT_2].setChannels(stems);
+            for (int c = 0; c < stems; c++) {
+                outputs[STEM_OUTPUT_1].setVoltage((c < filled) ? carried->voltages_l[c] : 0.f, c);
+                outputs[STEM_OUTPUT_2].setVoltage((c < filled) ? carried->voltages_r[c] : 0.f, c);
+            }
+        }
+
+        if (controlFrame) {
+            processSceneMorph();
+        }
+
         signals = {};
         soloSignals = {};
 
         if (!muted) {
             // Get daisy-chained data from left-side linked module
-            if (leftExpander.module && (
-                    leftExpander.module->model == modelDaisyChannel2
-                    || leftExpander.module->model == modelDaisyChannelVu
-                    || leftExpander.module->model == modelDaisyChannelSends2
-                    || leftExpander.module->model == modelDaisyBlank
-                )) {
+            if (leftExpander.module && (isDaisyChainModule(leftExpander.module)
+                                        || leftExpander.module->model == modelDaisyBridgeReceive)) {
                 DaisyMessage* msgFromExpander = static_cast<DaisyMessage*>(leftExpander.consumerMessage);
+                messageCheck.check(*msgFromExpander, leftExpander.module);
 
                 signals = msgFromExpander->signals;
                 soloSignals = msgFromExpander->soloSignals;
 
-                widgetPos = Vec(msgFromExpander->first_pos_x, msgFromExpander->first_pos_y);
-
                 link_l = 0.8f;
             } else {
                 link_l = 0.0f;
@@ -140,44 +421,28 @@ struct DaisyMaster2 : Module {
 
             float gain = params[MIX_LVL_PARAM].getValue();
 
-            if (soloSignals.channels > 0) {
-                for (int c = 0; c < soloSignals.channels; c++) {
-                    soloSignals.voltages_l[c] = clamp(soloSignals.voltages_l[c], -12.f, 12.f) * gain;
-                    soloSignals.voltages_r[c] = clamp(soloSignals.voltages_r[c], -12.f, 12.f) * gain;
-                }
+            float cv[16];
+            float levels[16];
+            const bool cvConnected = inputs[MIX_CV_INPUT].isConnected();
 
-                if (inputs[MIX_CV_INPUT].isConnected()) {
-                    for (int c = 0; c < soloSignals.channels; c++) {
-                        float mix_cv = clamp(inputs[MIX_CV_INPUT].getPolyVoltage(c) / 10.f, 0.f, 1.f);
-                        if (levelSlew) {
-                            mix_cv = levelSlewer[c].process(mix_cv);
-                        }
-                        soloSignals.voltages_l[c] *= mix_cv;
-                        soloSignals.voltages_r[c] *= mix_cv;
-                    }
+            if (soloSignals.channels > 0) {
+                if (cvConnected) {
+                    readPolyVoltages(inputs[MIX_CV_INPUT], cv, soloSignals.channels);
+                    levelSlewer.process(cv, levels, soloSignals.channels, levelSlew);
                 }
+                busOutput(soloSignals, 1.f, gain, cvConnected ? levels : nullptr);
 
                 outputs[MIX_OUTPUT_1].setChannels(soloSignals.channels);
                 outputs[MIX_OUTPUT_1].writeVoltages(soloSignals.voltages_l);
                 outputs[MIX_OUTPUT_2].setChannels(soloSignals.channels);
                 outputs[MIX_OUTPUT_2].writeVoltages(soloSignals.voltages_r);
             } else {
-                // Bring the voltage back up from the chained low voltage
-                for (int c = 0; c < signals.channels; c++) {
-                    signals.voltages_l[c] = clamp(signals.voltages_l[c] * DAISY_DIVISOR, -12.f, 12.f) * gain;
-                    signals.voltages_r[c] = clamp(signals.voltages_r[c] * DAISY_DIVISOR, -12.f, 12.f) * gain;
-                }
-
-                if (inputs[MIX_CV_INPUT].isConnected()) {
-                    for (int c = 0; c < signals.channels; c++) {
-                        float mix_cv = clamp(inputs[MIX_CV_INPUT].getPolyVoltage(c) / 10.f, 0.f, 1.f);
-                        if (levelSlew) {
-                            mix_cv = levelSlewer[c].process(mix_cv);
-                        }
-                        signals.voltages_l[c] *= mix_cv;
-                        signals.voltages_r[c] *= mix_cv;
-                    }
+                if (cvConnected) {
+                    readPolyVoltages(inputs[MIX_CV_INPUT], cv, signals.channels);
+                    levelSlewer.process(cv, levels, signals.channels, levelSlew);
                 }
+                // Bring the voltage back up from the chained low voltage
+                busOutput(signals, DAISY_DIVISOR, gain, cvConnected ? levels : nullptr);
                 outputs[MIX_OUTPUT_1].setChannels(signals.channels);
                 outputs[MIX_OUTPUT_1].writeVoltages(signals.voltages_l);
                 outputs[MIX_OUTPUT_2].setChannels(signals.channels);
@@ -193,6 +458,8 @@ struct DaisyMaster2 : Module {
             } else {
                 msgToModule->singleSignals = signals;
             }
+            msgToModule->hasControl = false;
+            messageCheck.stamp(*msgToModule, checkDaisyMessages.load(std::memory_order_relaxed));
             rightExpander.module->leftExpander.messageFlipRequested = true;
         }
 
@@ -201,91 +468,393 @@ struct DaisyMaster2 : Module {
             lights[MUTE_LIGHT].value = (muted);
             lights[LINK_LIGHT_L].setBrightness(link_l);
         }
+
+        processedFrames++;
     }
 
-    static Vec spawnModule(Vec pos, Model *model) {
-        Module *newModule = model->createModule();
+    /**
+     * Left edge of the free space `width` wide nearest to ending at `right`,
+     * in the row of `right`, given the boxes of the modules in the rack
+     *
+     * Looks to the left before the right at each distance, so new strips
+     * join the front of the chain whenever there's room for them there.
+     */
+    static float findFreeSpan(const std::vector<Rect> &boxes, const Vec right, const float width) {
+        const float start = std::round((right.x - width) / RACK_GRID_WIDTH) * RACK_GRID_WIDTH;
+        auto isFree = [&](const float left) {
+            if (left < 0.f) {
+                return false;
+            }
+            for (const Rect &box : boxes) {
+                if (box.getLeft() < left + width && box.getRight() > left
+                        && box.getTop() < right.y + RACK_GRID_HEIGHT && box.getBottom() > right.y) {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        // The space to the right of every module is free, so this ends
+        for (int step = 0;; step++) {
+            const float offset = step * RACK_GRID_WIDTH;
+            if (isFree(start - offset)) {
+                return start - offset;
+            }
+            if (isFree(start + offset)) {
+                return start + offset;
+            }
+        }
+    }
+
+    /**
+     * Add new modules to the rack side by side, left to right in the order
+     * given, as close to the left of `right` as there's room for all of them
+     *
+     * The space is found once for the whole row of modules, and adding them
+     * goes in `complexAction`. A module that can't be shown is deleted and
+     * its entry set to null.
+     */
+    static void spawnModules(std::vector<Module*> &modules, const Vec right, history::ComplexAction* complexAction) {
+        std::vector<ModuleWidget*> widgets;
+        float width = 0.f;
+        for (Module* &newModule : modules) {
+            // Create module widget
+            ModuleWidget *newWidget = newModule->model->createModuleWidget(newModule);
+            if (!newWidget) {
+                WARN("Cannot spawn module %s.", newModule->model->slug.c_str());
+                delete newModule;
+                newModule = nullptr;
+                continue;
+            }
+            widgets.push_back(newWidget);
+            width += newWidget->box.size.x;
+        }
+        if (widgets.empty()) {
+            return;
+        }
 
-        // Create module widget
-        ModuleWidget *newWidget = model->createModuleWidget(newModule);
-        if (!newWidget) {
-            WARN("Cannot spawn module %s.", model->slug.c_str());
-            return pos;
+        std::vector<Rect> boxes;
+        for (ModuleWidget* mw : APP->scene->rack->getModules()) {
+            boxes.push_back(mw->box);
         }
-        APP->engine->addModule(newModule);
-        APP->scene->rack->updateModuleOldPositions();
-        APP->scene->rack->setModulePosNearest(newWidget, Vec(pos.x, pos.y));
-        APP->scene->rack->addModule(newWidget);
+        Vec pos(findFreeSpan(boxes, right, width), right.y);
 
-        // Record history
-        auto *h = new history::ModuleAdd;
-        h->name = "create module";
-        h->setModule(newWidget);
-        APP->history->push(h);
+        for (ModuleWidget* mw : widgets) {
+            APP->engine->addModule(mw->module);
+            APP->scene->rack->addModule(mw);
+            if (!APP->scene->rack->requestModulePos(mw, pos)) {
+                APP->scene->rack->setModulePosNearest(mw, pos);
+            }
+            pos.x = mw->box.getRight();
 
-        return newWidget->box.pos;
+            // Record history
+            auto *h = new history::ModuleAdd;
+            h->name = "create module";
+            h->setModule(mw);
+            complexAction->push(h);
+        }
     }
 
     /**
      * Add channel strips
      *
      * Looks at the value that has come through the chain indicating the
-     * position of the leftmost channel strip. Use the position of that module
-     * to determine where the next channel strips should be placed.
+     * position of the leftmost channel strip, and places the new strips to
+     * the left of it, or of this master if there's no chain yet. From left
+     * to right: the input strips, then with aux sends a separator, the aux
+     * sends and a return strip for each.
      */
     void addChannelStrips(const ModuleWidget *parentWidget, const int channelStripCount, const int channelAuxCount, const bool includeVuMeters) const {
-        Vec next;
-        const Vec pos = parentWidget->box.pos;
+        const Vec right = (widgetPos.x == 0) ? parentWidget->box.pos : widgetPos;
 
-        if (widgetPos.x == 0) {
-            next = pos;
-        } else {
-            next = widgetPos;
+        std::vector<Model*> models;
+        auto addStrip = [&]() {
+            models.push_back(daisyModels[CHANNEL_2]);
+            if (includeVuMeters) {
+                models.push_back(daisyModels[CHANNEL_VU]);
+            }
+        };
+
+        // Add input channel strips
+        for (int i = 0; i < channelStripCount; i++) {
+            addStrip();
         }
 
-        if (includeVuMeters) {
-            // Add return channel strips
-            for (int i = 0; i < channelAuxCount; i++) {
-                next = spawnModule(next, daisyModels[CHANNEL_VU]);
-                next = spawnModule(next, daisyModels[CHANNEL_2]);
-            }
+        if (channelAuxCount > 0) {
+            // Add a separator
+            models.push_back(daisyModels[CHANNEL_SEP]);
 
             // Add aux send channel strips
             for (int i = 0; i < channelAuxCount; i++) {
-                next = spawnModule(next, daisyModels[CHANNEL_AUX]);
-            }
-
-            // Add a separator
-            if (channelAuxCount > 0) {
-                next = spawnModule(next, daisyModels[CHANNEL_SEP]);
+                models.push_back(daisyModels[CHANNEL_AUX]);
             }
 
-            // Add input channel strips
-            for (int i = 0; i < channelStripCount; i++) {
-                next = spawnModule(next, daisyModels[CHANNEL_VU]);
-                next = spawnModule(next, daisyModels[CHANNEL_2]);
-            }
-        } else {
             // Add return channel strips
             for (int i = 0; i < channelAuxCount; i++) {
-                next = spawnModule(next, daisyModels[CHANNEL_2]);
+                addStrip();
             }
+        }
 
-            // Add aux send channel strips
-            for (int i = 0; i < channelAuxCount; i++) {
-                next = spawnModule(next, daisyModels[CHANNEL_AUX]);
+        std::vector<Module*> modules;
+        for (Model* model : models) {
+            modules.push_back(model->createModule());
+        }
+        auto *complexAction = new history::ComplexAction;
+        complexAction->name = "create channel strips";
+        spawnModules(modules, right, complexAction);
+        APP->history->push(complexAction);
+    }
+};
+
+/**
+ * The migration of a v1 Daisy module, or one with no ports for any other
+ */
+static DaisyMigration getV1Migration(Module* module) {
+    if (module && module->model == modelDaisyChannel) {
+        return getDaisyChannelMigration(module);
+    }
+    if (module && module->model == modelDaisyMaster) {
+        return getDaisyMasterMigration(module);
+    }
+    return DaisyMigration();
+}
+
+/**
+ * The ports of a DaisyMaster2 that take over from a v1 master's
+ */
+static DaisyMigration getDaisyMaster2Migration() {
+    DaisyMigration migration;
+    migration.levelCvInput = DaisyMaster2::MIX_CV_INPUT;
+    migration.signalOutput = DaisyMaster2::MIX_OUTPUT_1;
+    return migration;
+}
+
+/**
+ * The v1 Daisy chain through `module`, from its first strip to its master,
+ * following the chain cables among `cables`; empty if it doesn't end in a
+ * master
+ */
+static std::vector<Module*> findV1DaisyChain(Module* module, const std::vector<Cable*> &cables) {
+    auto isChainCable = [](const Cable * cable) {
+        return cable->outputModule && cable->outputModule->model == modelDaisyChannel
+               && cable->outputId == getV1Migration(cable->outputModule).chainOutput
+               && cable->inputId == getV1Migration(cable->inputModule).chainInput;
+    };
+
+    // Follow the chain forward to its master; a chain output patched to
+    // more than one strip goes the way of its first cable, and there can't
+    // be more hops than cables unless the chain loops
+    Module* master = module;
+    for (size_t hops = 0; master && master->model == modelDaisyChannel && hops <= cables.size(); hops++) {
+        Module* next = nullptr;
+        for (const Cable* cable : cables) {
+            if (cable->outputModule == master && isChainCable(cable)) {
+                next = cable->inputModule;
+                break;
             }
+        }
+        master = next;
+    }
+    if (!master || master->model != modelDaisyMaster) {
+        return {};
+    }
 
-            // Add a separator
-            if (channelAuxCount > 0) {
-                next = spawnModule(next, daisyModels[CHANNEL_SEP]);
+    // And back from the master to the first strip
+    std::vector<Module*> chain = {master};
+    for (;;) {
+        Module* previous = nullptr;
+        for (const Cable* cable : cables) {
+            if (cable->inputModule == chain.front() && isChainCable(cable)) {
+                previous = cable->outputModule;
+                break;
             }
+        }
+        if (!previous || std::find(chain.begin(), chain.end(), previous) != chain.end()) {
+            break;
+        }
+        chain.insert(chain.begin(), previous);
+    }
+    return chain;
+}
+
+/**
+ * A cable to patch again once a v1 chain is replaced. An end on a module
+ * being replaced has the module's position in the chain and the port of its
+ * replacement; any other end has an index of -1 and stays where it is.
+ */
+struct MigratedCable {
+    int64_t cableId = -1;
+    int outputIndex = -1;
+    Module* outputModule = nullptr;
+    int outputId = -1;
+    int inputIndex = -1;
+    Module* inputModule = nullptr;
+    int inputId = -1;
+};
 
-            // Add input channel strips
-            for (int i = 0; i < channelStripCount; i++) {
-                next = spawnModule(next, daisyModels[CHANNEL_2]);
+/**
+ * The cables among `cables` to patch to the replacements of the v1 `chain`
+ *
+ * The chain cables themselves are left out, as are cables on any other
+ * port the replacements don't have.
+ */
+static std::vector<MigratedCable> planV1Migration(const std::vector<Module*> &chain, const std::vector<Cable*> &cables) {
+    auto indexOf = [&](const Module * m) {
+        const auto found = std::find(chain.begin(), chain.end(), m);
+        return (found == chain.end()) ? -1 : static_cast<int>(found - chain.begin());
+    };
+    auto replacementOf = [&](const int index) {
+        return (index + 1 < static_cast<int>(chain.size())) ? getDaisyChannel2Migration() : getDaisyMaster2Migration();
+    };
+
+    std::vector<MigratedCable> plan;
+    for (const Cable* cable : cables) {
+        MigratedCable migrated;
+        migrated.cableId = cable->id;
+        migrated.outputIndex = indexOf(cable->outputModule);
+        migrated.outputModule = cable->outputModule;
+        migrated.outputId = cable->outputId;
+        migrated.inputIndex = indexOf(cable->inputModule);
+        migrated.inputModule = cable->inputModule;
+        migrated.inputId = cable->inputId;
+        if (migrated.outputIndex < 0 && migrated.inputIndex < 0) {
+            continue;
+        }
+
+        if (migrated.outputIndex >= 0) {
+            const DaisyMigration from = getV1Migration(chain[migrated.outputIndex]);
+            const DaisyMigration to = replacementOf(migrated.outputIndex);
+            migrated.outputId = (cable->outputId == from.signalOutput) ? to.signalOutput : -1;
+        }
+        if (migrated.inputIndex >= 0) {
+            const DaisyMigration from = getV1Migration(chain[migrated.inputIndex]);
+            const DaisyMigration to = replacementOf(migrated.inputIndex);
+            if (cable->inputId == from.signalInput) {
+                migrated.inputId = to.signalInput;
+            } else if (cable->inputId == from.levelCvInput) {
+                migrated.inputId = to.levelCvInput;
+            } else {
+                migrated.inputId = -1;
             }
         }
+        if (migrated.outputId >= 0 && migrated.inputId >= 0) {
+            plan.push_back(migrated);
+        }
+    }
+    return plan;
+}
+
+bool migrateDaisyChain(Module* module) {
+    std::vector<Cable*> cables;
+    for (int64_t cableId : APP->engine->getCableIds()) {
+        Cable* cable = APP->engine->getCable(cableId);
+        if (cable) {
+            cables.push_back(cable);
+        }
+    }
+    const std::vector<Module*> chain = findV1DaisyChain(module, cables);
+    ModuleWidget* masterWidget = chain.empty() ? nullptr : APP->scene->rack->getModule(chain.back()->id);
+    if (!masterWidget) {
+        return false;
+    }
+    const Vec right(masterWidget->box.getRight(), masterWidget->box.pos.y);
+    const std::vector<MigratedCable> plan = planV1Migration(chain, cables);
+
+    // The replacements take the v1 levels and mutes; the v1 chain is mono,
+    // so the strips are panned hard left to leave the left outputs as they
+    // were
+    std::vector<Module*> modules;
+    for (size_t i = 0; i < chain.size(); i++) {
+        const DaisyMigration migration = getV1Migration(chain[i]);
+        if (i + 1 < chain.size()) {
+            Module* strip = modelDaisyChannel2->createModule();
+            quantal::StripSettings settings;
+            settings.level = migration.level;
+            settings.pan = -1.f;
+            settings.muted = migration.muted;
+            setDaisyStripSettings(strip, settings);
+            modules.push_back(strip);
+        } else {
+            Module* master = modelDaisyMaster2->createModule();
+            master->params[DaisyMaster2::MIX_LVL_PARAM].setValue(migration.level);
+            master->params[DaisyMaster2::MUTE_PARAM].setValue(migration.muted ? 1.f : 0.f);
+            modules.push_back(master);
+        }
+    }
+
+    // Cables keep their colours
+    std::vector<NVGcolor> colors;
+    for (const MigratedCable &migrated : plan) {
+        CableWidget* cw = APP->scene->rack->getCable(migrated.cableId);
+        colors.push_back(cw ? cw->color : nvgRGB(0xc9, 0x18, 0x47));
+    }
+
+    auto *complexAction = new history::ComplexAction;
+    complexAction->name = "migrate Daisy chain";
+
+    // Remove the v1 modules along with all their cables
+    for (Module* m : chain) {
+        ModuleWidget* mw = APP->scene->rack->getModule(m->id);
+        if (!mw) {
+            continue;
+        }
+        mw->appendDisconnectActions(complexAction);
+        auto *h = new history::ModuleRemove;
+        h->setModule(mw);
+        complexAction->push(h);
+        APP->scene->rack->removeModule(mw);
+        delete mw;
+    }
+
+    DaisyMaster2::spawnModules(modules, right, complexAction);
+
+    // Patch the replacements in where the v1 modules were
+    for (size_t i = 0; i < plan.size(); i++) {
+        const MigratedCable &migrated = plan[i];
+        Module* outputModule = (migrated.outputIndex >= 0) ? modules[migrated.outputIndex] : migrated.outputModule;
+        Module* inputModule = (migrated.inputIndex >= 0) ? modules[migrated.inputIndex] : migrated.inputModule;
+        if (!outputModule || !inputModule) {
+            continue;
+        }
+
+        Cable* cable = new Cable;
+        cable->outputModule = outputModule;
+        cable->outputId = migrated.outputId;
+        cable->inputModule = inputModule;
+        cable->inputId = migrated.inputId;
+        APP->engine->addCable(cable);
+
+        CableWidget* cw = new CableWidget;
+        cw->setCable(cable);
+        cw->color = colors[i];
+        APP->scene->rack->addCable(cw);
+
+        auto *h = new history::CableAdd;
+        h->setCable(cw);
+        complexAction->push(h);
+    }
+
+    APP->history->push(complexAction);
+    return true;
+}
+
+/**
+ * Menu text field to name a mixer scene
+ */
+struct SceneNameField : ui::TextField {
+    DaisyMaster2* module;
+    int scene;
+
+    SceneNameField(DaisyMaster2* module, const int scene) : module(module), scene(scene) {
+        box.size.x = 120.f;
+        placeholder = "Scene name";
+        setText(module->scenes[scene].name);
+    }
+
+    void onChange(const ChangeEvent& e) override {
+        if (scene < static_cast<int>(module->scenes.size())) {
+            module->scenes[scene].name = getText();
+        }
     }
 };
 
@@ -312,8 +881,16 @@ struct DaisyMasterWidget2 : ModuleWidget {
         addParam(createParam<RoundLargeBlackKnob>(Vec(RACK_GRID_WIDTH * 1.5f - (36.0f / 2), 52.0), module, DaisyMaster2::MIX_LVL_PARAM));
         addInput(createInput<ThemedPJ301MPort>(Vec(RACK_GRID_WIDTH * 1.5f - (25.0f / 2), 96.0), module, DaisyMaster2::MIX_CV_INPUT));
 
+        // Stem outputs
+        addOutput(createOutput<ThemedPJ301MPort>(Vec((RACK_GRID_WIDTH * 1.5f) - (25.0f / 2), 141.0), module, DaisyMaster2::STEM_OUTPUT_1));
+        addOutput(createOutput<ThemedPJ301MPort>(Vec((RACK_GRID_WIDTH * 1.5f) - (25.0f / 2), 166.0), module, DaisyMaster2::STEM_OUTPUT_2));
+
+        // Scene morph & CV
+        addParam(createParamCentered<Trimpot>(Vec(RACK_GRID_WIDTH * 1.5f, 208.5), module, DaisyMaster2::MORPH_PARAM));
+        addInput(createInput<ThemedPJ301MPort>(Vec(RACK_GRID_WIDTH * 1.5f - (25.0f / 2), 219.0), module, DaisyMaster2::MORPH_CV_INPUT));
+
         // Mute
-        addParam(createLightParam<VCVLightLatch<MediumSimpleLight<RedLight>>>(Vec(RACK_GRID_WIDTH * 1.5f - 9.0f, 254.0), module, DaisyMaster2::MUTE_PARAM, DaisyMaster2::MUTE_LIGHT));
+        addParam(createLightParam<VCVLightLatch<MediumSimpleLight<RedLight>>>(Vec(RACK_GRID_WIDTH * 1.5f - 9.0f, 256.0), module, DaisyMaster2::MUTE_PARAM, DaisyMaster2::MUTE_LIGHT));
 
         // Mix output
         addOutput(createOutput<ThemedPJ301MPort>(Vec((RACK_GRID_WIDTH * 1.5f) - (25.0f / 2), 290.0), module, DaisyMaster2::MIX_OUTPUT_1));
@@ -325,11 +902,95 @@ struct DaisyMasterWidget2 : ModuleWidget {
         uiDivider.setDivision(24);
     }
 
+    void step() override {
+        DaisyMaster2* module = getModule<DaisyMaster2>();
+        if (module) {
+            module->updateSceneMorph();
+        }
+        ModuleWidget::step();
+    }
+
+    void appendSceneMenu(Menu *menu, DaisyMaster2* module) {
+        menu->addChild(new MenuSeparator);
+        menu->addChild(createMenuLabel("Mixer scenes"));
+        menu->addChild(createMenuItem("Capture new scene", "", [ = ]() {
+            quantal::MixerScene scene;
+            scene.name = string::f("Scene %d", static_cast<int>(module->scenes.size()) + 1);
+            module->captureScene(scene);
+            module->scenes.push_back(scene);
+        }));
+
+        for (int i = 0; i < static_cast<int>(module->scenes.size()); i++) {
+            menu->addChild(createSubmenuItem(module->scenes[i].name, "", [ = ](Menu * menu) {
+                menu->addChild(new SceneNameField(module, i));
+                menu->addChild(createMenuItem("Recall", "", [ = ]() {
+                    module->recallScene(module->scenes[i]);
+                }));
+                menu->addChild(createMenuItem("Capture", "", [ = ]() {
+                    module->captureScene(module->scenes[i]);
+                    module->updateSceneMorph();
+                }));
+                menu->addChild(createMenuItem("Delete", "", [ = ]() {
+                    module->deleteScene(i);
+                    module->updateSceneMorph();
+                }));
+            }));
+        }
+
+        if (module->scenes.empty()) {
+            return;
+        }
+        auto appendMorphScenes = [ = ](Menu * menu, int* morphScene) {
+            menu->addChild(createCheckMenuItem("None", "", [ = ]() {
+                return *morphScene < 0;
+            }, [ = ]() {
+                *morphScene = -1;
+                module->sceneMorphChanged = true;
+                module->updateSceneMorph();
+            }));
+            for (int i = 0; i < static_cast<int>(module->scenes.size()); i++) {
+                menu->addChild(createCheckMenuItem(module->scenes[i].name, "", [ = ]() {
+                    return *morphScene == i;
+                }, [ = ]() {
+                    *morphScene = i;
+                    module->sceneMorphChanged = true;
+                    module->updateSceneMorph();
+                }));
+            }
+        };
+        menu->addChild(createSubmenuItem("Morph from", "", [ = ](Menu * menu) {
+            appendMorphScenes(menu, &module->morphFrom);
+        }));
+        menu->addChild(createSubmenuItem("Morph to", "", [ = ](Menu * menu) {
+            appendMorphScenes(menu, &module->morphTo);
+        }));
+    }
+
     void appendContextMenu(Menu *menu) override {
         DaisyMaster2* module = getModule<DaisyMaster2>();
 
         menu->addChild(new MenuSeparator);
         menu->addChild(createBoolPtrMenuItem("Smooth level CV", "", &module->levelSlew));
+        const int latency = module->control.latency;
+        menu->addChild(createMenuLabel(string::f("Delay compensation: %d samples (%.2f ms)", latency,
+                                       1000.f * latency / APP->engine->getSampleRate())));
+
+        // A bank for each 16 strips in the chain, and any chosen beyond it
+        const int strips = module->control.channel_strip_id - 1;
+        const int banks = std::max((strips + DAISY_STEM_BANK_SIZE - 1) / DAISY_STEM_BANK_SIZE, module->stemBank + 1);
+        menu->addChild(createSubmenuItem("Stem bank", string::f("%d-%d", module->stemBank * DAISY_STEM_BANK_SIZE + 1,
+                                         (module->stemBank + 1) * DAISY_STEM_BANK_SIZE), [ = ](Menu * menu) {
+            for (int bank = 0; bank < banks; bank++) {
+                menu->addChild(createCheckMenuItem(string::f("Strips %d-%d", bank * DAISY_STEM_BANK_SIZE + 1,
+                                                   (bank + 1) * DAISY_STEM_BANK_SIZE), "", [ = ]() {
+                    return module->stemBank == bank;
+                }, [ = ]() {
+                    module->stemBank = bank;
+                }));
+            }
+        }));
+
+        appendSceneMenu(menu, module);
 
         menu->addChild(new MenuSeparator);
         menu->addChild(createMenuItem("Create 1 channel", "", [ = ]() {
@@ -358,6 +1019,27 @@ struct DaisyMasterWidget2 : ModuleWidget {
         menu->addChild(createMenuItem("Create 4 channels with vu meters + aux sends", "", [ = ]() {
             module->addChannelStrips(this, 4, 2, true);
         }));
+        menu->addChild(createSubmenuItem("Create more channels", "", [ = ](Menu * menu) {
+            for (int count : {8, 16, 32, 64}) {
+                menu->addChild(createMenuItem(string::f("Create %d channels", count), "", [ = ]() {
+                    module->addChannelStrips(this, count, 0, false);
+                }));
+                menu->addChild(createMenuItem(string::f("Create %d channels with vu meters", count), "", [ = ]() {
+                    module->addChannelStrips(this, count, 0, true);
+                }));
+                menu->addChild(createMenuItem(string::f("Create %d channels with vu meters + aux sends", count), "", [ = ]() {
+                    module->addChannelStrips(this, count, 2, true);
+                }));
+            }
+        }));
+
+        menu->addChild(new MenuSeparator);
+        menu->addChild(createMenuLabel(string::f("DSP kernels: %s", kernels->name)));
+
+        appendRecorderMenu(menu, &module->recorder, [ = ]() {
+            return module->getChainModules();
+        }, "daisy-chain");
+        appendMessageCheckMenu(menu, &module->messageCheck);
     }
 
     void onHoverKey(const HoverKeyEvent& e) override {
@@ -373,4 +1055,6 @@ struct DaisyMasterWidget2 : ModuleWidget {
     }
 };
 
+std::atomic<bool> checkDaisyMessages{false};
+
 Model* modelDaisyMaster2 = createModel<DaisyMaster2, DaisyMasterWidget2>("DaisyMaster2");
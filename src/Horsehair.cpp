@@ -1,169 +1,18 @@
 #include "QuantalAudio.hpp"
-
-using simd::float_4;
-
-template <typename T>
-T sin2pi_pade_05_5_4(T x) {
-    x -= 0.5f;
-    return (T(-6.283185307) * x + T(33.19863968) * simd::pow(x, 3) - T(32.44191367) * simd::pow(x, 5))
-           / (1 + T(1.296008659) * simd::pow(x, 2) + T(0.7028072946) * simd::pow(x, 4));
+#include "Recorder.hpp"
+#include "core/HorsehairVoice.hpp"
+
+using quantal::float4;
+using quantal::HorsehairVoiceGroup;
+
+/**
+ * Read 4 channels of an input starting at `c`, copying a monophonic signal to
+ * every lane
+ */
+inline float4 getPolyVoltage4(Input &input, int c) {
+    return input.isMonophonic() ? float4(input.getVoltage()) : float4::load(input.getVoltages(c));
 }
 
-template <typename T>
-T expCurve(T x) {
-    return (3 + x * (-13 + 5 * x)) / (3 + 2 * x);
-}
-
-template <int OVERSAMPLE, int QUALITY, typename T>
-struct VoltageControlledOscillator {
-    bool analog = true;
-    bool soft = false;
-    bool syncEnabled = false;
-    // For optimizing in serial code
-    int channels = 0;
-
-    T lastSyncValue = 0.f;
-    T phase = 0.f;
-    T freq{};
-    T pulseWidth = 0.5f;
-    T syncDirection = 1.f;
-
-    dsp::TRCFilter<T> sqrFilter;
-
-    dsp::MinBlepGenerator<QUALITY, OVERSAMPLE, T> sqrMinBlep;
-    dsp::MinBlepGenerator<QUALITY, OVERSAMPLE, T> sawMinBlep;
-    dsp::MinBlepGenerator<QUALITY, OVERSAMPLE, T> sinMinBlep;
-
-    T sqrValue = 0.f;
-    T sawValue = 0.f;
-    T sinValue = 0.f;
-
-    void setPitch(T pitch) {
-        freq = dsp::FREQ_C4 * dsp::approxExp2_taylor5(pitch + 30.f) / std::pow(2.f, 30.f);
-    }
-
-    void setPulseWidth(T pulseWidth) {
-        constexpr float pwMin = 0.01f;
-        this->pulseWidth = simd::clamp(pulseWidth, pwMin, 1.f - pwMin);
-    }
-
-    void process(float deltaTime, T syncValue) {
-        // Advance phase
-        T deltaPhase = simd::clamp(freq * deltaTime, 1e-6f, 0.35f);
-        if (soft) {
-            // Reverse direction
-            deltaPhase *= syncDirection;
-        } else {
-            // Reset back to forward
-            syncDirection = 1.f;
-        }
-        phase += deltaPhase;
-        // Wrap phase
-        phase -= simd::floor(phase);
-
-        // Jump sqr when crossing 0, or 1 if backwards
-        T wrapPhase = (syncDirection == -1.f) & 1.f;
-        T wrapCrossing = (wrapPhase - (phase - deltaPhase)) / deltaPhase;
-        int wrapMask = simd::movemask((0 < wrapCrossing) & (wrapCrossing <= 1.f));
-        if (wrapMask) {
-            for (int i = 0; i < channels; i++) {
-                if (wrapMask & (1 << i)) {
-                    T mask = simd::movemaskInverse<T>(1 << i);
-                    float p = wrapCrossing[i] - 1.f;
-                    T x = mask & (2.f * syncDirection);
-                    sqrMinBlep.insertDiscontinuity(p, x);
-                }
-            }
-        }
-
-        // Jump sqr when crossing `pulseWidth`
-        T pulseCrossing = (pulseWidth - (phase - deltaPhase)) / deltaPhase;
-        int pulseMask = simd::movemask((0 < pulseCrossing) & (pulseCrossing <= 1.f));
-        if (pulseMask) {
-            for (int i = 0; i < channels; i++) {
-                if (pulseMask & (1 << i)) {
-                    T mask = simd::movemaskInverse<T>(1 << i);
-                    float p = pulseCrossing[i] - 1.f;
-                    T x = mask & (-2.f * syncDirection);
-                    sqrMinBlep.insertDiscontinuity(p, x);
-                }
-            }
-        }
-
-        // Jump saw when crossing 0.5
-        T halfCrossing = (0.5f - (phase - deltaPhase)) / deltaPhase;
-        const int halfMask = simd::movemask((0 < halfCrossing) & (halfCrossing <= 1.f));
-        if (halfMask) {
-            for (int i = 0; i < channels; i++) {
-                if (halfMask & (1 << i)) {
-                    T mask = simd::movemaskInverse<T>(1 << i);
-                    float p = halfCrossing[i] - 1.f;
-                    T x = mask & (-2.f * syncDirection);
-                    sawMinBlep.insertDiscontinuity(p, x);
-                }
-            }
-        }
-
-        // Square
-        sqrValue = sqr(phase);
-        sqrValue += sqrMinBlep.process();
-
-        if (analog) {
-            sqrFilter.setCutoffFreq(20.f * deltaTime);
-            sqrFilter.process(sqrValue);
-            sqrValue = sqrFilter.highpass() * 0.95f;
-        }
-
-        // Saw
-        sawValue = saw(phase);
-        sawValue += sawMinBlep.process();
-
-        // Sin
-        sinValue = sin(phase);
-        sinValue += sinMinBlep.process();
-    }
-
-    T sin(T phase) {
-        T v{};
-        if (analog) {
-            // Quadratic approximation of sine, slightly richer harmonics
-            T halfPhase = (phase < 0.5f);
-            T x = phase - simd::ifelse(halfPhase, 0.25f, 0.75f);
-            v = 1.f - 16.f * simd::pow(x, 2);
-            v *= simd::ifelse(halfPhase, 1.f, -1.f);
-        } else {
-            v = sin2pi_pade_05_5_4(phase);
-        }
-        return v;
-    }
-    T sin() {
-        return sinValue;
-    }
-
-    T saw(T phase) {
-        T v{};
-        T x = phase + 0.5f;
-        x -= simd::trunc(x);
-        if (analog) {
-            v = -expCurve(x);
-        } else {
-            v = 2 * x - 1;
-        }
-        return v;
-    }
-    T saw() {
-        return sawValue;
-    }
-
-    T sqr(T phase) {
-        T v = simd::ifelse(phase < pulseWidth, 1.f, -1.f);
-        return v;
-    }
-    T sqr() {
-        return sqrValue;
-    }
-};
-
 struct Horsehair : Module {
     enum ParamIds {
         PITCH_PARAM,
@@ -178,6 +27,8 @@ struct Horsehair : Module {
         ENUMS(SHAPE_CV_INPUT, 2),
         ENUMS(PW_CV_INPUT, 2),
         MIX_CV_INPUT,
+        SYNC_INPUT,
+        FM_INPUT,
         NUM_INPUTS
     };
     enum OutputIds {
@@ -190,8 +41,46 @@ struct Horsehair : Module {
         NUM_LIGHTS
     };
 
-    VoltageControlledOscillator<16, 16, float_4> oscillators[4];
-    VoltageControlledOscillator<16, 16, float_4> oscillators2[4];
+    // Number of detuned copies of each voice (1, 2, 4 or 8)
+    int unison = 1;
+    float unisonDetune = 0.2f;
+    float unisonSpread = 0.5f;
+    bool unisonStereo = false;
+    // Detune or spread changed, so the lanes need working out again
+    bool unisonChanged = true;
+    // The number of copies changed, so they restart at random phases
+    bool unisonCountChanged = true;
+
+    enum OscTargets {
+        TARGET_OSC_A,
+        TARGET_OSC_B,
+        TARGET_OSC_BOTH
+    };
+    // Which oscillators follow the sync input
+    int syncTarget = TARGET_OSC_A;
+    // Restart oscillator B whenever oscillator A restarts its cycle
+    bool syncBToA = false;
+    bool softSync = false;
+
+    // Which oscillators the FM input modulates
+    int fmTarget = TARGET_OSC_BOTH;
+    // FM input depth: at full amount 5V deviates the frequency by 100%
+    float fmAmount = 1.0f;
+    // Depth of osc A's sine modulating osc B
+    float fmAToB = 0.0f;
+    bool throughZeroFm = false;
+
+    // Per-lane unison detune and output gains
+    quantal::HorsehairUnison unisonLanes;
+
+    // Voice state for all 16 lanes, packed together and allocated with the
+    // module so the audio thread never allocates. Only the first
+    // `activeGroups` are run, so the rest never reach the cache.
+    std::vector<HorsehairVoiceGroup> voiceGroups;
+    int activeGroups = 1;
+
+    // Developer mode workload recording
+    ModuleRecorder recorder;
 
     Horsehair() {
         config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
@@ -210,64 +99,430 @@ struct Horsehair : Module {
         configInput(PW_CV_INPUT + 0, "Osc A PW CV");
         configInput(PW_CV_INPUT + 1, "Osc B PW CV");
         configInput(MIX_CV_INPUT, "Mix CV");
+        configInput(SYNC_INPUT, "Sync");
+        configInput(FM_INPUT, "Linear FM");
         configOutput(SIN_OUTPUT, "Sine");
         configOutput(MIX_OUTPUT, "Osc Mix");
+
+        voiceGroups.resize(4);
+    }
+
+    /**
+     * Run `count` 4-voice groups from now on
+     *
+     * Groups that start running again begin from a fresh state. Voices
+     * already running carry on where they are without a click.
+     */
+    void setActiveGroups(int count) {
+        for (int g = activeGroups; g < count; g++) {
+            voiceGroups[g] = HorsehairVoiceGroup();
+            if (unison > 1) {
+                randomizePhases(voiceGroups[g]);
+            }
+        }
+        activeGroups = count;
+    }
+
+    json_t* dataToJson() override {
+        json_t* rootJ = json_object();
+
+        json_object_set_new(rootJ, "unison", json_integer(unison));
+        json_object_set_new(rootJ, "unison_detune", json_real(unisonDetune));
+        json_object_set_new(rootJ, "unison_spread", json_real(unisonSpread));
+        json_object_set_new(rootJ, "unison_stereo", json_boolean(unisonStereo));
+        json_object_set_new(rootJ, "sync_target", json_integer(syncTarget));
+        json_object_set_new(rootJ, "sync_b_to_a", json_boolean(syncBToA));
+        json_object_set_new(rootJ, "soft_sync", json_boolean(softSync));
+        json_object_set_new(rootJ, "fm_target", json_integer(fmTarget));
+        json_object_set_new(rootJ, "fm_amount", json_real(fmAmount));
+        json_object_set_new(rootJ, "fm_a_to_b", json_real(fmAToB));
+        json_object_set_new(rootJ, "through_zero_fm", json_boolean(throughZeroFm));
+
+        return rootJ;
+    }
+
+    void dataFromJson(json_t* rootJ) override {
+        // unison
+        const json_t* unisonJ = json_object_get(rootJ, "unison");
+        if (unisonJ) {
+            setUnison(json_integer_value(unisonJ));
+        }
+
+        // unison detune
+        const json_t* unisonDetuneJ = json_object_get(rootJ, "unison_detune");
+        if (unisonDetuneJ) {
+            unisonDetune = clamp(static_cast<float>(json_real_value(unisonDetuneJ)), 0.f, 1.f);
+        }
+
+        // unison spread
+        const json_t* unisonSpreadJ = json_object_get(rootJ, "unison_spread");
+        if (unisonSpreadJ) {
+            unisonSpread = clamp(static_cast<float>(json_real_value(unisonSpreadJ)), 0.f, 1.f);
+        }
+
+        // unison stereo
+        const json_t* unisonStereoJ = json_object_get(rootJ, "unison_stereo");
+        if (unisonStereoJ) {
+            unisonStereo = json_is_true(unisonStereoJ);
+        }
+
+        // sync target
+        const json_t* syncTargetJ = json_object_get(rootJ, "sync_target");
+        if (syncTargetJ) {
+            syncTarget = clamp(static_cast<int>(json_integer_value(syncTargetJ)), 0, 2);
+        }
+
+        // sync B to A
+        const json_t* syncBToAJ = json_object_get(rootJ, "sync_b_to_a");
+        if (syncBToAJ) {
+            syncBToA = json_is_true(syncBToAJ);
+        }
+
+        // soft sync
+        const json_t* softSyncJ = json_object_get(rootJ, "soft_sync");
+        if (softSyncJ) {
+            softSync = json_is_true(softSyncJ);
+        }
+
+        // fm target
+        const json_t* fmTargetJ = json_object_get(rootJ, "fm_target");
+        if (fmTargetJ) {
+            fmTarget = clamp(static_cast<int>(json_integer_value(fmTargetJ)), 0, 2);
+        }
+
+        // fm amount
+        const json_t* fmAmountJ = json_object_get(rootJ, "fm_amount");
+        if (fmAmountJ) {
+            fmAmount = clamp(static_cast<float>(json_number_value(fmAmountJ)), 0.0f, 1.0f);
+        }
+
+        // fm a to b
+        const json_t* fmAToBJ = json_object_get(rootJ, "fm_a_to_b");
+        if (fmAToBJ) {
+            fmAToB = clamp(static_cast<float>(json_number_value(fmAToBJ)), 0.0f, 1.0f);
+        }
+
+        // through-zero fm
+        const json_t* throughZeroFmJ = json_object_get(rootJ, "through_zero_fm");
+        if (throughZeroFmJ) {
+            throughZeroFm = json_is_true(throughZeroFmJ);
+        }
+
+        unisonChanged = true;
+        unisonCountChanged = true;
+    }
+
+    /**
+     * When user resets this module
+     */
+    void onReset() override {
+        unison = 1;
+        unisonDetune = 0.2f;
+        unisonSpread = 0.5f;
+        unisonStereo = false;
+        unisonChanged = true;
+        unisonCountChanged = true;
+        syncTarget = TARGET_OSC_A;
+        syncBToA = false;
+        softSync = false;
+        fmTarget = TARGET_OSC_BOTH;
+        fmAmount = 1.0f;
+        fmAToB = 0.0f;
+        throughZeroFm = false;
+    }
+
+    /**
+     * Set the number of unison copies per voice; anything other than 2, 4
+     * or 8 turns unison off
+     */
+    void setUnison(int count) {
+        unison = (count == 2 || count == 4 || count == 8) ? count : 1;
+        unisonChanged = true;
+        unisonCountChanged = true;
+    }
+
+    /**
+     * Start every lane at a random phase so unison copies don't begin in
+     * phase with each other
+     */
+    void randomizePhases(HorsehairVoiceGroup &group) {
+        for (int i = 0; i < 4; i++) {
+            group.oscillator.phase[i] = random::uniform();
+            group.oscillator2.phase[i] = random::uniform();
+        }
     }
 
     void process(const ProcessArgs &args) override {
-        int channels = std::max(inputs[PITCH_INPUT].getChannels(), 1);
-
-        float octave = params[OCTAVE_PARAM + 0].getValue();
-        float octave2 = params[OCTAVE_PARAM + 1].getValue();
-        float pitch_fine = params[PITCH_PARAM].getValue() / 4.0f;
-        float pw = params[PW_PARAM + 0].getValue();
-        float pw2 = params[PW_PARAM + 1].getValue();
-
-        float shape = clamp(params[SHAPE_PARAM + 0].getValue(), 0.0f, 1.0f);
-        if (inputs[SHAPE_CV_INPUT + 0].isConnected()) {
-            shape += inputs[SHAPE_CV_INPUT + 0].getVoltage() / 10.0f;
-            shape = clamp(shape, 0.0f, 1.0f);
+        recorder.process();
+
+        if (unisonChanged) {
+            unisonLanes.update(unison, unisonDetune, unisonSpread);
+            unisonChanged = false;
+        }
+        if (unisonCountChanged) {
+            if (unison > 1) {
+                for (HorsehairVoiceGroup &group : voiceGroups) {
+                    randomizePhases(group);
+                }
+            }
+            unisonCountChanged = false;
         }
 
-        float shape2 = clamp(params[SHAPE_PARAM + 1].getValue(), 0.0f, 1.0f);
-        if (inputs[SHAPE_CV_INPUT + 1].isConnected()) {
-            shape2 += inputs[SHAPE_CV_INPUT + 1].getVoltage() / 10.0f;
-            shape2 = clamp(shape2, 0.0f, 1.0f);
+        // Idle with no outputs patched: the oscillators stop where they are
+        // and pick up again on the frame either output is patched
+        if (!outputs[MIX_OUTPUT].isConnected() && !outputs[SIN_OUTPUT].isConnected()) {
+            return;
         }
 
-        float_4 out = 0.0f;
-        float_4 out2 = 0.0f;
-
-        for (int c = 0; c < channels; c += 4) {
-            auto *oscillator = &oscillators[c / 4];
-            oscillator->channels = std::min(channels - c, 4);
-            float_4 pitch = 1.0f + roundf(octave) + pitch_fine;
-            pitch += inputs[PITCH_INPUT].getVoltageSimd<float_4>(c);
-            oscillator->setPitch(pitch);
-            oscillator->setPulseWidth(pw + inputs[PW_CV_INPUT + 0].getPolyVoltageSimd<float_4>(c) / 10.f);
-            oscillator->process(args.sampleTime, 0.0);
-
-            auto *oscillator2 = &oscillators2[c / 4];
-            oscillator2->channels = std::min(channels - c, 4);
-            float_4 pitch2 = 1.0f + roundf(octave2) + pitch_fine;
-            pitch2 += inputs[PITCH_INPUT].getVoltageSimd<float_4>(c);
-            oscillator2->setPitch(pitch2);
-            oscillator2->setPulseWidth(pw2 + inputs[PW_CV_INPUT + 1].getPolyVoltageSimd<float_4>(c) / 10.f);
-            oscillator2->process(args.sampleTime, 0.0);
+        // Each voice takes `unison` lanes, so fewer voices fit in the 16 lanes
+        const int channels = std::min(std::max(inputs[PITCH_INPUT].getChannels(), 1), 16 / unison);
+        const int lanes = channels * unison;
+        setActiveGroups((lanes + 3) / 4);
+
+        quantal::HorsehairSettings settings;
+        settings.octave[0] = params[OCTAVE_PARAM + 0].getValue();
+        settings.octave[1] = params[OCTAVE_PARAM + 1].getValue();
+        settings.fine = params[PITCH_PARAM].getValue() / 4.0f;
+        settings.pw[0] = params[PW_PARAM + 0].getValue();
+        settings.pw[1] = params[PW_PARAM + 1].getValue();
+        settings.mix = params[MIX_PARAM].getValue();
+
+        for (int i = 0; i < 2; i++) {
+            settings.shape[i] = clamp(params[SHAPE_PARAM + i].getValue(), 0.0f, 1.0f);
+            if (inputs[SHAPE_CV_INPUT + i].isConnected()) {
+                settings.shape[i] += inputs[SHAPE_CV_INPUT + i].getVoltage() / 10.0f;
+                settings.shape[i] = clamp(settings.shape[i], 0.0f, 1.0f);
+            }
+        }
+
+        const bool syncConnected = inputs[SYNC_INPUT].isConnected();
+        settings.syncA = syncConnected && syncTarget != TARGET_OSC_B;
+        settings.syncB = syncConnected && syncTarget != TARGET_OSC_A && !syncBToA;
+        settings.syncBToA = syncBToA;
+        settings.softSync = softSync;
+
+        const bool fmConnected = inputs[FM_INPUT].isConnected();
+        settings.fmA = (fmConnected && fmTarget != TARGET_OSC_B) ? fmAmount / 5.f : 0.f;
+        settings.fmB = (fmConnected && fmTarget != TARGET_OSC_A) ? fmAmount / 5.f : 0.f;
+        settings.fmAToBIndex = fmAToB * quantal::FM_A_TO_B_MAX_INDEX;
+        settings.throughZeroFm = throughZeroFm;
+
+        // Unison copies are summed down to one channel per voice
+        float mixL[16] = {};
+        float mixR[16] = {};
+
+        for (int c = 0; c < lanes; c += 4) {
+            quantal::HorsehairInputs in;
+            if (unison == 1) {
+                in.pitch = float4::load(inputs[PITCH_INPUT].getVoltages(c));
+                in.pw[0] = getPolyVoltage4(inputs[PW_CV_INPUT + 0], c);
+                in.pw[1] = getPolyVoltage4(inputs[PW_CV_INPUT + 1], c);
+                in.mix = getPolyVoltage4(inputs[MIX_CV_INPUT], c);
+                in.sync = getPolyVoltage4(inputs[SYNC_INPUT], c);
+                in.fm = getPolyVoltage4(inputs[FM_INPUT], c);
+            } else {
+                // Every lane reads the inputs of the voice it is a copy of
+                for (int i = 0; i < 4; i++) {
+                    const int voice = std::min((c + i) / unison, channels - 1);
+                    in.pitch[i] = inputs[PITCH_INPUT].getVoltage(voice);
+                    in.pw[0][i] = inputs[PW_CV_INPUT + 0].getPolyVoltage(voice);
+                    in.pw[1][i] = inputs[PW_CV_INPUT + 1].getPolyVoltage(voice);
+                    in.mix[i] = inputs[MIX_CV_INPUT].getPolyVoltage(voice);
+                    in.sync[i] = inputs[SYNC_INPUT].getPolyVoltage(voice);
+                    in.fm[i] = inputs[FM_INPUT].getPolyVoltage(voice);
+                }
+                in.pitch += float4::load(&unisonLanes.detune[c]);
+            }
+
+            const int groupChannels = std::min(lanes - c, 4);
+            float4 oscMix;
+            float4 sine;
+            voiceGroups[c / 4].process(settings, args.sampleTime, groupChannels, in, oscMix, sine);
+
+            if (unison > 1) {
+                float4 left;
+                float4 right;
+                if (unisonStereo) {
+                    left = oscMix * float4::load(&unisonLanes.gainL[c]);
+                    right = oscMix * float4::load(&unisonLanes.gainR[c]);
+                } else {
+                    left = oscMix * float4::load(&unisonLanes.gain[c]);
+                    right = sine * float4::load(&unisonLanes.gain[c]);
+                }
+
+                for (int i = 0; i < groupChannels; i++) {
+                    const int voice = (c + i) / unison;
+                    mixL[voice] += left[i];
+                    mixR[voice] += right[i];
+                }
+                continue;
+            }
 
             if (outputs[MIX_OUTPUT].isConnected()) {
-                out = simd::crossfade(oscillator->sqr(), oscillator->saw(), shape);
-                out2 = simd::crossfade(oscillator2->sqr(), oscillator2->saw(), shape2);
-                const float_4 mix = clamp(params[MIX_PARAM].getValue() + inputs[MIX_CV_INPUT].getPolyVoltageSimd<float_4>(c) / 10.0, 0.0f, 1.0f);
                 outputs[MIX_OUTPUT].setChannels(channels);
-                outputs[MIX_OUTPUT].setVoltageSimd(5.0f * simd::crossfade(out, out2, mix), c);
+                oscMix.store(outputs[MIX_OUTPUT].getVoltages(c));
             }
 
             if (outputs[SIN_OUTPUT].isConnected()) {
                 outputs[SIN_OUTPUT].setChannels(channels);
-                outputs[SIN_OUTPUT].setVoltageSimd(5.0f * oscillator->sin(), c);
+                sine.store(outputs[SIN_OUTPUT].getVoltages(c));
             }
         }
+
+        if (unison > 1) {
+            // In stereo unison the sine output carries the right channel of the mix
+            outputs[MIX_OUTPUT].setChannels(channels);
+            outputs[MIX_OUTPUT].writeVoltages(mixL);
+            outputs[SIN_OUTPUT].setChannels(channels);
+            outputs[SIN_OUTPUT].writeVoltages(mixR);
+        }
+    }
+};
+
+/**
+ * Struct for keeping track of the value in the right click menu for the
+ * unison detune and stereo spread amounts
+ */
+struct UnisonQuantity : Quantity {
+    enum Setting {
+        DETUNE,
+        SPREAD
+    };
+
+    Horsehair* _module;
+    Setting _setting;
+
+    UnisonQuantity(Horsehair *m, Setting s) : _module(m), _setting(s) {}
+
+    void setValue(float value) override {
+        value = clamp(value, getMinValue(), getMaxValue());
+        if (_module && _setting == DETUNE) {
+            _module->unisonDetune = value;
+        }
+        if (_module && _setting == SPREAD) {
+            _module->unisonSpread = value;
+        }
+        if (_module) {
+            _module->unisonChanged = true;
+        }
+    }
+
+    float getValue() override {
+        if (_module && _setting == DETUNE) {
+            return _module->unisonDetune;
+        }
+        if (_module && _setting == SPREAD) {
+            return _module->unisonSpread;
+        }
+        return getDefaultValue();
+    }
+
+    float getMinValue() override {
+        return 0.0f;
+    }
+    float getMaxValue() override {
+        return 1.0f;
+    }
+    float getDefaultValue() override {
+        return _setting == DETUNE ? 0.2f : 0.5f;
+    }
+    float getDisplayValue() override {
+        return roundf(100.0f * getValue());
+    }
+    void setDisplayValue(float displayValue) override {
+        setValue(displayValue / 100.0f);
+    }
+    std::string getLabel() override {
+        return _setting == DETUNE ? "Unison detune" : "Unison stereo spread";
+    }
+    std::string getUnit() override {
+        return _setting == DETUNE ? " cents" : "%";
+    }
+};
+
+/**
+ * Slider used in menu for unison amounts
+ */
+template<UnisonQuantity::Setting s>
+struct UnisonMenuSlider : ui::Slider {
+    explicit UnisonMenuSlider(Horsehair *module) {
+        quantity = new UnisonQuantity(module, s);
+        box.size.x = 200.0f;
+    }
+    virtual ~UnisonMenuSlider() {
+        delete quantity;
+    }
+};
+
+/**
+ * Struct for keeping track of the value in the right click menu for the
+ * FM input and osc A to B FM amounts
+ */
+struct FmQuantity : Quantity {
+    enum Setting {
+        INPUT_AMOUNT,
+        A_TO_B
+    };
+
+    Horsehair* _module;
+    Setting _setting;
+
+    FmQuantity(Horsehair *m, Setting s) : _module(m), _setting(s) {}
+
+    void setValue(float value) override {
+        value = clamp(value, getMinValue(), getMaxValue());
+        if (_module && _setting == INPUT_AMOUNT) {
+            _module->fmAmount = value;
+        }
+        if (_module && _setting == A_TO_B) {
+            _module->fmAToB = value;
+        }
+    }
+
+    float getValue() override {
+        if (_module && _setting == INPUT_AMOUNT) {
+            return _module->fmAmount;
+        }
+        if (_module && _setting == A_TO_B) {
+            return _module->fmAToB;
+        }
+        return getDefaultValue();
+    }
+
+    float getMinValue() override {
+        return 0.0f;
+    }
+    float getMaxValue() override {
+        return 1.0f;
+    }
+    float getDefaultValue() override {
+        return _setting == INPUT_AMOUNT ? 1.0f : 0.0f;
+    }
+    float getDisplayValue() override {
+        return roundf(100.0f * getValue());
+    }
+    void setDisplayValue(float displayValue) override {
+        setValue(displayValue / 100.0f);
+    }
+    std::string getLabel() override {
+        return _setting == INPUT_AMOUNT ? "FM input amount" : "Osc A to B FM";
+    }
+    std::string getUnit() override {
+        return "%";
+    }
+};
+
+/**
+ * Slider used in menu for FM amounts
+ */
+template<FmQuantity::Setting s>
+struct FmMenuSlider : ui::Slider {
+    explicit FmMenuSlider(Horsehair *module) {
+        quantity = new FmQuantity(module, s);
+        box.size.x = 200.0f;
+    }
+    virtual ~FmMenuSlider() {
+        delete quantity;
     }
 };
 
@@ -311,10 +566,47 @@ struct HorsehairWidget : ModuleWidget {
         addParam(createParam<RoundLargeBlackKnob>(Vec(RACK_GRID_WIDTH * 3.5f - (38.0f / 2), 264.0), module, Horsehair::MIX_PARAM));
         addInput(createInput<ThemedPJ301MPort>(Vec(RACK_GRID_WIDTH - 8, 277.0), module, Horsehair::MIX_CV_INPUT));
 
+        // Sync
+        addInput(createInput<ThemedPJ301MPort>(Vec(RACK_GRID_WIDTH * 3.5f - (25.0f / 2), 180.0), module, Horsehair::SYNC_INPUT));
+
+        // Linear FM
+        addInput(createInput<ThemedPJ301MPort>(Vec(RACK_GRID_WIDTH * 4 + 13, 279.0), module, Horsehair::FM_INPUT));
+
         // Output
         addOutput(createOutput<ThemedPJ301MPort>(Vec(RACK_GRID_WIDTH + 3, 320.0), module, Horsehair::MIX_OUTPUT));
         addOutput(createOutput<ThemedPJ301MPort>(Vec(RACK_GRID_WIDTH * 4 + 3, 320.0), module, Horsehair::SIN_OUTPUT));
     }
+
+    void appendContextMenu(Menu *menu) override {
+        Horsehair* module = getModule<Horsehair>();
+
+        menu->addChild(new MenuSeparator);
+        menu->addChild(createIndexSubmenuItem("Unison", {"Off", "2 voices", "4 voices", "8 voices"},
+        [ = ]() {
+            return static_cast<size_t>(math::log2(module->unison));
+        },
+        [ = ](size_t index) {
+            module->setUnison(1 << index);
+        }));
+        menu->addChild(new UnisonMenuSlider<UnisonQuantity::DETUNE>(module));
+        menu->addChild(new UnisonMenuSlider<UnisonQuantity::SPREAD>(module));
+        menu->addChild(createBoolPtrMenuItem("Stereo unison (sine out is right channel)", "", &module->unisonStereo));
+
+        menu->addChild(new MenuSeparator);
+        menu->addChild(createIndexPtrSubmenuItem("Sync input target", {"Osc A", "Osc B", "Osc A and B"}, &module->syncTarget));
+        menu->addChild(createBoolPtrMenuItem("Sync osc B to osc A", "", &module->syncBToA));
+        menu->addChild(createBoolPtrMenuItem("Soft sync", "", &module->softSync));
+
+        menu->addChild(new MenuSeparator);
+        menu->addChild(createIndexPtrSubmenuItem("FM input target", {"Osc A", "Osc B", "Osc A and B"}, &module->fmTarget));
+        menu->addChild(new FmMenuSlider<FmQuantity::INPUT_AMOUNT>(module));
+        menu->addChild(new FmMenuSlider<FmQuantity::A_TO_B>(module));
+        menu->addChild(createBoolPtrMenuItem("Through-zero FM", "", &module->throughZeroFm));
+
+        appendRecorderMenu(menu, &module->recorder, [ = ]() {
+            return std::vector<Module*> {module};
+        }, "horsehair");
+    }
 };
 
 Model* modelHorsehair = createModel<Horsehair, HorsehairWidget>("Horsehair");
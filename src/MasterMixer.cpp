@@ -1,7 +1,8 @@
 #include "QuantalAudio.hpp"
 #include "Daisy.hpp"
+#include "core/Simd.hpp"
 
-constexpr float SLEW_SPEED = 6.f; // For smoothing out CV
+using quantal::float4;
 
 struct MasterMixer : Module {
     enum ParamIds {
@@ -23,7 +24,17 @@ struct MasterMixer : Module {
     };
 
     bool levelSlew = true;
-    SimpleSlewer levelSlewer[16];
+    PolySlewer levelSlewer;
+
+    // Mixing routine for the jacks patched, reselected when they change;
+    // null while no channel is patched and the outputs are held at 0V
+    typedef void (MasterMixer::*MixPath)(int channels);
+    MixPath mixPath = nullptr;
+    int pathKey = -1;
+
+    // Level CV and the levels it sets, rounded up to whole float4s
+    float cv[16] = {};
+    float levels[16] = {};
 
     MasterMixer() {
         config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS);
@@ -41,9 +52,7 @@ struct MasterMixer : Module {
         configOutput(MIX_OUTPUT, "Mix 1");
         configOutput(MIX_OUTPUT_2, "Mix 2");
 
-        for (int c = 0; c < 16; c++) {
-            levelSlewer[c].setSlewSpeed(SLEW_SPEED);
-        }
+        levelSlewer.setSlewSpeed(SLEW_SPEED, APP->engine->getSampleRate());
     }
 
     json_t* dataToJson() override {
@@ -70,81 +79,132 @@ struct MasterMixer : Module {
     }
 
     void onSampleRateChange() override {
-        for (int c = 0; c < 16; c++) {
-            levelSlewer[c].setSlewSpeed(SLEW_SPEED);
-        }
+        levelSlewer.setSlewSpeed(SLEW_SPEED, APP->engine->getSampleRate());
     }
 
-    void process(const ProcessArgs &args) override {
-        float mix[16] = {};
-        float mix_cv[16] = {};
-        float mix_out[2][16] = {};
-
-        int maxChannels = 1;
-        const bool is_mono = (params[MONO_PARAM].getValue() > 0.0f);
-        const float master_gain = params[MIX_LVL_PARAM].getValue();
-
-        for (int i = 0; i < 2; i++) {
-            int channels = 1;
-            float ch[16] = {};
-
-            if (inputs[CH_INPUT + i].isConnected()) {
-                channels = inputs[CH_INPUT + i].getChannels();
-                maxChannels = std::max(maxChannels, channels);
+    /**
+     * Mix the patched channel inputs into the mix outputs
+     *
+     * Instantiated for each combination of patched channel 1 and 2 inputs,
+     * patched CV and stereo mode, so each only does the work it needs.
+     * Inputs above their channel count read as 0V, as Rack clears them.
+     */
+    template <bool CH1, bool CH2, bool CV, bool STEREO>
+    void mix(int channels) {
+        const float masterGain = params[MIX_LVL_PARAM].getValue();
+        const float level1 = params[LVL_PARAM + 0].getValue();
+        const float level2 = params[LVL_PARAM + 1].getValue();
+        const float4 gain1 = level1 * level1;
+        const float4 gain2 = level2 * level2;
+
+        if (CV) {
+            Input &cvInput = inputs[MIX_CV_INPUT];
+            const bool cvMono = cvInput.isMonophonic();
+            for (int c = 0; c < channels; c += 4) {
+                const float4 v = cvMono ? float4(cvInput.getVoltage()) : float4::load(cvInput.getVoltages(c));
+                v.store(&cv[c]);
+            }
+            levelSlewer.process(cv, levels, channels, levelSlew);
+        }
 
-                inputs[CH_INPUT + i].readVoltages(ch);
+        for (int c = 0; c < channels; c += 4) {
+            float4 ch1 = 0.f;
+            float4 ch2 = 0.f;
+            if (CH1) {
+                ch1 = float4::load(inputs[CH_INPUT + 0].getVoltages(c)) * gain1;
+                ch1.store(outputs[CH_OUTPUT + 0].getVoltages(c));
+            }
+            if (CH2) {
+                ch2 = float4::load(inputs[CH_INPUT + 1].getVoltages(c)) * gain2;
+                ch2.store(outputs[CH_OUTPUT + 1].getVoltages(c));
+            }
 
-                const float gain = std::pow(params[LVL_PARAM + i].getValue(), 2.f);
-                for (int c = 0; c < channels; c++) {
-                    ch[c] *= gain;
-                    mix[c] += ch[c];
-                    mix_out[i][c] += ch[c];
-                }
+            float4 gain = masterGain;
+            if (CV) {
+                gain *= float4::load(&levels[c]);
             }
 
-            if (outputs[CH_OUTPUT + i].isConnected()) {
-                outputs[CH_OUTPUT + i].setChannels(channels);
-                outputs[CH_OUTPUT + i].writeVoltages(ch);
+            if (STEREO) {
+                (ch1 * gain).store(outputs[MIX_OUTPUT].getVoltages(c));
+                (ch2 * gain).store(outputs[MIX_OUTPUT_2].getVoltages(c));
+            } else {
+                // Mono->stereo: the same mix on both outputs
+                const float4 mix = (ch1 + ch2) * gain;
+                mix.store(outputs[MIX_OUTPUT].getVoltages(c));
+                mix.store(outputs[MIX_OUTPUT_2].getVoltages(c));
             }
         }
+    }
 
-        // Gather poly values from CV input
-        if (inputs[MIX_CV_INPUT].isConnected()) {
-            for (int c = 0; c < maxChannels; c++) {
-                mix_cv[c] = clamp(inputs[MIX_CV_INPUT].getPolyVoltage(c) / 10.f, 0.f, 1.f);
-                if (levelSlew) {
-                    mix_cv[c] = levelSlewer[c].process(mix_cv[c]);
-                }
-            }
+    /**
+     * Pick the mixing routine for the jacks patched and the mode switch
+     */
+    void selectMixPath(bool ch1, bool ch2, bool cv, bool stereo) {
+        static const MixPath monoPaths[8] = {
+            nullptr,
+            &MasterMixer::mix<true, false, false, false>,
+            &MasterMixer::mix<false, true, false, false>,
+            &MasterMixer::mix<true, true, false, false>,
+            nullptr,
+            &MasterMixer::mix<true, false, true, false>,
+            &MasterMixer::mix<false, true, true, false>,
+            &MasterMixer::mix<true, true, true, false>,
+        };
+        // Stereo needs both channel inputs patched
+        if (stereo && ch1 && ch2) {
+            mixPath = cv ? &MasterMixer::mix<true, true, true, true> : &MasterMixer::mix<true, true, false, true>;
         } else {
-            for (int c = 0; c < maxChannels; c++) {
-                mix_cv[c] = 1.f;
-            }
+            mixPath = monoPaths[ch1 | (ch2 << 1) | (cv << 2)];
         }
 
-        if (!is_mono && (inputs[CH_INPUT + 0].isConnected() && inputs[CH_INPUT + 1].isConnected())) {
-            // If the ch 2 jack is active use stereo mode
-            for (int c = 0; c < maxChannels; c++) {
-                const float attenuate = master_gain * mix_cv[c];
-                mix_out[0][c] *= attenuate;
-                mix_out[1][c] *= attenuate;
+        // The mix doesn't touch the outputs of unpatched channels, so leave
+        // them at 0V
+        for (int i = 0; i < 2; i++) {
+            if (!(i == 0 ? ch1 : ch2)) {
+                outputs[CH_OUTPUT + i].setChannels(1);
+                outputs[CH_OUTPUT + i].setVoltage(0.f);
             }
-            outputs[MIX_OUTPUT].setChannels(maxChannels);
-            outputs[MIX_OUTPUT].writeVoltages(mix_out[0]);
-            outputs[MIX_OUTPUT_2].setChannels(maxChannels);
-            outputs[MIX_OUTPUT_2].writeVoltages(mix_out[1]);
-        } else {
-            // Otherwise use mono->stereo mode
-            for (int c = 0; c < maxChannels; c++) {
-                const float attenuate = master_gain * mix_cv[c];
-                mix[c] *= attenuate;
+        }
+
+        // With nothing patched the mix is silent whatever the levels, so
+        // set it once and skip processing until something is
+        if (!mixPath) {
+            for (int i = 0; i < 2; i++) {
+                outputs[MIX_OUTPUT + i].setChannels(1);
+                outputs[MIX_OUTPUT + i].setVoltage(0.f);
             }
-            outputs[MIX_OUTPUT].setChannels(maxChannels);
-            outputs[MIX_OUTPUT].writeVoltages(mix);
-            outputs[MIX_OUTPUT_2].setChannels(maxChannels);
-            outputs[MIX_OUTPUT_2].writeVoltages(mix);
         }
     }
+
+    void process(const ProcessArgs &args) override {
+        const bool ch1 = inputs[CH_INPUT + 0].isConnected();
+        const bool ch2 = inputs[CH_INPUT + 1].isConnected();
+        const bool cv = inputs[MIX_CV_INPUT].isConnected();
+        const bool stereo = params[MONO_PARAM].getValue() <= 0.0f;
+
+        const int key = ch1 | (ch2 << 1) | (cv << 2) | (stereo << 3);
+        if (key != pathKey) {
+            selectMixPath(ch1, ch2, cv, stereo);
+            pathKey = key;
+        }
+        if (!mixPath) {
+            return;
+        }
+
+        const int channels1 = ch1 ? inputs[CH_INPUT + 0].getChannels() : 1;
+        const int channels2 = ch2 ? inputs[CH_INPUT + 1].getChannels() : 1;
+        const int channels = std::max(channels1, channels2);
+
+        if (ch1) {
+            outputs[CH_OUTPUT + 0].setChannels(channels1);
+        }
+        if (ch2) {
+            outputs[CH_OUTPUT + 1].setChannels(channels2);
+        }
+        (this->*mixPath)(channels);
+        outputs[MIX_OUTPUT].setChannels(channels);
+        outputs[MIX_OUTPUT_2].setChannels(channels);
+    }
 };
 
 struct MasterMixerWidget : ModuleWidget {
@@ -192,6 +252,9 @@ struct MasterMixerWidget : ModuleWidget {
 
         menu->addChild(new MenuSeparator);
         menu->addChild(createBoolPtrMenuItem("Smooth level CV", "", &module->levelSlew));
+
+        menu->addChild(new MenuSeparator);
+        menu->addChild(createMenuLabel(string::f("DSP kernels: %s", kernels->name)));
     }
 };
 
@@ -5,10 +5,14 @@ Plugin* pluginInstance;
 void init(Plugin *p) {
     pluginInstance = p;
 
+    // Pick the DSP kernels for this CPU before any module is created
+    initKernels();
+
     // Add all Models defined throughout the pluginInstance
     p->addModel(modelMasterMixer);
     p->addModel(modelBufferedMult);
     p->addModel(modelUnityMix);
+    p->addModel(modelUnityMixExpander);
     p->addModel(modelDaisyBlank);
     p->addModel(modelDaisyChannel);
     p->addModel(modelDaisyChannel2);
@@ -16,6 +20,9 @@ void init(Plugin *p) {
     p->addModel(modelDaisyChannelVu);
     p->addModel(modelDaisyMaster);
     p->addModel(modelDaisyMaster2);
+    p->addModel(modelDaisyGroup);
+    p->addModel(modelDaisyBridgeSend);
+    p->addModel(modelDaisyBridgeReceive);
     p->addModel(modelHorsehair);
     p->addModel(modelBlank1);
     p->addModel(modelBlank3);
@@ -1,5 +1,6 @@
 #pragma once
 #include "rack.hpp"
+#include "core/Kernels.hpp"
 
 using namespace rack;
 
@@ -10,6 +11,7 @@ extern Plugin* pluginInstance;
 extern Model* modelMasterMixer;
 extern Model* modelBufferedMult;
 extern Model* modelUnityMix;
+extern Model* modelUnityMixExpander;
 extern Model* modelDaisyBlank;
 extern Model* modelDaisyChannel;
 extern Model* modelDaisyChannel2;
@@ -17,6 +19,9 @@ extern Model* modelDaisyChannelSends2;
 extern Model* modelDaisyChannelVu;
 extern Model* modelDaisyMaster;
 extern Model* modelDaisyMaster2;
+extern Model* modelDaisyGroup;
+extern Model* modelDaisyBridgeSend;
+extern Model* modelDaisyBridgeReceive;
 extern Model* modelHorsehair;
 extern Model* modelBlank1;
 extern Model* modelBlank3;
@@ -0,0 +1,259 @@
+#if !defined(QUANTAL_RECORDER_H)
+#define QUANTAL_RECORDER_H 1
+
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <ctime>
+#include <thread>
+
+#include "QuantalAudio.hpp"
+#include "core/Recording.hpp"
+#include "core/SpscRing.hpp"
+
+// Ring buffer between the audio thread and the file writer, in bytes: about
+// a second of 16 fully polyphonic strips
+constexpr size_t RECORDER_RING_SIZE = 16 << 20;
+
+/**
+ * Records the params and input voltages of a row of modules to a file, so
+ * `quantal-replay` can run the same modules on the same workload offline
+ *
+ * start() and stop() are called from the UI thread. The audio thread calls
+ * process() once per frame, which only copies the frame into a ring buffer;
+ * a background thread writes the ring buffer out to the file. If the disk
+ * can't keep up, recording stops early and the file ends at the last whole
+ * frame.
+ *
+ * The last module is the one that owns the recorder. Recording also stops
+ * if the row is broken up, e.g. a module in it is removed.
+ */
+struct ModuleRecorder {
+    // Modules being recorded, left to right
+    std::vector<Module*> modules;
+
+    ~ModuleRecorder() {
+        stop();
+    }
+
+    bool isRecording() const {
+        return recording.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Whether the last recording stopped because the disk fell behind
+     */
+    bool didOverrun() const {
+        return overrun.load();
+    }
+
+    const std::string &getPath() const {
+        return path;
+    }
+
+    /**
+     * Start recording `modules` for `seconds` to a new file in the user
+     * folder, named after `name`. Returns false if the file can't be
+     * created.
+     */
+    bool start(const std::vector<Module*> &recordModules, float seconds, const std::string &name) {
+        stop();
+
+        const std::string dir = asset::user("QuantalAudio/recordings");
+        system::createDirectories(dir);
+        char stamp[32];
+        const std::time_t now = std::time(nullptr);
+        std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", std::localtime(&now));
+        path = system::join(dir, name + "-" + stamp + ".qrec");
+
+        file = std::fopen(path.c_str(), "wb");
+        if (!file) {
+            path.clear();
+            return false;
+        }
+
+        modules = recordModules;
+        const float sampleRate = APP->engine->getSampleRate();
+        std::vector<quantal::RecordedModule> header;
+        size_t frameSize = 0;
+        lastParams.clear();
+        for (Module* m : modules) {
+            quantal::RecordedModule info;
+            info.slug = m->model->slug;
+            json_t* dataJ = m->dataToJson();
+            if (dataJ) {
+                char* text = json_dumps(dataJ, JSON_COMPACT);
+                info.data = text;
+                std::free(text);
+                json_decref(dataJ);
+            }
+            for (int p = 0; p < std::min(m->getNumParams(), 255); p++) {
+                info.params.push_back(m->params[p].getValue());
+            }
+            info.numInputs = std::min(m->getNumInputs(), 255);
+            for (int o = 0; o < std::min(m->getNumOutputs(), 255); o++) {
+                info.outputsConnected.push_back(m->outputs[o].isConnected());
+            }
+            header.push_back(info);
+            lastParams.push_back(info.params);
+
+            frameSize += 1 + 5 * info.params.size() + (1 + 4 * 16) * info.numInputs;
+        }
+
+        std::vector<uint8_t> bytes;
+        quantal::writeRecordingHeader(bytes, sampleRate, header);
+        std::fwrite(bytes.data(), 1, bytes.size(), file);
+
+        frame.resize(frameSize);
+        ring.reset(new quantal::SpscRing<uint8_t>(std::max(RECORDER_RING_SIZE, 4 * frameSize)));
+        framesLeft = static_cast<int64_t>(seconds * sampleRate);
+        overrun = false;
+        recording.store(true, std::memory_order_release);
+        writer = std::thread([this]() {
+            writeLoop();
+        });
+        return true;
+    }
+
+    /**
+     * Stop recording and wait for the file to be written
+     */
+    void stop() {
+        recording.store(false);
+        // Let a process() call that saw the recording still running finish
+        // with the ring before it can be replaced
+        while (inProcess.load()) {
+            std::this_thread::yield();
+        }
+        if (writer.joinable()) {
+            writer.join();
+        }
+    }
+
+    /**
+     * Copy this frame's params and inputs into the ring buffer. Audio
+     * thread only.
+     */
+    void process() {
+        inProcess.store(true);
+        if (!recording.load()) {
+            inProcess.store(false);
+            return;
+        }
+
+        // Walk from the owner leftwards, so no module is touched after it
+        // has left the row
+        for (size_t i = modules.size() - 1; i > 0; i--) {
+            if (modules[i]->leftExpander.module != modules[i - 1]) {
+                recording.store(false, std::memory_order_release);
+                inProcess.store(false);
+                return;
+            }
+        }
+
+        size_t n = 0;
+        uint8_t* out = frame.data();
+        for (size_t i = 0; i < modules.size(); i++) {
+            Module* m = modules[i];
+            std::vector<float> &last = lastParams[i];
+
+            // Params are only written when they change
+            const size_t countPos = n++;
+            uint8_t changed = 0;
+            for (size_t p = 0; p < last.size(); p++) {
+                const float v = m->params[p].getValue();
+                if (v != last[p]) {
+                    last[p] = v;
+                    out[n++] = p;
+                    std::memcpy(out + n, &v, 4);
+                    n += 4;
+                    changed++;
+                }
+            }
+            out[countPos] = changed;
+
+            const int numInputs = std::min(m->getNumInputs(), 255);
+            for (int j = 0; j < numInputs; j++) {
+                const int channels = m->inputs[j].getChannels();
+                out[n++] = channels;
+                std::memcpy(out + n, m->inputs[j].getVoltages(), 4 * channels);
+                n += 4 * channels;
+            }
+        }
+
+        if (!ring->write(out, n)) {
+            overrun = true;
+            recording.store(false, std::memory_order_release);
+        } else if (--framesLeft <= 0) {
+            recording.store(false, std::memory_order_release);
+        }
+        inProcess.store(false);
+    }
+
+private:
+
+    std::atomic<bool> recording{false};
+    std::atomic<bool> overrun{false};
+    std::atomic<bool> inProcess{false};
+    std::thread writer;
+    std::FILE* file = nullptr;
+    std::string path;
+
+    // Audio thread state
+    std::unique_ptr<quantal::SpscRing<uint8_t>> ring;
+    std::vector<uint8_t> frame;
+    std::vector<std::vector<float>> lastParams;
+    int64_t framesLeft = 0;
+
+    void writeLoop() {
+        std::vector<uint8_t> chunk(1 << 16);
+        while (true) {
+            // Once recording has stopped, the audio thread has written its
+            // last frame, so one more pass empties the ring
+            const bool done = !isRecording();
+            size_t n;
+            while ((n = ring->read(chunk.data(), chunk.size())) > 0) {
+                std::fwrite(chunk.data(), 1, n, file);
+            }
+            if (done) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        std::fclose(file);
+        file = nullptr;
+    }
+};
+
+/**
+ * Add the developer-mode menu items to record `recorder`'s owner and the
+ * modules returned by `getModules`
+ */
+inline void appendRecorderMenu(Menu* menu, ModuleRecorder* recorder, std::function<std::vector<Module*>()> getModules, std::string name) {
+    if (!settings::devMode) {
+        return;
+    }
+
+    menu->addChild(new MenuSeparator);
+    if (recorder->isRecording()) {
+        menu->addChild(createMenuItem("Stop recording workload", "", [ = ]() {
+            recorder->stop();
+        }));
+    } else {
+        menu->addChild(createSubmenuItem("Record workload", "", [ = ](Menu * menu) {
+            for (int seconds : {5, 10, 30, 60}) {
+                menu->addChild(createMenuItem(string::f("%d seconds", seconds), "", [ = ]() {
+                    recorder->start(getModules(), seconds, name);
+                }));
+            }
+        }));
+    }
+    if (!recorder->getPath().empty()) {
+        menu->addChild(createMenuLabel(recorder->getPath()));
+        if (recorder->didOverrun()) {
+            menu->addChild(createMenuLabel("Stopped early: the disk fell behind"));
+        }
+    }
+}
+
+#endif
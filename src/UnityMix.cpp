@@ -1,9 +1,5 @@
 #include "QuantalAudio.hpp"
-
-struct polysignal {
-    float signals[16] = {};
-    int channels = 1;
-};
+#include "UnityMix.hpp"
 
 struct UnityMix : Module {
     enum ParamIds {
@@ -22,6 +18,16 @@ struct UnityMix : Module {
         NUM_LIGHTS
     };
 
+    UnityMixGroups groups;
+    UnityMixMessage expanderMessages[2][1];
+
+    // Inputs averaged into each output, and 1 / that, kept until it changes
+    int averagedCounts[2] = {};
+    float reciprocals[2] = {};
+
+    // Group sums, rounded up to whole float4s
+    float sums[2][16] = {};
+
     UnityMix() {
         config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
         configSwitch(CONNECT_PARAM, 0.0f, 1.0f, 1.0f, "Connect mode", {"Group All (6:1)", "Groups A, B (3:1 x 2)"});
@@ -35,58 +41,60 @@ struct UnityMix : Module {
 
         configOutput(CH_OUTPUT + 0, "Group A");
         configOutput(CH_OUTPUT + 1, "Group B");
-    }
-
-    polysignal mixChannels(int in_start, int in_end) {
-        float in[16] = {};
-        struct polysignal mix;
-        float channels = 0.f;
-        int maxChannels = 1;
-
-        for (int i = in_start; i <= in_end; i++) {
-            if (inputs[CH_INPUT + i].isConnected()) {
-                mix.channels = inputs[CH_INPUT + i].getChannels();
-                maxChannels = std::max(mix.channels, maxChannels);
-                inputs[CH_INPUT + i].readVoltages(in);
 
-                for (int c = 0; c < mix.channels; c++) {
-                    mix.signals[c] += in[c];
-                }
+        // Set the right expander message instances
+        rightExpander.producerMessage = &expanderMessages[0];
+        rightExpander.consumerMessage = &expanderMessages[1];
+    }
 
-                // Keep track of number of plugs so we can average
-                channels++;
-            }
+    /**
+     * Write the average of `count` inputs summed in `sum` to output `o`
+     */
+    void writeAverage(int o, const float* sum, int count, int channels) {
+        if (count != averagedCounts[o]) {
+            averagedCounts[o] = count;
+            reciprocals[o] = (count > 0) ? 1.f / count : 0.f;
         }
-
-        if (channels > 0.f) {
-            mix.channels = maxChannels;
-            for (int c = 0; c < maxChannels; c++) {
-                mix.signals[c] = mix.signals[c] / channels;
-            }
+        const float4 reciprocal = reciprocals[o];
+        for (int c = 0; c < channels; c += 4) {
+            (float4::load(&sum[c]) * reciprocal).store(outputs[CH_OUTPUT + o].getVoltages(c));
         }
-
-        return mix;
+        outputs[CH_OUTPUT + o].setChannels(channels);
     }
 
     void process(const ProcessArgs &args) override {
         bool unconnect = (params[CONNECT_PARAM].getValue() > 0.0f);
 
+        groups.update(this, CH_INPUT);
+
+        // Inputs from any expanders to the right
+        const UnityMixMessage* right = nullptr;
+        if (rightExpander.module && rightExpander.module->model == modelUnityMixExpander) {
+            right = static_cast<const UnityMixMessage*>(rightExpander.consumerMessage);
+        }
+        int counts[2];
+        int channels[2];
+        for (int g = 0; g < 2; g++) {
+            channels[g] = groups.sum(this, g, sums[g], right);
+            counts[g] = groups.counts[g] + (right ? right->counts[g] : 0);
+        }
+
         if (unconnect) {
             // Group A : Inputs 0 1 2 -> Output 0
-            const polysignal mix1 = mixChannels(0, 2);
-            outputs[CH_OUTPUT + 0].setChannels(mix1.channels);
-            outputs[CH_OUTPUT + 0].writeVoltages(mix1.signals);
+            writeAverage(0, sums[0], counts[0], channels[0]);
             // Group B : Inputs 3 4 5 -> Output 1
-            const polysignal mix2 = mixChannels(3, 5);
-            outputs[CH_OUTPUT + 1].setChannels(mix2.channels);
-            outputs[CH_OUTPUT + 1].writeVoltages(mix2.signals);
+            writeAverage(1, sums[1], counts[1], channels[1]);
         } else {
             // Combined : Inputs 0-5 -> Output 1 & 2
-            const polysignal mix = mixChannels(0, 5);
-            outputs[CH_OUTPUT + 0].setChannels(mix.channels);
-            outputs[CH_OUTPUT + 0].writeVoltages(mix.signals);
-            outputs[CH_OUTPUT + 1].setChannels(mix.channels);
-            outputs[CH_OUTPUT + 1].writeVoltages(mix.signals);
+            const int combined = std::max(channels[0], channels[1]);
+            for (int c = 0; c < combined; c += 4) {
+                // Above a group's channel count its sum may be stale
+                const float4 a = (c < channels[0]) ? float4::load(&sums[0][c]) : float4(0.f);
+                const float4 b = (c < channels[1]) ? float4::load(&sums[1][c]) : float4(0.f);
+                (a + b).store(&sums[0][c]);
+            }
+            writeAverage(0, sums[0], counts[0] + counts[1], combined);
+            writeAverage(1, sums[0], counts[0] + counts[1], combined);
         }
     }
 };
@@ -120,6 +128,11 @@ struct UnityMixWidget : ModuleWidget {
         addInput(createInput<ThemedPJ301MPort>(Vec(RACK_GRID_WIDTH - 12.5f, 278.0), module, UnityMix::CH_INPUT + 5));
         addOutput(createOutput<ThemedPJ301MPort>(Vec(RACK_GRID_WIDTH - 12.5f, 320.0), module, UnityMix::CH_OUTPUT + 1));
     }
+
+    void appendContextMenu(Menu *menu) override {
+        menu->addChild(new MenuSeparator);
+        menu->addChild(createMenuLabel(string::f("DSP kernels: %s", kernels->name)));
+    }
 };
 
 Model* modelUnityMix = createModel<UnityMix, UnityMixWidget>("UnityMix");
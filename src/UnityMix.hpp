@@ -0,0 +1,84 @@
+#if !defined(UNITY_MIX_H)
+#define UNITY_MIX_H 1
+
+#include "QuantalAudio.hpp"
+#include "core/Simd.hpp"
+
+using quantal::float4;
+
+/**
+ * Sums passed leftwards along a row of UnityMix expanders to the UnityMix
+ *
+ * Group A is the first three inputs of each module and group B the last
+ * three. Each expander adds its inputs to what it gets from its right, so
+ * the UnityMix sees the whole row, one frame later per expander.
+ */
+struct UnityMixMessage {
+    // Sum of the patched inputs of each group
+    float sums[2][16] = {};
+    // Number of inputs patched into each group
+    int counts[2] = {};
+    // Most channels of any input patched into each group
+    int channels[2] = {};
+};
+
+/**
+ * Which of a module's six inputs are patched, by group
+ *
+ * The lists are only rebuilt when the patching changes, so summing a group
+ * doesn't check every input each frame.
+ */
+struct UnityMixGroups {
+    // Input ids patched into each group
+    int patched[2][3] = {};
+    int counts[2] = {};
+
+    void update(Module* module, int firstInput) {
+        int mask = 0;
+        for (int i = 0; i < 6; i++) {
+            mask |= module->inputs[firstInput + i].isConnected() << i;
+        }
+        if (mask == patchedMask) {
+            return;
+        }
+        patchedMask = mask;
+        for (int g = 0; g < 2; g++) {
+            counts[g] = 0;
+            for (int i = 3 * g; i < 3 * g + 3; i++) {
+                if (mask & (1 << i)) {
+                    patched[g][counts[g]++] = firstInput + i;
+                }
+            }
+        }
+    }
+
+    /**
+     * Write the sum of group `g`'s patched inputs, plus the same group of
+     * `right` when not null, to `out`. Returns the channel count, at least 1.
+     *
+     * `out` is written in whole float4s; inputs read 0V above their channel
+     * count, as Rack clears them.
+     */
+    int sum(Module* module, int g, float* out, const UnityMixMessage* right) const {
+        const int rightChannels = right ? right->channels[g] : 0;
+        int channels = std::max(rightChannels, 1);
+        for (int k = 0; k < counts[g]; k++) {
+            channels = std::max(channels, module->inputs[patched[g][k]].getChannels());
+        }
+
+        for (int c = 0; c < channels; c += 4) {
+            float4 s = (c < rightChannels) ? float4::load(&right->sums[g][c]) : float4(0.f);
+            for (int k = 0; k < counts[g]; k++) {
+                s += float4::load(module->inputs[patched[g][k]].getVoltages(c));
+            }
+            s.store(&out[c]);
+        }
+        return channels;
+    }
+
+private:
+
+    int patchedMask = -1;
+};
+
+#endif
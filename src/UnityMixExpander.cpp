@@ -0,0 +1,90 @@
+#include "QuantalAudio.hpp"
+#include "UnityMix.hpp"
+
+struct UnityMixExpander : Module {
+    enum ParamIds {
+        NUM_PARAMS
+    };
+    enum InputIds {
+        ENUMS(CH_INPUT, 6),
+        NUM_INPUTS
+    };
+    enum OutputIds {
+        NUM_OUTPUTS
+    };
+    enum LightsIds {
+        NUM_LIGHTS
+    };
+
+    UnityMixGroups groups;
+    UnityMixMessage expanderMessages[2][1];
+
+    UnityMixExpander() {
+        config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
+
+        configInput(CH_INPUT + 0, "A1");
+        configInput(CH_INPUT + 1, "A2");
+        configInput(CH_INPUT + 2, "A3");
+        configInput(CH_INPUT + 3, "B1");
+        configInput(CH_INPUT + 4, "B2");
+        configInput(CH_INPUT + 5, "B3");
+
+        // Set the right expander message instances
+        rightExpander.producerMessage = &expanderMessages[0];
+        rightExpander.consumerMessage = &expanderMessages[1];
+    }
+
+    void process(const ProcessArgs &args) override {
+        // Only useful in a row ending at a UnityMix on the left
+        if (!leftExpander.module || (
+                leftExpander.module->model != modelUnityMix
+                && leftExpander.module->model != modelUnityMixExpander
+            )) {
+            return;
+        }
+
+        groups.update(this, CH_INPUT);
+
+        // Inputs from any expanders further right
+        const UnityMixMessage* right = nullptr;
+        if (rightExpander.module && rightExpander.module->model == modelUnityMixExpander) {
+            right = static_cast<const UnityMixMessage*>(rightExpander.consumerMessage);
+        }
+
+        // Pass this module's inputs, added to those from the right, to the left
+        UnityMixMessage* msgToModule = static_cast<UnityMixMessage*>(leftExpander.module->rightExpander.producerMessage);
+        for (int g = 0; g < 2; g++) {
+            msgToModule->channels[g] = groups.sum(this, g, msgToModule->sums[g], right);
+            msgToModule->counts[g] = groups.counts[g] + (right ? right->counts[g] : 0);
+        }
+        leftExpander.module->rightExpander.messageFlipRequested = true;
+    }
+};
+
+struct UnityMixExpanderWidget : ModuleWidget {
+    explicit UnityMixExpanderWidget(UnityMixExpander *module) {
+        setModule(module);
+        setPanel(
+            createPanel(
+                asset::plugin(pluginInstance, "res/UnityMixExpander.svg"),
+                asset::plugin(pluginInstance, "res/UnityMixExpander-dark.svg")
+            )
+        );
+
+        // Screws
+        addChild(createWidget<ThemedScrew>(Vec(RACK_GRID_WIDTH, 0)));
+        addChild(createWidget<ThemedScrew>(Vec(0, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
+
+        // Group A
+        addInput(createInput<ThemedPJ301MPort>(Vec(RACK_GRID_WIDTH - 12.5f, 50.0), module, UnityMixExpander::CH_INPUT + 0));
+        addInput(createInput<ThemedPJ301MPort>(Vec(RACK_GRID_WIDTH - 12.5f, 78.0), module, UnityMixExpander::CH_INPUT + 1));
+        addInput(createInput<ThemedPJ301MPort>(Vec(RACK_GRID_WIDTH - 12.5f, 106.0), module, UnityMixExpander::CH_INPUT + 2));
+
+        // Group B
+        addInput(createInput<ThemedPJ301MPort>(Vec(RACK_GRID_WIDTH - 12.5f, 222.0), module, UnityMixExpander::CH_INPUT + 3));
+        addInput(createInput<ThemedPJ301MPort>(Vec(RACK_GRID_WIDTH - 12.5f, 250.0), module, UnityMixExpander::CH_INPUT + 4));
+        addInput(createInput<ThemedPJ301MPort>(Vec(RACK_GRID_WIDTH - 12.5f, 278.0), module, UnityMixExpander::CH_INPUT + 5));
+    }
+};
+
+Model* modelUnityMixExpander = createModel<UnityMixExpander, UnityMixExpanderWidget>("UnityMixExpander");
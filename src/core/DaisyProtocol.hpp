@@ -0,0 +1,451 @@
+#if !defined(QUANTAL_CORE_DAISY_PROTOCOL_H)
+#define QUANTAL_CORE_DAISY_PROTOCOL_H 1
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <new>
+#include <vector>
+
+#include "Kernels.hpp"
+#include "Mixing.hpp"
+
+// Signals below -120 dB of Rack's 10V count as silent
+constexpr float SILENCE_THRESHOLD = 1e-5f;
+
+// Frames between control messages along a Daisy chain
+constexpr int DAISY_CONTROL_DIVISION = 32;
+
+// Mute groups a channel strip can join
+constexpr int DAISY_MUTE_GROUPS = 4;
+
+// VCA groups a channel strip can join
+constexpr int DAISY_VCA_GROUPS = 4;
+
+// Strips in each bank of D-MX2's stem outputs, one per polyphony channel
+constexpr int DAISY_STEM_BANK_SIZE = 16;
+
+// Most latency a channel strip can declare or be delayed by, in frames; no
+// longer than SilenceDetector holds on, so a delay's tail is out before a
+// strip idles
+constexpr int DAISY_MAX_LATENCY = 4096;
+
+// Bytes in a cache line on the CPUs Rack runs on
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+/**
+ * Chain state that changes at control rate, carried along a Daisy chain from
+ * left to right every DAISY_CONTROL_DIVISION frames rather than every frame
+ */
+struct DaisyControl {
+    int channel_strip_id = 1;
+    float first_pos_x = 0.0f;
+    float first_pos_y = 0.0f;
+
+    // A bit for each mute group with a strip muted so far along the chain
+    uint8_t mutedGroups = 0;
+
+    // Level of each VCA group so far along the chain, from the strips
+    // leading it
+    float vcaLevels[DAISY_VCA_GROUPS] = {1.f, 1.f, 1.f, 1.f};
+
+    // Most latency of any strip so far along the chain, in frames
+    int latency = 0;
+};
+
+/**
+ * The control data crossing one hop of a Daisy chain, apart from the audio
+ *
+ * Rack gives each side of a module one pair of expander messages, and the
+ * audio has the left pair. This is held by the module receiving it instead,
+ * and the module on its left reaches it through DaisyMessage::controlMessage.
+ * Rather than being flipped it has a slot for even frames and one for odd:
+ * the writer fills the slot of its frame and flags the DaisyMessage, and the
+ * flag reaches the reader on the next frame, when the writer is on the other
+ * slot. Only touched every DAISY_CONTROL_DIVISION frames.
+ */
+struct DaisyControlMessage {
+    DaisyControl slots[2];
+
+    DaisyControl &producer(const int64_t frame) {
+        return slots[frame & 1];
+    }
+
+    const DaisyControl &consumer(const int64_t frame) const {
+        return slots[(frame + 1) & 1];
+    }
+};
+
+/**
+ * Chain-wide control state sent back from the end of a Daisy chain towards
+ * its start
+ */
+struct DaisyReturn {
+    // A bit for each mute group with a strip muted anywhere in the chain
+    uint8_t mutedGroups = 0;
+
+    // Level of each VCA group, from every strip leading it along the chain
+    float vcaLevels[DAISY_VCA_GROUPS] = {1.f, 1.f, 1.f, 1.f};
+
+    // Most latency of any strip in the chain, in frames, which the other
+    // strips are delayed to match
+    int latency = 0;
+
+    // Bank of strips D-MX2 wants on its stem outputs, or -1 while they're
+    // unpatched
+    int stemBank = -1;
+
+    DaisyReturn() = default;
+
+    /**
+     * What the end of a chain sends back, from the control data that
+     * reached it
+     */
+    explicit DaisyReturn(const DaisyControl &control) : mutedGroups(control.mutedGroups), latency(control.latency) {
+        std::copy(control.vcaLevels, control.vcaLevels + DAISY_VCA_GROUPS, vcaLevels);
+    }
+};
+
+/**
+ * The chain's return, sent every DAISY_CONTROL_DIVISION frames
+ */
+struct DaisyReturnMessage {
+    bool hasControl = false;
+    DaisyReturn control;
+};
+
+struct DaisyMessage {
+    // Daisy-chained mix signal
+    StereoVoltages signals = {};
+
+    // Single module's signal
+    StereoVoltages singleSignals = {};
+
+    // Aux 1 send signal
+    StereoVoltages aux1Signals = {};
+
+    // Aux 2 send signal
+    StereoVoltages aux2Signals = {};
+
+    // Solo signals
+    StereoVoltages soloSignals = {};
+
+    // Each strip's signal summed to one channel a side, on the channel of
+    // its number within the stem bank; only sent while stems are wanted
+    StereoVoltages stemSignals = {};
+
+    // Whether every bus above is 0V on all 16 channels, so a strip with
+    // nothing to add can idle
+    bool silent = false;
+
+    // Whether the writer sent control data this frame, and where the reader
+    // finds it; the reader points both of its messages at its own
+    bool hasControl = false;
+    DaisyControlMessage* controlMessage = nullptr;
+
+    // Stamped by the writer when message checks are on, see MessageCheck;
+    // a sequence of 0 is unstamped
+    uint32_t sequence = 0;
+    uint32_t checksum = 0;
+};
+
+/**
+ * Debug check of the messages crossing one hop of a Daisy chain
+ *
+ * The writer stamps each message with a sequence number and a checksum of
+ * everything else in it just before requesting the flip, and the reader
+ * verifies them. A checksum that doesn't match is a torn read, the same
+ * message read twice is a stale read (the flip didn't happen), and a gap in
+ * the sequence is a skipped flip (a message was overwritten before it was
+ * read). Each module holds one for the hop it writes and the hop it reads.
+ */
+struct MessageCheck {
+    uint32_t torn = 0;
+    uint32_t stale = 0;
+    uint32_t skipped = 0;
+
+    /**
+     * Stamp a message about to be flipped, or mark it unstamped
+     */
+    void stamp(DaisyMessage &message, const bool enabled) {
+        if (!enabled) {
+            message.sequence = 0;
+            return;
+        }
+        sent = next(sent);
+        message.sequence = sent;
+        message.checksum = checksum(message);
+    }
+
+    /**
+     * Verify a message from `sender`; unstamped messages, and the first
+     * from a new sender, only set where the sequence starts
+     */
+    void check(const DaisyMessage &message, const void* sender) {
+        if (message.sequence == 0) {
+            received = 0;
+            return;
+        }
+        if (message.checksum != checksum(message)) {
+            torn++;
+            received = 0;
+            return;
+        }
+        if (received != 0 && sender == lastSender) {
+            if (message.sequence == received) {
+                stale++;
+            } else {
+                skipped += message.sequence - next(received);
+            }
+        }
+        received = message.sequence;
+        lastSender = sender;
+    }
+
+    void reset() {
+        torn = 0;
+        stale = 0;
+        skipped = 0;
+    }
+
+    static uint32_t checksum(const DaisyMessage &message) {
+        // FNV-1a over 32-bit words
+        uint32_t hash = 2166136261u;
+        auto add = [&hash](const void* words, size_t count) {
+            const unsigned char* bytes = static_cast<const unsigned char*>(words);
+            for (size_t i = 0; i < count; i++) {
+                uint32_t w;
+                std::memcpy(&w, bytes + 4 * i, 4);
+                hash = (hash ^ w) * 16777619u;
+            }
+        };
+        for (const StereoVoltages* bus : {
+                    &message.signals, &message.singleSignals, &message.aux1Signals, &message.aux2Signals, &message.soloSignals,
+                    &message.stemSignals
+                }) {
+            add(&bus->channels, 1);
+            add(bus->voltages_l, 16);
+            add(bus->voltages_r, 16);
+        }
+        const uint32_t flags = message.silent | (message.hasControl << 1);
+        add(&flags, 1);
+        add(&message.sequence, 1);
+        return hash;
+    }
+
+private:
+
+    // Sequence numbers skip 0, which marks an unstamped message
+    static uint32_t next(const uint32_t sequence) {
+        return (sequence == UINT32_MAX) ? 1 : sequence + 1;
+    }
+
+    uint32_t sent = 0;
+    uint32_t received = 0;
+    const void* lastSender = nullptr;
+};
+
+/**
+ * The producer and consumer messages of one side of an expander, each on
+ * cache lines of its own
+ *
+ * With Rack's engine threads, a neighbour may be writing the producer on one
+ * thread while this module reads the consumer on another. Held in the module
+ * the two would share lines with each other and with the module's own fields,
+ * and every write would take the line from the reader. These are allocated
+ * apart from the module, aligned and padded to whole lines.
+ */
+template <typename T>
+struct ExpanderMessages {
+    ExpanderMessages() {
+        // C++11's new doesn't honour alignas beyond 16 bytes, so align by hand
+        storage = new char[2 * STRIDE + CACHE_LINE_SIZE];
+        const uintptr_t start = (reinterpret_cast<uintptr_t>(storage) + CACHE_LINE_SIZE - 1) & ~uintptr_t(CACHE_LINE_SIZE - 1);
+        for (int i = 0; i < 2; i++) {
+            messages[i] = new (reinterpret_cast<char*>(start + i * STRIDE)) T();
+        }
+    }
+
+    ~ExpanderMessages() {
+        for (int i = 0; i < 2; i++) {
+            messages[i]->~T();
+        }
+        delete[] storage;
+    }
+
+    ExpanderMessages(const ExpanderMessages &) = delete;
+    ExpanderMessages &operator=(const ExpanderMessages &) = delete;
+
+    T* producer() {
+        return messages[0];
+    }
+
+    T* consumer() {
+        return messages[1];
+    }
+
+private:
+
+    static constexpr size_t STRIDE = (sizeof(T) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+
+    char* storage;
+    T* messages[2];
+};
+
+/**
+ * The left expander messages of a module on a Daisy chain, with the control
+ * message the module on its left writes into
+ */
+struct DaisyInputMessages : ExpanderMessages<DaisyMessage> {
+    DaisyControlMessage control;
+
+    DaisyInputMessages() {
+        producer()->controlMessage = &control;
+        consumer()->controlMessage = &control;
+    }
+};
+
+/**
+ * Turns up to 16 channels of level CV into levels from 0 to 1, optionally
+ * slewed to smooth out steps in the CV
+ */
+struct PolySlewer {
+    float values[16] = {};
+
+    /**
+     * Set how long a full 0 to 1 swing takes, in milliseconds
+     */
+    void setSlewSpeed(const float speed, const float sampleRate) {
+        delta = 1.f / (sampleRate * 0.001f * speed);
+    }
+
+    /**
+     * Write the level of each of `channels` channels of level CV `cv` to
+     * `levels`
+     */
+    void process(const float* cv, float* levels, const int channels, const bool slew) {
+        kernels->cvLevels(levels, cv, slew ? values : nullptr, delta, channels);
+    }
+
+private:
+
+    float delta = 0.0005f;
+};
+
+/**
+ * Moves a gain towards where it's set at a limited rate, so a gain that
+ * steps, such as one set at control rate, doesn't click
+ */
+struct GainSlewer {
+    float value = 1.f;
+
+    /**
+     * Set how long a full 0 to 1 swing takes, in milliseconds
+     */
+    void setSlewSpeed(const float speed, const float sampleRate) {
+        delta = 1.f / (sampleRate * 0.001f * speed);
+    }
+
+    float process(const float target) {
+        value += std::min(std::max(target - value, -delta), delta);
+        return value;
+    }
+
+private:
+
+    float delta = 0.0005f;
+};
+
+/**
+ * Tells when a signal has been silent long enough to stop processing it
+ *
+ * Silent means below SILENCE_THRESHOLD on every channel for `holdFrames`
+ * frames in a row; the first frame above it ends the silence.
+ */
+struct SilenceDetector {
+    int holdFrames = 4096;
+
+    /**
+     * Feed the peak of a frame; returns whether the signal is silent
+     */
+    bool process(float peak) {
+        if (peak >= SILENCE_THRESHOLD) {
+            quietFrames = 0;
+            return false;
+        }
+        quietFrames = std::min(quietFrames + 1, holdFrames);
+        return quietFrames >= holdFrames;
+    }
+
+    /**
+     * Largest magnitude of `n` voltages
+     */
+    static float peak(const float* v, int n) {
+        float p = 0.f;
+        for (int c = 0; c < n; c++) {
+            p = std::max(p, std::fabs(v[c]));
+        }
+        return p;
+    }
+
+private:
+
+    int quietFrames = 0;
+};
+
+/**
+ * Delay line for a strip's stereo polyphonic voltages
+ *
+ * Keeps all 16 channels of each side for every frame, in a power of 2 of
+ * frames, so any delay up to size() is a mask away. Built off the audio
+ * thread; process() and clear() don't allocate.
+ */
+struct StereoDelay {
+    explicit StereoDelay(int frames) {
+        int size = 1;
+        while (size < frames) {
+            size *= 2;
+        }
+        mask = size - 1;
+        buffer.assign(static_cast<size_t>(size) * FRAME_FLOATS, 0.f);
+    }
+
+    /**
+     * Frames of delay this line can hold
+     */
+    int size() const {
+        return mask + 1;
+    }
+
+    /**
+     * Replace `signals` with those from `frames` ago, 1 to size()
+     */
+    void process(StereoVoltages &signals, int frames) {
+        const float* out = &buffer[static_cast<size_t>((pos - frames) & mask) * FRAME_FLOATS];
+        float* in = &buffer[static_cast<size_t>(pos) * FRAME_FLOATS];
+        float delayed[FRAME_FLOATS];
+        std::memcpy(delayed, out, sizeof(delayed));
+        std::memcpy(in, signals.voltages_l, 16 * sizeof(float));
+        std::memcpy(in + 16, signals.voltages_r, 16 * sizeof(float));
+        std::memcpy(signals.voltages_l, delayed, 16 * sizeof(float));
+        std::memcpy(signals.voltages_r, delayed + 16, 16 * sizeof(float));
+        pos = (pos + 1) & mask;
+    }
+
+    void clear() {
+        std::fill(buffer.begin(), buffer.end(), 0.f);
+    }
+
+private:
+
+    static constexpr int FRAME_FLOATS = 32;
+
+    std::vector<float> buffer;
+    int mask = 0;
+    int pos = 0;
+};
+
+#endif
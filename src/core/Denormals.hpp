@@ -0,0 +1,52 @@
+#if !defined(QUANTAL_CORE_DENORMALS_H)
+#define QUANTAL_CORE_DENORMALS_H 1
+
+#include <cstdint>
+
+#if defined(__SSE__) || defined(__x86_64__)
+#include <xmmintrin.h>
+#endif
+
+namespace quantal {
+
+/**
+ * Flushes denormal floats to zero on this thread while in scope
+ *
+ * Rack's engine threads run with flush-to-zero and denormals-are-zero set,
+ * so state that decays towards zero, like a VU meter or a highpass fed
+ * silence, never reaches the slow denormal range. The tools and tests run the
+ * same code outside Rack, and use this to match the engine.
+ */
+struct ScopedFlushDenormals {
+#if defined(__SSE__) || defined(__x86_64__)
+    ScopedFlushDenormals() : saved(_mm_getcsr()) {
+        // FTZ (bit 15) and DAZ (bit 6)
+        _mm_setcsr(saved | 0x8040);
+    }
+    ~ScopedFlushDenormals() {
+        _mm_setcsr(saved);
+    }
+
+private:
+
+    unsigned int saved;
+#elif defined(__aarch64__)
+    ScopedFlushDenormals() {
+        __asm__ __volatile__("mrs %0, fpcr" : "=r"(saved));
+        // FZ (bit 24) covers both inputs and results
+        const uint64_t flushed = saved | (1 << 24);
+        __asm__ __volatile__("msr fpcr, %0" : : "r"(flushed));
+    }
+    ~ScopedFlushDenormals() {
+        __asm__ __volatile__("msr fpcr, %0" : : "r"(saved));
+    }
+
+private:
+
+    uint64_t saved;
+#endif
+};
+
+} // namespace quantal
+
+#endif
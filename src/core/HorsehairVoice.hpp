@@ -0,0 +1,166 @@
+#if !defined(QUANTAL_CORE_HORSEHAIR_VOICE_H)
+#define QUANTAL_CORE_HORSEHAIR_VOICE_H 1
+
+#include <cmath>
+
+#include "Oscillator.hpp"
+
+namespace quantal {
+
+// Osc A to B FM index at full amount: peak deviation of B in multiples of A's frequency
+constexpr float FM_A_TO_B_MAX_INDEX = 4.f;
+
+// Detune of the outermost unison copies at full detune amount, in V/oct (1 semitone)
+constexpr float UNISON_MAX_DETUNE = 1.f / 12.f;
+
+/**
+ * Horsehair's knob and context menu settings, shared by every voice
+ */
+struct HorsehairSettings {
+    // Octave of osc A and B, rounded to whole octaves
+    float octave[2] = {-2.f, -1.f};
+    // Pitch tune, in V/oct
+    float fine = 0.f;
+    // Square to saw crossfade of osc A and B, 0 to 1
+    float shape[2] = {0.f, 1.f};
+    // Pulse width of osc A and B, 0 to 1
+    float pw[2] = {0.5f, 0.5f};
+    // Crossfade from osc A to osc B, 0 to 1
+    float mix = 0.5f;
+
+    // Whether osc A and B follow the sync input
+    bool syncA = false;
+    bool syncB = false;
+    // Restart osc B whenever osc A restarts its cycle, instead of syncB
+    bool syncBToA = false;
+    bool softSync = false;
+
+    // FM input depth of osc A and B: frequency deviation per volt, as a
+    // fraction of the oscillator's own frequency
+    float fmA = 0.f;
+    float fmB = 0.f;
+    // Osc A sine to osc B FM index
+    float fmAToBIndex = 0.f;
+    bool throughZeroFm = false;
+};
+
+/**
+ * Input voltages for the 4 lanes of a voice group
+ */
+struct HorsehairInputs {
+    float4 pitch = 0.f;
+    float4 pw[2] = {0.f, 0.f};
+    float4 mix = 0.f;
+    float4 sync = 0.f;
+    float4 fm = 0.f;
+};
+
+/**
+ * Oscillator state for a group of 4 voices. Osc A and B sit side by side
+ * since they are always processed together.
+ */
+struct HorsehairVoiceGroup {
+    VoltageControlledOscillator<16, 16, float4> oscillator;
+    VoltageControlledOscillator<16, 16, float4> oscillator2;
+
+    /**
+     * Advance the first `channels` lanes by one sample
+     *
+     * `mixOut` receives the oscillator mix and `sinOut` osc A's sine, both
+     * at +/-5V.
+     */
+    void process(const HorsehairSettings &s, float deltaTime, int channels, const HorsehairInputs &in,
+                 float4 &mixOut, float4 &sinOut) {
+        oscillator.channels = channels;
+        oscillator.setPitch(1.0f + std::round(s.octave[0]) + s.fine + in.pitch);
+        oscillator.setPulseWidth(s.pw[0] + in.pw[0] / 10.f);
+        // Linear FM deviates each oscillator in proportion to its own
+        // frequency, so the modulation index tracks the keyboard
+        oscillator.fm = oscillator.freq * in.fm * s.fmA;
+        oscillator.throughZero = s.throughZeroFm;
+        oscillator.syncEnabled = s.syncA;
+        oscillator.soft = s.softSync;
+        oscillator.process(deltaTime, in.sync);
+
+        oscillator2.channels = channels;
+        oscillator2.setPitch(1.0f + std::round(s.octave[1]) + s.fine + in.pitch);
+        oscillator2.setPulseWidth(s.pw[1] + in.pw[1] / 10.f);
+        oscillator2.fm = oscillator2.freq * in.fm * s.fmB;
+        if (s.fmAToBIndex > 0.f) {
+            oscillator2.fm += oscillator.freq * oscillator.sin() * s.fmAToBIndex;
+        }
+        oscillator2.throughZero = s.throughZeroFm;
+        oscillator2.soft = s.softSync;
+        if (s.syncBToA) {
+            oscillator2.syncEnabled = false;
+            oscillator2.process(deltaTime, oscillator.cycleCrossing, oscillator.cycleMask);
+        } else {
+            oscillator2.syncEnabled = s.syncB;
+            oscillator2.process(deltaTime, in.sync);
+        }
+
+        const float4 out = crossfade(oscillator.sqr(), oscillator.saw(), s.shape[0]);
+        const float4 out2 = crossfade(oscillator2.sqr(), oscillator2.saw(), s.shape[1]);
+        const float4 mix = clamp(s.mix + in.mix / 10.f, 0.0f, 1.0f);
+        mixOut = 5.0f * crossfade(out, out2, mix);
+        sinOut = 5.0f * oscillator.sin();
+    }
+
+    /**
+     * Run `frames` samples with fixed inputs, writing 4 floats per frame of
+     * the oscillator mix to `mixOut` and of the sine to `sinOut` (either may
+     * be null)
+     */
+    void processBlock(const HorsehairSettings &s, float deltaTime, int channels, const HorsehairInputs &in,
+                      float* mixOut, float* sinOut, int frames) {
+        float4 mix;
+        float4 sine;
+        for (int f = 0; f < frames; f++) {
+            process(s, deltaTime, channels, in, mix, sine);
+            if (mixOut) {
+                mix.store(mixOut + 4 * f);
+            }
+            if (sinOut) {
+                sine.store(sinOut + 4 * f);
+            }
+        }
+    }
+};
+
+/**
+ * Detune and output gains of the 16 lanes in unison mode
+ *
+ * Lane `l` holds copy `l % unison` of voice `l / unison`. Copies are spread
+ * evenly from the lowest detune panned left to the highest detune panned
+ * right.
+ */
+struct HorsehairUnison {
+    // Pitch offset of each lane, in V/oct
+    float detune[16] = {};
+    // Mono, left and right output gain of each lane
+    float gain[16] = {};
+    float gainL[16] = {};
+    float gainR[16] = {};
+
+    /**
+     * Recalculate the lanes for `unison` copies per voice, with detune and
+     * stereo spread amounts from 0 to 1
+     */
+    void update(int unison, float detuneAmount, float spread) {
+        const float level = 1.f / std::sqrt(static_cast<float>(unison));
+        for (int l = 0; l < 16; l++) {
+            const int copy = l % unison;
+            const float x = (unison > 1) ? 2.f * copy / (unison - 1) - 1.f : 0.f;
+            const float pan = x * spread;
+
+            detune[l] = x * detuneAmount * UNISON_MAX_DETUNE;
+            gain[l] = level;
+            gainL[l] = std::cos(M_PI * (pan + 1.0f) / 4.0f) * M_SQRT2 * level;
+            gainR[l] = std::sin(M_PI * (pan + 1.0f) / 4.0f) * M_SQRT2 * level;
+        }
+    }
+};
+
+} // namespace quantal
+
+#endif
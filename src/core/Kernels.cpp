@@ -0,0 +1,21 @@
+#include "Kernels.hpp"
+
+const Kernels* kernels = nullptr;
+
+/**
+ * Pick the widest kernels this CPU can run
+ */
+void initKernels() {
+    kernels = getKernelsBase();
+
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    // Check the CPU before touching a table, it may not be safe to run
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && getKernelsAvx2()) {
+        kernels = getKernelsAvx2();
+    }
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl") && getKernelsAvx512()) {
+        kernels = getKernelsAvx512();
+    }
+#endif
+}
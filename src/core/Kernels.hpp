@@ -0,0 +1,66 @@
+#if !defined(QUANTAL_KERNELS_H)
+#define QUANTAL_KERNELS_H 1
+
+/**
+ * Hot DSP loops, built once per instruction set and picked at startup
+ *
+ * Every function works on plain float arrays of `n` channels so it can be
+ * compiled without Rack's headers. Output arrays may be the same array as an
+ * input (e.g. `dst == base`), but must not otherwise overlap.
+ */
+struct Kernels {
+    // Instruction set the kernels were built for, shown in module menus
+    const char* name;
+
+    /**
+     * Multiply a stereo signal by a gain per side, and by a per-channel
+     * level when `levels` is not null
+     */
+    void (*gainStereo)(float* l, float* r, float gainL, float gainR, const float* levels, int n);
+
+    /**
+     * Multiply a signal by a gain, and by a per-channel level when `levels`
+     * is not null
+     */
+    void (*gainMono)(float* x, float gain, const float* levels, int n);
+
+    /**
+     * dst = base + amount * add, for both sides of a stereo signal
+     */
+    void (*mixStereo)(float* dstL, float* dstR, const float* baseL, const float* baseR,
+                      const float* addL, const float* addR, float amount, int n);
+
+    /**
+     * dst = base + amount * add
+     */
+    void (*mixMono)(float* dst, const float* base, const float* add, float amount, int n);
+
+    /**
+     * Scale a stereo bus, clamp it to +/-`limit`, then apply the output gain
+     * and the per-channel level when `levels` is not null
+     */
+    void (*busStereo)(float* l, float* r, float scale, float limit, float gain, const float* levels, int n);
+
+    /**
+     * Convert level CV (0 to 10V) to levels from 0 to 1
+     *
+     * When `slew` is not null it holds the slewed level of each channel and
+     * moves towards the new level by at most `delta` per call.
+     */
+    void (*cvLevels)(float* levels, const float* cv, float* slew, float delta, int n);
+
+};
+
+/**
+ * Kernels for the CPU running the plugin, set by initKernels()
+ */
+extern const Kernels* kernels;
+
+void initKernels();
+
+// One table per instruction set; null when this build can't provide it
+const Kernels* getKernelsBase();
+const Kernels* getKernelsAvx2();
+const Kernels* getKernelsAvx512();
+
+#endif
@@ -0,0 +1,18 @@
+#include "Kernels.hpp"
+
+// Built with -mavx2 -mfma on x64 (see Makefile)
+#if defined(__AVX2__) && defined(__FMA__)
+#define KERNELS_NAME "AVX2"
+
+namespace {
+#include "KernelsImpl.hpp"
+}
+
+const Kernels* getKernelsAvx2() {
+    return &table;
+}
+#else
+const Kernels* getKernelsAvx2() {
+    return nullptr;
+}
+#endif
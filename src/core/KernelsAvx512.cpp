@@ -0,0 +1,18 @@
+#include "Kernels.hpp"
+
+// Built with -mavx512f -mavx512vl on x64 (see Makefile)
+#if defined(__AVX512F__) && defined(__AVX512VL__)
+#define KERNELS_NAME "AVX-512"
+
+namespace {
+#include "KernelsImpl.hpp"
+}
+
+const Kernels* getKernelsAvx512() {
+    return &table;
+}
+#else
+const Kernels* getKernelsAvx512() {
+    return nullptr;
+}
+#endif
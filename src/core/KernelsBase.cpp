@@ -0,0 +1,20 @@
+#include "Kernels.hpp"
+
+// Built with the plugin's default flags, so it runs on every supported CPU
+#if defined(__AVX2__)
+#define KERNELS_NAME "AVX2"
+#elif defined(__SSE4_2__)
+#define KERNELS_NAME "SSE4.2"
+#elif defined(__ARM_NEON)
+#define KERNELS_NAME "NEON"
+#else
+#define KERNELS_NAME "Generic"
+#endif
+
+namespace {
+#include "KernelsImpl.hpp"
+}
+
+const Kernels* getKernelsBase() {
+    return &table;
+}
@@ -0,0 +1,89 @@
+/**
+ * Kernel bodies, included by each Kernels*.cpp inside an anonymous namespace
+ *
+ * Every instruction set gets its own internal copy of these functions. Keep
+ * this file free of includes and of calls to inline functions from other
+ * headers (std::min, rack::clamp, ...): those are merged across translation
+ * units by the linker, which could pick a copy built for an instruction set
+ * the CPU doesn't have.
+ *
+ * Loops are written plainly so the compiler vectorizes them for the target.
+ */
+
+inline float kernelClamp(float x, float lo, float hi) {
+    x = x < lo ? lo : x;
+    return x > hi ? hi : x;
+}
+
+void gainStereo(float* l, float* r, float gainL, float gainR, const float* levels, int n) {
+    if (levels) {
+        for (int c = 0; c < n; c++) {
+            l[c] *= gainL * levels[c];
+            r[c] *= gainR * levels[c];
+        }
+    } else {
+        for (int c = 0; c < n; c++) {
+            l[c] *= gainL;
+            r[c] *= gainR;
+        }
+    }
+}
+
+void gainMono(float* x, float gain, const float* levels, int n) {
+    if (levels) {
+        for (int c = 0; c < n; c++) {
+            x[c] *= gain * levels[c];
+        }
+    } else {
+        for (int c = 0; c < n; c++) {
+            x[c] *= gain;
+        }
+    }
+}
+
+void mixMono(float* dst, const float* base, const float* add, float amount, int n) {
+    for (int c = 0; c < n; c++) {
+        dst[c] = base[c] + amount * add[c];
+    }
+}
+
+void mixStereo(float* dstL, float* dstR, const float* baseL, const float* baseR,
+               const float* addL, const float* addR, float amount, int n) {
+    mixMono(dstL, baseL, addL, amount, n);
+    mixMono(dstR, baseR, addR, amount, n);
+}
+
+void busStereo(float* l, float* r, float scale, float limit, float gain, const float* levels, int n) {
+    for (int c = 0; c < n; c++) {
+        l[c] = kernelClamp(l[c] * scale, -limit, limit) * gain;
+        r[c] = kernelClamp(r[c] * scale, -limit, limit) * gain;
+    }
+    if (levels) {
+        for (int c = 0; c < n; c++) {
+            l[c] *= levels[c];
+            r[c] *= levels[c];
+        }
+    }
+}
+
+void cvLevels(float* levels, const float* cv, float* slew, float delta, int n) {
+    for (int c = 0; c < n; c++) {
+        levels[c] = kernelClamp(cv[c] / 10.f, 0.f, 1.f);
+    }
+    if (slew) {
+        for (int c = 0; c < n; c++) {
+            slew[c] += kernelClamp(levels[c] - slew[c], -delta, delta);
+            levels[c] = slew[c];
+        }
+    }
+}
+
+const Kernels table = {
+    KERNELS_NAME,
+    gainStereo,
+    gainMono,
+    mixStereo,
+    mixMono,
+    busStereo,
+    cvLevels,
+};
@@ -0,0 +1,116 @@
+#if !defined(QUANTAL_CORE_MIXING_H)
+#define QUANTAL_CORE_MIXING_H 1
+
+#include <cmath>
+
+#include "Kernels.hpp"
+
+// Hypothetically the max number of channels that could be chained
+constexpr float DAISY_DIVISOR = 16.f;
+
+// Limit of a daisy-chain bus once brought back up to full voltage
+constexpr float DAISY_BUS_LIMIT = 12.f;
+
+/**
+ * Object to hold stereo polyphonic voltages
+ */
+struct StereoVoltages {
+    int channels = 0;
+    float voltages_l[16] = {};
+    float voltages_r[16] = {};
+
+    /**
+     * Copies an array of size at least `channels` to this obj's voltages.
+     * Remember to set the number of channels *before* calling this method.
+     */
+    void writeVoltages(const float* v_l, const float* v_r) {
+        for (int c = 0; c < channels; c++) {
+            voltages_l[c] = v_l[c];
+            voltages_r[c] = v_r[c];
+        }
+    }
+
+    void writeVoltages(const StereoVoltages sv, int channels) {
+        this->channels = channels;
+        for (int c = 0; c < channels; c++) {
+            voltages_l[c] = sv.voltages_l[c];
+            voltages_r[c] = sv.voltages_r[c];
+        }
+    }
+
+    /**
+     * Copies this objs voltages to an array of size at least `channels`
+     */
+    void sendVoltages(float* v_l, float* v_r) {
+        for (int c = 0; c < channels; c++) {
+            v_l[c] = voltages_l[c];
+            v_r[c] = voltages_r[c];
+        }
+    }
+};
+
+/**
+ * Apply a channel strip's fader and equal-power pan to its signal
+ *
+ * The fader is squared for a more natural taper. `levels` is the level CV of
+ * each channel, or null when there is none.
+ */
+inline void stripLevel(StereoVoltages &signals, float level, float pan, const float* levels) {
+    const float gain = level * level;
+    kernels->gainStereo(
+        signals.voltages_l,
+        signals.voltages_r,
+        std::cos(M_PI * (pan + 1.0f) / 4.0f) * gain,
+        std::sin(M_PI * (pan + 1.0f) / 4.0f) * gain,
+        levels,
+        signals.channels
+    );
+}
+
+/**
+ * dst = bus + amount * signals, over `channels` channels
+ *
+ * Used to add a strip to the chain (at 1 / DAISY_DIVISOR), to the aux sends
+ * and to the solo bus. `dst` may be `bus`.
+ */
+inline void busSend(StereoVoltages &dst, const StereoVoltages &bus, const StereoVoltages &signals, float amount, int channels) {
+    kernels->mixStereo(
+        dst.voltages_l, dst.voltages_r,
+        bus.voltages_l, bus.voltages_r,
+        signals.voltages_l, signals.voltages_r,
+        amount, channels
+    );
+}
+
+/**
+ * Bring a bus up by `scale`, clamp it to DAISY_BUS_LIMIT and apply the
+ * output gain and per-channel `levels` (null for none)
+ */
+inline void busOutput(StereoVoltages &bus, float scale, float gain, const float* levels) {
+    kernels->busStereo(bus.voltages_l, bus.voltages_r, scale, DAISY_BUS_LIMIT, gain, levels, bus.channels);
+}
+
+/**
+ * Apply a fader to `n` channels, squared for a more natural taper
+ */
+inline void faderGain(float* x, float level, int n) {
+    kernels->gainMono(x, level * level, nullptr, n);
+}
+
+/**
+ * mix += in, over `n` channels
+ */
+inline void sumInto(float* mix, const float* in, int n) {
+    kernels->mixMono(mix, mix, in, 1.f, n);
+}
+
+/**
+ * Turn the sum of `count` signals into their average
+ */
+inline void averageOf(float* mix, int count, int n) {
+    if (count > 0) {
+        kernels->gainMono(mix, 1.f / count, nullptr, n);
+    }
+}
+
+#endif
@@ -0,0 +1,436 @@
+#if !defined(QUANTAL_CORE_OSCILLATOR_H)
+#define QUANTAL_CORE_OSCILLATOR_H 1
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <vector>
+
+#include "Simd.hpp"
+
+namespace quantal {
+
+// Frequency of middle C, 0V on a V/oct input
+constexpr float FREQ_C4 = 261.6256f;
+
+template <typename T>
+T sin2pi_pade_05_5_4(T x) {
+    x -= 0.5f;
+    const T x2 = x * x;
+    return (T(-6.283185307) * x + T(33.19863968) * x2 * x - T(32.44191367) * x2 * x2 * x)
+           / (1 + T(1.296008659) * x2 + T(0.7028072946) * x2 * x2);
+}
+
+template <typename T>
+T expCurve(T x) {
+    return (3 + x * (-13 + 5 * x)) / (3 + 2 * x);
+}
+
+/**
+ * First order RC filter, same response as Rack's dsp::TRCFilter
+ *
+ * The input carries a tiny DC offset, so fed silence the state settles at the
+ * offset instead of decaying into denormals, even on a thread without
+ * flush-to-zero. The highpass cancels it.
+ */
+template <typename T>
+struct RCFilter {
+    T c = 0.f;
+    T xstate = 0.f;
+    T ystate = 0.f;
+
+    /**
+     * Set the cutoff as a fraction of the sample rate
+     */
+    void setCutoffFreq(T f) {
+        c = 2.f / (2.f * float(M_PI) * f);
+    }
+
+    void process(T x) {
+        x += 1e-18f;
+        T y = (x + xstate - ystate * (1 - c)) / (1 + c);
+        xstate = x;
+        ystate = y;
+    }
+
+    T lowpass() {
+        return ystate;
+    }
+    T highpass() {
+        return xstate - ystate;
+    }
+};
+
+/**
+ * In-place radix-2 FFT of `x`, whose size must be a power of 2
+ */
+inline void fft(std::vector<std::complex<double>> &x, bool inverse) {
+    const size_t n = x.size();
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            std::swap(x[i], x[j]);
+        }
+    }
+    for (size_t len = 2; len <= n; len <<= 1) {
+        const double angle = 2 * M_PI / len * (inverse ? 1 : -1);
+        const std::complex<double> step(std::cos(angle), std::sin(angle));
+        for (size_t i = 0; i < n; i += len) {
+            std::complex<double> w(1);
+            for (size_t j = 0; j < len / 2; j++) {
+                const std::complex<double> u = x[i + j];
+                const std::complex<double> v = x[i + j + len / 2] * w;
+                x[i + j] = u + v;
+                x[i + j + len / 2] = u - v;
+                w *= step;
+            }
+        }
+    }
+    if (inverse) {
+        for (std::complex<double> &v : x) {
+            v /= static_cast<double>(n);
+        }
+    }
+}
+
+/**
+ * Minimum-phase band-limited step, `2 * z * o` samples long
+ *
+ * A windowed sinc with `z` zero crossings each side, made minimum-phase
+ * through its real cepstrum and integrated, oversampled `o` times. This is the
+ * same construction as Rack's dsp::minBlepImpulse. `2 * z * o` must be a power
+ * of 2.
+ */
+inline void minBlepImpulse(int z, int o, float* output) {
+    const int n = 2 * z * o;
+    std::vector<std::complex<double>> x(n);
+    for (int i = 0; i < n; i++) {
+        // Blackman-Harris windowed sinc
+        const double p = 2.0 * z * i / (n - 1) - z;
+        const double sinc = (p == 0.0) ? 1.0 : std::sin(M_PI * p) / (M_PI * p);
+        const double w = 2 * M_PI * i / (n - 1);
+        const double window = 0.35875 - 0.48829 * std::cos(w) + 0.14128 * std::cos(2 * w) - 0.01168 * std::cos(3 * w);
+        x[i] = sinc * window;
+    }
+
+    // Real cepstrum
+    fft(x, false);
+    for (std::complex<double> &v : x) {
+        v = std::max(-30.0, std::log(std::abs(v)));
+    }
+    fft(x, true);
+
+    // Fold into a causal, minimum-phase cepstrum
+    for (int i = 1; i < n / 2; i++) {
+        x[i] *= 2.0;
+    }
+    for (int i = n / 2; i < n; i++) {
+        x[i] = 0.0;
+    }
+    fft(x, false);
+    for (std::complex<double> &v : x) {
+        v = std::exp(v);
+    }
+    fft(x, true);
+
+    // Integrate the impulse into a step that settles at 1
+    double total = 0.0;
+    std::vector<double> step(n);
+    for (int i = 0; i < n; i++) {
+        total += x[i].real();
+        step[i] = total;
+    }
+    for (int i = 0; i < n; i++) {
+        output[i] = static_cast<float>(step[i] / total);
+    }
+}
+
+/**
+ * MinBLEP generator that inserts the discontinuities of several lanes in one
+ * call.
+ *
+ * dsp::MinBlepGenerator takes a single crossing position per call, so a
+ * vector of lanes that cross in the same sample costs one full pass over the
+ * buffer per crossing lane. Here each lane has its own buffer and the impulse
+ * table is stored transposed, so a crossing lane adds its impulse in one
+ * contiguous run and lanes that don't cross cost nothing.
+ *
+ * The runs are only 32 samples, too short to gain from the wider kernel
+ * builds, so they are compiled inline; see quantal-minblep-bench.
+ */
+template <int Z, int O, typename T>
+struct BatchMinBlepGenerator {
+    float buf[T::size][2 * Z] = {};
+    int pos = 0;
+    const float* impulseRows = getImpulseRows();
+
+    /**
+     * The impulse table as O + 1 rows of 2Z samples, row `o` being the
+     * impulse at subsample offset `o`
+     *
+     * It is the same for every generator of this size, so it is computed once
+     * and shared instead of stored in each generator.
+     */
+    static const float* getImpulseRows() {
+        struct ImpulseRows {
+            float table[(O + 1) * 2 * Z];
+            ImpulseRows() {
+                float impulse[2 * Z * O + 1];
+                minBlepImpulse(Z, O, impulse);
+                impulse[2 * Z * O] = 1.f;
+                for (int o = 0; o <= O; o++) {
+                    for (int j = 0; j < 2 * Z; j++) {
+                        table[o * 2 * Z + j] = impulse[j * O + o];
+                    }
+                }
+            }
+        };
+        static const ImpulseRows rows;
+        return rows.table;
+    }
+
+    /**
+     * Insert a discontinuity of size `x` for every lane set in `mask`
+     *
+     * `p` is the subsample position of each lane's crossing, in (-1, 0].
+     * Lanes not in `mask` are ignored.
+     */
+    void insertDiscontinuities(T p, T x, int mask) {
+        for (int i = 0; i < T::size; i++) {
+            if (mask & (1 << i)) {
+                const float minBlepIndex = -p[i] * O;
+                const int offset = std::max(0, std::min(static_cast<int>(minBlepIndex), O - 1));
+                const float* a = &impulseRows[offset * 2 * Z];
+                const float* b = a + 2 * Z;
+                const float frac = minBlepIndex - offset;
+                // Two contiguous runs, either side of the buffer wrapping around
+                const int first = 2 * Z - pos;
+                for (int j = 0; j < first; j++) {
+                    buf[i][pos + j] += x[i] * (a[j] + frac * (b[j] - a[j]) - 1.f);
+                }
+                for (int j = first; j < 2 * Z; j++) {
+                    buf[i][j - first] += x[i] * (a[j] + frac * (b[j] - a[j]) - 1.f);
+                }
+            }
+        }
+    }
+
+    T process() {
+        T v;
+        for (int i = 0; i < T::size; i++) {
+            v[i] = buf[i][pos];
+            buf[i][pos] = 0.f;
+        }
+        pos = (pos + 1) % (2 * Z);
+        return v;
+    }
+};
+
+/**
+ * Band-limited square, saw and sine oscillator for 4 voices at once, with
+ * hard and soft sync and through-zero linear FM
+ */
+template <int OVERSAMPLE, int QUALITY, typename T>
+struct VoltageControlledOscillator {
+    bool analog = true;
+    bool soft = false;
+    bool syncEnabled = false;
+    // Let linear FM drive the frequency negative, running the phase backwards
+    bool throughZero = false;
+    // For optimizing in serial code
+    int channels = 0;
+
+    T lastSyncValue = 0.f;
+    T phase = 0.f;
+    T freq = 0.f;
+    // Linear FM frequency offset, in Hz
+    T fm = 0.f;
+    T pulseWidth = 0.5f;
+    T syncDirection = 1.f;
+
+    // Lanes whose cycle restarted in the last sample, and the subsample
+    // position where it happened
+    T cycleCrossing = 0.f;
+    int cycleMask = 0;
+
+    RCFilter<T> sqrFilter;
+
+    BatchMinBlepGenerator<QUALITY, OVERSAMPLE, T> sqrMinBlep;
+    BatchMinBlepGenerator<QUALITY, OVERSAMPLE, T> sawMinBlep;
+    BatchMinBlepGenerator<QUALITY, OVERSAMPLE, T> sinMinBlep;
+
+    T sqrValue = 0.f;
+    T sawValue = 0.f;
+    T sinValue = 0.f;
+
+    /**
+     * Set the frequency from a V/oct pitch, 0V being middle C
+     */
+    void setPitch(T pitch) {
+        freq = FREQ_C4 * exp2(pitch);
+    }
+
+    void setPulseWidth(T pulseWidth) {
+        constexpr float pwMin = 0.01f;
+        this->pulseWidth = clamp(pulseWidth, pwMin, 1.f - pwMin);
+    }
+
+    void process(float deltaTime, T syncValue) {
+        T syncCrossing = 0.f;
+        int syncMask = 0;
+        if (syncEnabled) {
+            // Sync on rising zero crossings of the sync signal
+            T deltaSync = syncValue - lastSyncValue;
+            syncCrossing = -lastSyncValue / deltaSync;
+            lastSyncValue = syncValue;
+            syncMask = movemask((0.f < syncCrossing) & (syncCrossing <= 1.f) & (syncValue >= 0.f));
+        }
+        process(deltaTime, syncCrossing, syncMask);
+    }
+
+    /**
+     * Advance the oscillator by one sample
+     *
+     * Lanes in `syncMask` are synced at their subsample position
+     * `syncCrossing`, in (0, 1] where 1 is the current sample.
+     */
+    void process(float deltaTime, T syncCrossing, int syncMask) {
+        // Advance phase
+        T freqFm = freq + fm;
+        T fmDirection = 1.f;
+        if (throughZero) {
+            fmDirection = ifelse(freqFm < 0.f, -1.f, 1.f);
+            freqFm = fabs(freqFm);
+        }
+        T deltaPhase = clamp(freqFm * deltaTime, 1e-6f, 0.35f);
+        if (soft) {
+            // Reverse direction
+            deltaPhase *= syncDirection;
+        } else {
+            // Reset back to forward
+            syncDirection = 1.f;
+        }
+        // Direction the phase travels in, from soft sync and through-zero FM
+        const T direction = syncDirection * fmDirection;
+        deltaPhase *= fmDirection;
+        phase += deltaPhase;
+        // Wrap phase
+        phase -= floor(phase);
+
+        // Only the lanes in use may insert discontinuities
+        const int channelMask = (1 << channels) - 1;
+
+        // Jump sqr when crossing 0, or 1 if backwards
+        T wrapPhase = (direction == -1.f) & 1.f;
+        T wrapCrossing = (wrapPhase - (phase - deltaPhase)) / deltaPhase;
+        int wrapMask = movemask((0 < wrapCrossing) & (wrapCrossing <= 1.f)) & channelMask;
+        if (wrapMask) {
+            sqrMinBlep.insertDiscontinuities(wrapCrossing - 1.f, 2.f * direction, wrapMask);
+        }
+
+        // Jump sqr when crossing `pulseWidth`
+        T pulseCrossing = (pulseWidth - (phase - deltaPhase)) / deltaPhase;
+        int pulseMask = movemask((0 < pulseCrossing) & (pulseCrossing <= 1.f)) & channelMask;
+        if (pulseMask) {
+            sqrMinBlep.insertDiscontinuities(pulseCrossing - 1.f, -2.f * direction, pulseMask);
+        }
+
+        // Jump saw when crossing 0.5
+        T halfCrossing = (0.5f - (phase - deltaPhase)) / deltaPhase;
+        const int halfMask = movemask((0 < halfCrossing) & (halfCrossing <= 1.f)) & channelMask;
+        if (halfMask) {
+            sawMinBlep.insertDiscontinuities(halfCrossing - 1.f, -2.f * direction, halfMask);
+        }
+
+        // Where this oscillator's cycle restarted, for other oscillators to sync to
+        cycleCrossing = wrapCrossing;
+        cycleMask = wrapMask;
+
+        syncMask &= channelMask;
+        if (syncMask) {
+            T sync = movemaskInverse(syncMask);
+            if (soft) {
+                syncDirection = ifelse(sync, -syncDirection, syncDirection);
+            } else {
+                // Reset phase to where it would be had it restarted at the
+                // sync crossing, and band-limit the jump in every waveform
+                T newPhase = ifelse(sync, (1.f - syncCrossing) * deltaPhase, phase);
+                newPhase -= floor(newPhase);
+                T p = syncCrossing - 1.f;
+                sqrMinBlep.insertDiscontinuities(p, sqr(newPhase) - sqr(phase), syncMask);
+                sawMinBlep.insertDiscontinuities(p, saw(newPhase) - saw(phase), syncMask);
+                sinMinBlep.insertDiscontinuities(p, sin(newPhase) - sin(phase), syncMask);
+                phase = newPhase;
+
+                cycleCrossing = ifelse(sync, syncCrossing, cycleCrossing);
+                cycleMask |= syncMask;
+            }
+        }
+
+        // Square
+        sqrValue = sqr(phase);
+        sqrValue += sqrMinBlep.process();
+
+        if (analog) {
+            sqrFilter.setCutoffFreq(20.f * deltaTime);
+            sqrFilter.process(sqrValue);
+            sqrValue = sqrFilter.highpass() * 0.95f;
+        }
+
+        // Saw
+        sawValue = saw(phase);
+        sawValue += sawMinBlep.process();
+
+        // Sin
+        sinValue = sin(phase);
+        sinValue += sinMinBlep.process();
+    }
+
+    T sin(T phase) {
+        T v = 0.f;
+        if (analog) {
+            // Quadratic approximation of sine, slightly richer harmonics
+            T halfPhase = (phase < 0.5f);
+            T x = phase - ifelse(halfPhase, 0.25f, 0.75f);
+            v = 1.f - 16.f * x * x;
+            v *= ifelse(halfPhase, 1.f, -1.f);
+        } else {
+            v = sin2pi_pade_05_5_4(phase);
+        }
+        return v;
+    }
+    T sin() {
+        return sinValue;
+    }
+
+    T saw(T phase) {
+        T v = 0.f;
+        T x = phase + 0.5f;
+        x -= trunc(x);
+        if (analog) {
+            v = -expCurve(x);
+        } else {
+            v = 2 * x - 1;
+        }
+        return v;
+    }
+    T saw() {
+        return sawValue;
+    }
+
+    T sqr(T phase) {
+        T v = ifelse(phase < pulseWidth, 1.f, -1.f);
+        return v;
+    }
+    T sqr() {
+        return sqrValue;
+    }
+};
+
+} // namespace quantal
+
+#endif
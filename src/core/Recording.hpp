@@ -0,0 +1,188 @@
+#if !defined(QUANTAL_CORE_RECORDING_H)
+#define QUANTAL_CORE_RECORDING_H 1
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace quantal {
+
+/**
+ * File format of a workload recording, shared by the modules that record
+ * and `quantal-replay`
+ *
+ * All values are little-endian. The header is:
+ *
+ *     "QREC", u32 version, f32 sample rate, u32 module count
+ *     per module: u16 length + model slug, u32 length + data JSON,
+ *                 u8 param count, u8 input count, u8 output count,
+ *                 f32 param values, u8 1 for each output that is patched
+ *
+ * The modules are listed left to right as they sat in the rack. Every frame
+ * then holds, for each module in turn:
+ *
+ *     u8 number of params changed, then u8 index + f32 value for each
+ *     per input: u8 channels, then f32 voltage for each channel
+ *
+ * The file ends after the last whole frame.
+ */
+constexpr char RECORDING_MAGIC[4] = {'Q', 'R', 'E', 'C'};
+constexpr uint32_t RECORDING_VERSION = 1;
+
+/**
+ * A module as listed in a recording's header
+ */
+struct RecordedModule {
+    std::string slug;
+    // The module's dataToJson(), as compact JSON text
+    std::string data;
+    // Param values when recording started
+    std::vector<float> params;
+    int numInputs = 0;
+    // Which outputs were patched, since modules skip work for the others
+    std::vector<bool> outputsConnected;
+};
+
+/**
+ * Appends little-endian values to a byte buffer
+ */
+struct ByteWriter {
+    std::vector<uint8_t> &out;
+
+    explicit ByteWriter(std::vector<uint8_t> &out) : out(out) {}
+
+    void u8(uint8_t v) {
+        out.push_back(v);
+    }
+    void u16(uint16_t v) {
+        out.push_back(v & 0xff);
+        out.push_back(v >> 8);
+    }
+    void u32(uint32_t v) {
+        for (int i = 0; i < 4; i++) {
+            out.push_back((v >> (8 * i)) & 0xff);
+        }
+    }
+    void f32(float v) {
+        uint32_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        u32(bits);
+    }
+    void bytes(const std::string &s) {
+        out.insert(out.end(), s.begin(), s.end());
+    }
+};
+
+/**
+ * Reads little-endian values from a byte buffer; reading past the end sets
+ * `failed` and returns zeros
+ */
+struct ByteReader {
+    const uint8_t* data;
+    size_t size;
+    size_t pos = 0;
+    bool failed = false;
+
+    ByteReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    bool has(size_t n) {
+        if (size - pos < n) {
+            failed = true;
+            return false;
+        }
+        return true;
+    }
+    uint8_t u8() {
+        return has(1) ? data[pos++] : 0;
+    }
+    uint16_t u16() {
+        if (!has(2)) {
+            return 0;
+        }
+        const uint16_t v = data[pos] | (data[pos + 1] << 8);
+        pos += 2;
+        return v;
+    }
+    uint32_t u32() {
+        if (!has(4)) {
+            return 0;
+        }
+        uint32_t v = 0;
+        for (int i = 0; i < 4; i++) {
+            v |= static_cast<uint32_t>(data[pos + i]) << (8 * i);
+        }
+        pos += 4;
+        return v;
+    }
+    float f32() {
+        const uint32_t bits = u32();
+        float v;
+        std::memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+    std::string bytes(size_t n) {
+        if (!has(n)) {
+            return "";
+        }
+        std::string s(reinterpret_cast<const char*>(data + pos), n);
+        pos += n;
+        return s;
+    }
+};
+
+inline void writeRecordingHeader(std::vector<uint8_t> &out, float sampleRate, const std::vector<RecordedModule> &modules) {
+    ByteWriter w(out);
+    w.bytes(std::string(RECORDING_MAGIC, 4));
+    w.u32(RECORDING_VERSION);
+    w.f32(sampleRate);
+    w.u32(modules.size());
+    for (const RecordedModule &m : modules) {
+        w.u16(m.slug.size());
+        w.bytes(m.slug);
+        w.u32(m.data.size());
+        w.bytes(m.data);
+        w.u8(m.params.size());
+        w.u8(m.numInputs);
+        w.u8(m.outputsConnected.size());
+        for (float v : m.params) {
+            w.f32(v);
+        }
+        for (bool connected : m.outputsConnected) {
+            w.u8(connected);
+        }
+    }
+}
+
+/**
+ * Read the header, leaving `r` at the first frame. Returns false if this
+ * isn't a recording or it is cut short.
+ */
+inline bool readRecordingHeader(ByteReader &r, float &sampleRate, std::vector<RecordedModule> &modules) {
+    if (r.bytes(4) != std::string(RECORDING_MAGIC, 4) || r.u32() != RECORDING_VERSION) {
+        return false;
+    }
+    sampleRate = r.f32();
+    const uint32_t count = r.u32();
+    modules.clear();
+    for (uint32_t i = 0; i < count && !r.failed; i++) {
+        RecordedModule m;
+        m.slug = r.bytes(r.u16());
+        m.data = r.bytes(r.u32());
+        m.params.resize(r.u8());
+        m.numInputs = r.u8();
+        m.outputsConnected.resize(r.u8());
+        for (float &v : m.params) {
+            v = r.f32();
+        }
+        for (size_t o = 0; o < m.outputsConnected.size(); o++) {
+            m.outputsConnected[o] = r.u8() != 0;
+        }
+        modules.push_back(m);
+    }
+    return !r.failed;
+}
+
+} // namespace quantal
+
+#endif
@@ -0,0 +1,141 @@
+#if !defined(QUANTAL_CORE_SCENE_MORPH_H)
+#define QUANTAL_CORE_SCENE_MORPH_H 1
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Simd.hpp"
+
+namespace quantal {
+
+/**
+ * The settings of a channel strip kept in a mixer scene
+ */
+struct StripSettings {
+    float level = 1.f;
+    float pan = 0.f;
+    bool muted = false;
+    bool solo = false;
+    float aux1 = 0.f;
+    float aux2 = 0.f;
+};
+
+/**
+ * A named set of strip settings, by the id of the strip's module
+ */
+struct MixerScene {
+    std::string name;
+    std::unordered_map<int64_t, StripSettings> strips;
+};
+
+/**
+ * Crossfade between two mixer scenes
+ *
+ * Covers the strips found in both scenes. Built on the UI thread, after
+ * which the audio thread only calls morph() and get(). Each setting is kept
+ * for all the strips together, padded to a multiple of 4, so morph() works
+ * on four strips at a time.
+ *
+ * Part way through, a mute counts as the strip's level at 0, so a strip
+ * muted in one scene fades rather than switches; a solo changes over
+ * halfway. Either end gives its scene's settings exactly.
+ */
+struct SceneMorph {
+    enum Settings {
+        LEVEL,
+        PAN,
+        AUX1,
+        AUX2,
+        NUM_SETTINGS
+    };
+
+    // Lets the audio thread tell one morph from the next
+    uint32_t generation = 0;
+
+    // Position of each strip in the settings, by module id
+    std::unordered_map<int64_t, int> index;
+    std::vector<StripSettings> fromStrips;
+    std::vector<StripSettings> toStrips;
+
+    std::vector<float> from[NUM_SETTINGS];
+    std::vector<float> to[NUM_SETTINGS];
+    std::vector<float> out[NUM_SETTINGS];
+    float position = 0.f;
+
+    SceneMorph(const MixerScene &a, const MixerScene &b, const uint32_t generation) : generation(generation) {
+        for (const auto &strip : a.strips) {
+            const auto found = b.strips.find(strip.first);
+            if (found == b.strips.end()) {
+                continue;
+            }
+            index[strip.first] = static_cast<int>(fromStrips.size());
+            fromStrips.push_back(strip.second);
+            toStrips.push_back(found->second);
+        }
+
+        const size_t padded = (fromStrips.size() + 3) & ~static_cast<size_t>(3);
+        for (int s = 0; s < NUM_SETTINGS; s++) {
+            from[s].assign(padded, 0.f);
+            to[s].assign(padded, 0.f);
+            out[s].assign(padded, 0.f);
+        }
+        for (size_t i = 0; i < fromStrips.size(); i++) {
+            const StripSettings &f = fromStrips[i];
+            const StripSettings &t = toStrips[i];
+            // Muted at both ends, the strip stays muted and its level moves
+            const bool fade = !(f.muted && t.muted);
+            from[LEVEL][i] = (fade && f.muted) ? 0.f : f.level;
+            to[LEVEL][i] = (fade && t.muted) ? 0.f : t.level;
+            from[PAN][i] = f.pan;
+            to[PAN][i] = t.pan;
+            from[AUX1][i] = f.aux1;
+            to[AUX1][i] = t.aux1;
+            from[AUX2][i] = f.aux2;
+            to[AUX2][i] = t.aux2;
+        }
+    }
+
+    /**
+     * Interpolate every strip's settings to `t`, from 0 for the first scene
+     * to 1 for the second
+     */
+    void morph(const float t) {
+        position = std::min(std::max(t, 0.f), 1.f);
+        const float4 amount(position);
+        const size_t padded = out[LEVEL].size();
+        for (int s = 0; s < NUM_SETTINGS; s++) {
+            for (size_t i = 0; i < padded; i += 4) {
+                const float4 a = float4::load(&from[s][i]);
+                const float4 b = float4::load(&to[s][i]);
+                (a + (b - a) * amount).store(&out[s][i]);
+            }
+        }
+    }
+
+    /**
+     * Settings of strip `i` as of the last morph()
+     */
+    StripSettings get(const int i) const {
+        if (position <= 0.f) {
+            return fromStrips[i];
+        }
+        if (position >= 1.f) {
+            return toStrips[i];
+        }
+        StripSettings settings;
+        settings.level = out[LEVEL][i];
+        settings.pan = out[PAN][i];
+        settings.aux1 = out[AUX1][i];
+        settings.aux2 = out[AUX2][i];
+        settings.muted = fromStrips[i].muted && toStrips[i].muted;
+        settings.solo = (position < 0.5f) ? fromStrips[i].solo : toStrips[i].solo;
+        return settings;
+    }
+};
+
+} // namespace quantal
+
+#endif
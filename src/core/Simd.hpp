@@ -0,0 +1,209 @@
+#if !defined(QUANTAL_CORE_SIMD_H)
+#define QUANTAL_CORE_SIMD_H 1
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+
+namespace quantal {
+
+/**
+ * Four floats processed together
+ *
+ * Built on the compiler's vector extensions, so it maps to SSE on x86 and
+ * NEON on ARM without needing Rack's headers. Comparisons return masks with
+ * every bit of a lane set, for use with ifelse() and the bitwise operators,
+ * like rack::simd::float_4.
+ */
+struct float4 {
+    typedef float Native __attribute__((vector_size(16)));
+    typedef int32_t NativeInt __attribute__((vector_size(16)));
+
+    static constexpr int size = 4;
+
+    union {
+        Native v;
+        float s[4];
+    };
+
+    float4() = default;
+    float4(Native v) : v(v) {}
+    float4(float x) : v(Native{x, x, x, x}) {}
+    float4(float x0, float x1, float x2, float x3) : v(Native{x0, x1, x2, x3}) {}
+
+    static float4 load(const float* p) {
+        float4 x;
+        std::memcpy(&x.v, p, sizeof(x.v));
+        return x;
+    }
+
+    void store(float* p) const {
+        std::memcpy(p, &v, sizeof(v));
+    }
+
+    float& operator[](int i) {
+        return s[i];
+    }
+    const float& operator[](int i) const {
+        return s[i];
+    }
+
+    static float4 fromMask(NativeInt m) {
+        return float4(reinterpret_cast<Native>(m));
+    }
+    NativeInt bits() const {
+        return reinterpret_cast<NativeInt>(v);
+    }
+};
+
+inline float4 operator+(float4 a, float4 b) {
+    return a.v + b.v;
+}
+inline float4 operator-(float4 a, float4 b) {
+    return a.v - b.v;
+}
+inline float4 operator*(float4 a, float4 b) {
+    return a.v * b.v;
+}
+inline float4 operator/(float4 a, float4 b) {
+    return a.v / b.v;
+}
+inline float4 operator-(float4 a) {
+    return -a.v;
+}
+
+inline float4& operator+=(float4 &a, float4 b) {
+    return a = a + b;
+}
+inline float4& operator-=(float4 &a, float4 b) {
+    return a = a - b;
+}
+inline float4& operator*=(float4 &a, float4 b) {
+    return a = a * b;
+}
+inline float4& operator/=(float4 &a, float4 b) {
+    return a = a / b;
+}
+
+inline float4 operator==(float4 a, float4 b) {
+    return float4::fromMask(a.v == b.v);
+}
+inline float4 operator!=(float4 a, float4 b) {
+    return float4::fromMask(a.v != b.v);
+}
+inline float4 operator<(float4 a, float4 b) {
+    return float4::fromMask(a.v < b.v);
+}
+inline float4 operator<=(float4 a, float4 b) {
+    return float4::fromMask(a.v <= b.v);
+}
+inline float4 operator>(float4 a, float4 b) {
+    return float4::fromMask(a.v > b.v);
+}
+inline float4 operator>=(float4 a, float4 b) {
+    return float4::fromMask(a.v >= b.v);
+}
+
+inline float4 operator&(float4 a, float4 b) {
+    return float4::fromMask(a.bits() & b.bits());
+}
+inline float4 operator|(float4 a, float4 b) {
+    return float4::fromMask(a.bits() | b.bits());
+}
+inline float4 operator^(float4 a, float4 b) {
+    return float4::fromMask(a.bits() ^ b.bits());
+}
+inline float4& operator&=(float4 &a, float4 b) {
+    return a = a & b;
+}
+inline float4& operator|=(float4 &a, float4 b) {
+    return a = a | b;
+}
+
+/**
+ * Lanes of `a` where `mask` is set, otherwise lanes of `b`
+ */
+inline float4 ifelse(float4 mask, float4 a, float4 b) {
+    return float4::fromMask((mask.bits() & a.bits()) | (~mask.bits() & b.bits()));
+}
+
+/**
+ * Bit `i` of the result is set when lane `i` of `mask` is set
+ */
+inline int movemask(float4 mask) {
+#if defined(__SSE4_1__)
+    return _mm_movemask_ps(mask.v);
+#else
+    const float4::NativeInt m = mask.bits();
+    return (m[0] < 0) | ((m[1] < 0) << 1) | ((m[2] < 0) << 2) | ((m[3] < 0) << 3);
+#endif
+}
+
+/**
+ * Mask with lane `i` set when bit `i` of `bits` is set
+ */
+inline float4 movemaskInverse(int bits) {
+    const float4::NativeInt lanes = {1, 2, 4, 8};
+    return float4::fromMask((lanes & bits) != 0);
+}
+
+/**
+ * Round towards zero; without SSE4.1 lanes must be within the range of int32
+ */
+inline float4 trunc(float4 x) {
+#if defined(__SSE4_1__)
+    return _mm_round_ps(x.v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+#else
+    return __builtin_convertvector(__builtin_convertvector(x.v, float4::NativeInt), float4::Native);
+#endif
+}
+
+inline float4 floor(float4 x) {
+#if defined(__SSE4_1__)
+    return _mm_floor_ps(x.v);
+#else
+    const float4 t = trunc(x);
+    return t - ((t > x) & 1.f);
+#endif
+}
+
+inline float4 fabs(float4 x) {
+    return float4::fromMask(x.bits() & 0x7fffffff);
+}
+
+inline float4 fmin(float4 a, float4 b) {
+    return ifelse(a < b, a, b);
+}
+
+inline float4 fmax(float4 a, float4 b) {
+    return ifelse(a > b, a, b);
+}
+
+inline float4 clamp(float4 x, float4 a, float4 b) {
+    return fmin(fmax(x, a), b);
+}
+
+inline float4 crossfade(float4 a, float4 b, float4 p) {
+    return a + (b - a) * p;
+}
+
+/**
+ * 2^x with a 5th order polynomial for the fractional part, accurate to
+ * about 1e-6 relative
+ */
+inline float4 exp2(float4 x) {
+    const float4 xi = floor(x);
+    const float4 xf = x - xi;
+    const float4::NativeInt e = (__builtin_convertvector(xi.v, float4::NativeInt) + 127) << 23;
+    const float4 yi = float4::fromMask(e);
+    const float4 yf = 1.f + xf * (0.69315169353961f + xf * (0.2401595596181f + xf * (0.055817908652f
+                                  + xf * (0.008991698010f + xf * 0.001879100722f))));
+    return yi * yf;
+}
+
+} // namespace quantal
+
+#endif
@@ -0,0 +1,88 @@
+#if !defined(QUANTAL_CORE_SPSC_RING_H)
+#define QUANTAL_CORE_SPSC_RING_H 1
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace quantal {
+
+/**
+ * Lock-free ring buffer between one producer thread and one consumer thread
+ *
+ * The capacity is rounded up to a power of 2. Writes are all or nothing, so
+ * the consumer never sees part of a record. Neither side allocates or
+ * blocks.
+ */
+template <typename T>
+struct SpscRing {
+    explicit SpscRing(size_t minCapacity) {
+        size_t capacity = 1;
+        while (capacity < minCapacity) {
+            capacity <<= 1;
+        }
+        buffer.resize(capacity);
+        mask = capacity - 1;
+    }
+
+    size_t capacity() const {
+        return buffer.size();
+    }
+
+    /**
+     * Items the consumer can read
+     */
+    size_t readAvailable() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Room the producer can write to
+     */
+    size_t writeAvailable() const {
+        return buffer.size() - (head.load(std::memory_order_relaxed) - tail.load(std::memory_order_acquire));
+    }
+
+    /**
+     * Append `n` items, or nothing if they don't all fit. Producer only.
+     */
+    bool write(const T* data, size_t n) {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (buffer.size() - (h - tail.load(std::memory_order_acquire)) < n) {
+            return false;
+        }
+        for (size_t i = 0; i < n; i++) {
+            buffer[(h + i) & mask] = data[i];
+        }
+        head.store(h + n, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Take up to `max` items into `out`, returning how many. Consumer only.
+     */
+    size_t read(T* out, size_t max) {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        size_t n = head.load(std::memory_order_acquire) - t;
+        if (n > max) {
+            n = max;
+        }
+        for (size_t i = 0; i < n; i++) {
+            out[i] = buffer[(t + i) & mask];
+        }
+        tail.store(t + n, std::memory_order_release);
+        return n;
+    }
+
+private:
+
+    std::vector<T> buffer;
+    size_t mask = 0;
+    // Items ever written and read; they only grow, and wrap around together
+    std::atomic<size_t> head{0};
+    std::atomic<size_t> tail{0};
+};
+
+} // namespace quantal
+
+#endif
@@ -0,0 +1,1310 @@
+/**
+ * Conformance tests for the daisy-chain expander modules
+ *
+ * Builds random rows of DaisyChannel2, DaisyChannelVu, DaisyChannelSends2 and
+ * DaisyBlank modules (1 to 128 of them) in front of a DaisyMaster2 or
+ * DaisyGroup, some split across two rows by a bridge, steps
+ * them the way Rack's engine does, and checks the master outputs, solo bus,
+ * aux sends, channel counts and strip numbering against a reference model
+ * of the chain, every frame. With the modules' message checks on, every hop
+ * must see no torn or stale reads and no skipped flips.
+ *
+ * Usage: daisy-chain-test [seed] [chains]
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+// The modules are compiled into this file so the tests can reach their
+// members; the stub's createModel() registers them for lookup
+#include "DaisyBlank.cpp"
+#include "DaisyBridge.cpp"
+#include "DaisyChannel.cpp"
+#include "DaisyChannel2.cpp"
+#include "DaisyChannelSends2.cpp"
+#include "DaisyChannelVu.cpp"
+#include "DaisyGroup.cpp"
+#include "DaisyMaster.cpp"
+#include "DaisyMaster2.cpp"
+
+Plugin* pluginInstance;
+
+// Longest chain the tests build
+constexpr int MAX_STRIPS = 128;
+
+// Frames to keep running once the first strip's signal reaches the master
+constexpr int SETTLE_FRAMES = 32;
+
+enum StripType {
+    CHANNEL,
+    VU,
+    SENDS,
+    BLANK,
+    // A DaisyBridgeSend ending a row, always followed by the
+    // DaisyBridgeReceive starting the next
+    BRIDGE_SEND,
+    BRIDGE_RECEIVE
+};
+
+/**
+ * One module in the chain and how it is set up
+ */
+struct StripSpec {
+    StripType type = CHANNEL;
+
+    // DaisyChannel2
+    float level = 1.f;
+    float pan = 0.f;
+    float mute = VALUE_OFF;
+    bool directOutsPremute = false;
+    // Channels patched into the left, right and level CV inputs; 0 for none
+    int channelsL = 1;
+    int channelsR = 0;
+    int channelsCv = 0;
+    float aux1 = 0.f;
+    float aux2 = 0.f;
+    // Frames the inputs are 0V for, from silentFrom until silentUntil
+    int64_t silentFrom = 0;
+    int64_t silentUntil = 0;
+
+    // DaisyChannelSends2
+    int group = 1;
+};
+
+struct ChainSpec {
+    std::vector<StripSpec> strips;
+    float masterLevel = 1.f;
+    // Whether the chain ends in a DaisyGroup rather than a DaisyMaster2
+    bool group = false;
+    // Whether a DaisyChannelVu is attached to the right of the master
+    bool masterVu = false;
+    // Peak input voltage, kept lower on long chains so the bus limit
+    // doesn't clip everything
+    float amplitude = 5.f;
+    // Frame by which every channel strip should be idle; 0 for no check
+    int64_t idleBy = 0;
+};
+
+/**
+ * Deterministic test voltage from -1 to 1 for an input channel at a frame,
+ * so the reference model can work out what any strip was fed at any time
+ */
+static float testNoise(int strip, int jack, int c, int64_t frame) {
+    uint32_t x = static_cast<uint32_t>(strip) * 0x9e3779b1u;
+    x ^= static_cast<uint32_t>(jack) * 0x85ebca77u;
+    x ^= static_cast<uint32_t>(c) * 0xc2b2ae3du;
+    x ^= static_cast<uint32_t>(frame) * 0x27d4eb2fu;
+    x ^= x >> 15;
+    x *= 0x2c1b3c6du;
+    x ^= x >> 12;
+    x *= 0x297a2d39u;
+    x ^= x >> 15;
+    return static_cast<float>(x) / 2147483648.f - 1.f;
+}
+
+static float inputVoltage(const ChainSpec &chain, int strip, int side, int c, int64_t frame) {
+    const StripSpec &s = chain.strips[strip];
+    if (frame >= s.silentFrom && frame < s.silentUntil) {
+        return 0.f;
+    }
+    return chain.amplitude * testNoise(strip, side, c, frame);
+}
+
+// Level CV spans a bit more than 0 to 10V so the clamp gets exercised
+static float cvVoltage(int strip, int c, int64_t frame) {
+    return 6.f + 6.f * testNoise(strip, 2, c, frame);
+}
+
+/**
+ * Reference stereo signal, with the sum of magnitudes that went into it for
+ * the comparison tolerance
+ */
+struct RefSignal {
+    int channels = 0;
+    double l[16] = {};
+    double r[16] = {};
+    double magnitude[16] = {};
+
+    void add(const RefSignal &s, double amount) {
+        channels = std::max(channels, s.channels);
+        for (int c = 0; c < 16; c++) {
+            l[c] += s.l[c] * amount;
+            r[c] += s.r[c] * amount;
+            magnitude[c] += (std::fabs(s.l[c]) + std::fabs(s.r[c])) * std::fabs(amount);
+        }
+    }
+};
+
+/**
+ * What a DaisyChannel2 puts on the chain at a frame
+ */
+static RefSignal referenceStrip(const ChainSpec &chain, int index, int64_t frame) {
+    const StripSpec &s = chain.strips[index];
+    RefSignal out;
+    if (s.mute > VALUE_OFF) {
+        return out;
+    }
+
+    out.channels = std::max(s.channelsL, s.channelsR);
+    if (s.mute < VALUE_OFF && out.channels == 0) {
+        out.channels = 1;
+    }
+
+    const double gain = static_cast<double>(s.level) * s.level;
+    const double gainL = std::cos(M_PI * (s.pan + 1.0) / 4.0) * gain;
+    const double gainR = std::sin(M_PI * (s.pan + 1.0) / 4.0) * gain;
+    for (int c = 0; c < out.channels; c++) {
+        const double inL = (c < s.channelsL) ? inputVoltage(chain, index, 0, c, frame) : 0.0;
+        double inR = inL;
+        if (s.channelsR > 0) {
+            inR = (c < s.channelsR) ? inputVoltage(chain, index, 1, c, frame) : 0.0;
+        }
+
+        double level = 1.0;
+        if (s.channelsCv > 0) {
+            const int cvChannel = (s.channelsCv == 1) ? 0 : c;
+            const double cv = (cvChannel < s.channelsCv) ? cvVoltage(index, cvChannel, frame) : 0.0;
+            level = std::min(std::max(cv / 10.0, 0.0), 1.0);
+        }
+
+        out.l[c] = inL * gainL * level;
+        out.r[c] = inR * gainR * level;
+    }
+    return out;
+}
+
+/**
+ * Expected bus at module `position` for frame `frame`: the sum of the
+ * DaisyChannel2 strips to its left, each delayed by one frame per expander
+ * hop and scaled by the amount `select` returns (negative to leave a strip
+ * off the bus altogether)
+ */
+template <typename F>
+static RefSignal referenceBus(const ChainSpec &chain, int position, int64_t frame, F select) {
+    RefSignal bus;
+    for (int i = 0; i < position; i++) {
+        const int64_t sourceFrame = frame - (position - i);
+        if (chain.strips[i].type != CHANNEL || sourceFrame < 0) {
+            continue;
+        }
+        const double amount = select(chain.strips[i]);
+        if (amount >= 0.0) {
+            bus.add(referenceStrip(chain, i, sourceFrame), amount);
+        }
+    }
+    return bus;
+}
+
+/**
+ * Steps a row of modules the way Rack's engine does: every module processes
+ * the frame in no particular order, then every expander that requested a
+ * message flip swaps its producer and consumer messages
+ */
+struct TestRack {
+    std::vector<Module*> modules;
+    std::vector<Module*> order;
+    std::mt19937 rng;
+    int64_t frame = 0;
+    // An expander whose next flip is left out, as if the engine missed it
+    Module::Expander* skipFlip = nullptr;
+
+    explicit TestRack(uint32_t seed) : rng(seed) {}
+
+    ~TestRack() {
+        for (Module* m : modules) {
+            delete m;
+        }
+    }
+
+    Module* add(Model* model) {
+        Module* m = model->createModule();
+        m->id = modules.size() + 1;
+        modules.push_back(m);
+        order.push_back(m);
+        return m;
+    }
+
+    /**
+     * Place the modules side by side, left to right in the order added
+     */
+    void connect() {
+        for (size_t i = 0; i < modules.size(); i++) {
+            Module* left = (i > 0) ? modules[i - 1] : nullptr;
+            Module* right = (i + 1 < modules.size()) ? modules[i + 1] : nullptr;
+            modules[i]->leftExpander.module = left;
+            modules[i]->leftExpander.moduleId = left ? left->id : -1;
+            modules[i]->rightExpander.module = right;
+            modules[i]->rightExpander.moduleId = right ? right->id : -1;
+        }
+    }
+
+    void step() {
+        std::shuffle(order.begin(), order.end(), rng);
+
+        Module::ProcessArgs args;
+        args.sampleRate = APP->engine->getSampleRate();
+        args.sampleTime = 1.f / args.sampleRate;
+        args.frame = frame;
+        for (Module* m : order) {
+            m->process(args);
+        }
+
+        for (Module* m : modules) {
+            if (&m->leftExpander != skipFlip) {
+                flip(m->leftExpander);
+            }
+            if (&m->rightExpander != skipFlip) {
+                flip(m->rightExpander);
+            }
+        }
+        skipFlip = nullptr;
+        frame++;
+    }
+
+    /**
+     * Start a new row at module `i`, so it and the module before it are no
+     * longer side by side
+     */
+    void split(size_t i) {
+        modules[i - 1]->rightExpander.module = nullptr;
+        modules[i - 1]->rightExpander.moduleId = -1;
+        modules[i]->leftExpander.module = nullptr;
+        modules[i]->leftExpander.moduleId = -1;
+    }
+
+private:
+
+    static void flip(Module::Expander &expander) {
+        if (expander.messageFlipRequested) {
+            std::swap(expander.producerMessage, expander.consumerMessage);
+            expander.messageFlipRequested = false;
+        }
+    }
+};
+
+static void patchInput(Input &input, int channels, int strip, int jack, const ChainSpec &chain, int64_t frame) {
+    input.channels = channels;
+    for (int c = 0; c < 16; c++) {
+        float v = 0.f;
+        if (c < channels) {
+            v = (jack == 2) ? cvVoltage(strip, c, frame) : inputVoltage(chain, strip, jack, c, frame);
+        }
+        input.voltages[c] = v;
+    }
+}
+
+static std::string describe(const ChainSpec &chain) {
+    std::string text;
+    for (const StripSpec &s : chain.strips) {
+        switch (s.type) {
+            case CHANNEL:
+                text += (s.mute > VALUE_OFF) ? "m" : (s.mute < VALUE_OFF) ? "s" : "C";
+                break;
+            case VU:
+                text += "V";
+                break;
+            case SENDS:
+                text += (s.group == 1) ? "1" : "2";
+                break;
+            case BLANK:
+                text += "B";
+                break;
+            case BRIDGE_SEND:
+                text += ">";
+                break;
+            case BRIDGE_RECEIVE:
+                text += "<";
+                break;
+        }
+    }
+    text += chain.group ? "|G" : "|M";
+    text += chain.masterVu ? "V" : "";
+    return text;
+}
+
+/**
+ * Tallies checks and reports the first few failures of each chain
+ */
+struct Checker {
+    const ChainSpec* chain = nullptr;
+    int chainIndex = 0;
+    long checks = 0;
+    long failures = 0;
+    int chainFailures = 0;
+
+    void startChain(const ChainSpec &c, int index) {
+        chain = &c;
+        chainIndex = index;
+        chainFailures = 0;
+    }
+
+    void fail(const std::string &what, int64_t frame, double expected, double actual) {
+        failures++;
+        if (chainFailures++ < 5) {
+            std::printf("FAIL chain %d [%s] frame %lld: %s expected %.7g, got %.7g\n",
+                        chainIndex, describe(*chain).c_str(), static_cast<long long>(frame), what.c_str(), expected, actual);
+        }
+    }
+
+    void count(const std::string &what, int64_t frame, int expected, int actual) {
+        checks++;
+        if (expected != actual) {
+            fail(what, frame, expected, actual);
+        }
+    }
+
+    /**
+     * Compare a stereo output pair to the reference, after the
+     * clamp and gain the bus output stage applies
+     */
+    void stereo(const std::string &what, int64_t frame, Output &outL, Output &outR, const RefSignal &ref,
+                double limit, double gain) {
+        // A connected output never reports fewer than 1 channel
+        count(what + " channels", frame, std::max(ref.channels, 1), outL.getChannels());
+        count(what + " R channels", frame, std::max(ref.channels, 1), outR.getChannels());
+
+        for (int c = 0; c < 16; c++) {
+            const double l = (c < ref.channels) ? std::min(std::max(ref.l[c], -limit), limit) * gain : 0.0;
+            const double r = (c < ref.channels) ? std::min(std::max(ref.r[c], -limit), limit) * gain : 0.0;
+            const double tolerance = 2e-5 * (1.0 + ref.magnitude[c] * gain);
+
+            checks += 2;
+            if (std::fabs(outL.voltages[c] - l) > tolerance) {
+                fail(what + " L ch " + std::to_string(c + 1), frame, l, outL.voltages[c]);
+            }
+            if (std::fabs(outR.voltages[c] - r) > tolerance) {
+                fail(what + " R ch " + std::to_string(c + 1), frame, r, outR.voltages[c]);
+            }
+        }
+    }
+};
+
+/**
+ * The message check of the hop into a module, if it has one
+ */
+static MessageCheck* messageCheckOf(Module* m) {
+    if (m->model == modelDaisyChannel2) {
+        return &static_cast<DaisyChannel2*>(m)->messageCheck;
+    }
+    if (m->model == modelDaisyChannelVu) {
+        return &static_cast<DaisyChannelVu*>(m)->messageCheck;
+    }
+    if (m->model == modelDaisyChannelSends2) {
+        return &static_cast<DaisyChannelSends2*>(m)->messageCheck;
+    }
+    if (m->model == modelDaisyBlank) {
+        return &static_cast<DaisyBlank*>(m)->messageCheck;
+    }
+    if (m->model == modelDaisyGroup) {
+        return &static_cast<DaisyGroup*>(m)->messageCheck;
+    }
+    if (m->model == modelDaisyBridgeSend) {
+        return &static_cast<DaisyBridgeSend*>(m)->messageCheck;
+    }
+    if (m->model == modelDaisyBridgeReceive) {
+        return &static_cast<DaisyBridgeReceive*>(m)->messageCheck;
+    }
+    if (m->model == modelDaisyMaster2) {
+        return &static_cast<DaisyMaster2*>(m)->messageCheck;
+    }
+    return nullptr;
+}
+
+static void runChain(const ChainSpec &chain, uint32_t seed, Checker &check) {
+    TestRack rack(seed);
+    const int n = chain.strips.size();
+
+    std::vector<Module*> strips;
+    for (const StripSpec &s : chain.strips) {
+        switch (s.type) {
+            case CHANNEL: {
+                DaisyChannel2* m = static_cast<DaisyChannel2*>(rack.add(modelDaisyChannel2));
+                m->params[DaisyChannel2::CH_LVL_PARAM].setValue(s.level);
+                m->params[DaisyChannel2::PAN_PARAM].setValue(s.pan);
+                m->params[DaisyChannel2::MUTE_PARAM].setValue(s.mute);
+                m->directOutsPremute = s.directOutsPremute;
+                m->levelSlew = false;
+                m->aux1_send_amt = s.aux1;
+                m->aux2_send_amt = s.aux2;
+                strips.push_back(m);
+                break;
+            }
+            case VU:
+                strips.push_back(rack.add(modelDaisyChannelVu));
+                break;
+            case SENDS: {
+                DaisyChannelSends2* m = static_cast<DaisyChannelSends2*>(rack.add(modelDaisyChannelSends2));
+                m->group = s.group;
+                for (Output &output : m->outputs) {
+                    output.channels = 1;
+                }
+                strips.push_back(m);
+                break;
+            }
+            case BLANK:
+                strips.push_back(rack.add(modelDaisyBlank));
+                break;
+            case BRIDGE_SEND: {
+                DaisyBridgeSend* m = static_cast<DaisyBridgeSend*>(rack.add(modelDaisyBridgeSend));
+                m->bridgeIndex = seed % DAISY_BRIDGE_IDS;
+                strips.push_back(m);
+                break;
+            }
+            case BRIDGE_RECEIVE: {
+                DaisyBridgeReceive* m = static_cast<DaisyBridgeReceive*>(rack.add(modelDaisyBridgeReceive));
+                m->bridgeIndex = seed % DAISY_BRIDGE_IDS;
+                strips.push_back(m);
+                break;
+            }
+        }
+    }
+
+    // The group's outputs, level and solo bus work like the master's
+    Module* master = rack.add(chain.group ? modelDaisyGroup : modelDaisyMaster2);
+    int levelParam = DaisyMaster2::MIX_LVL_PARAM;
+    int outputL = DaisyMaster2::MIX_OUTPUT_1;
+    int outputR = DaisyMaster2::MIX_OUTPUT_2;
+    if (chain.group) {
+        levelParam = DaisyGroup::GROUP_LVL_PARAM;
+        outputL = DaisyGroup::GROUP_OUTPUT_1;
+        outputR = DaisyGroup::GROUP_OUTPUT_2;
+    }
+    master->params[levelParam].setValue(chain.masterLevel);
+    Output &masterL = master->outputs[outputL];
+    Output &masterR = master->outputs[outputR];
+    for (Output &output : master->outputs) {
+        output.channels = 1;
+    }
+    if (chain.masterVu) {
+        rack.add(modelDaisyChannelVu);
+    }
+    rack.connect();
+    for (int i = 0; i < n; i++) {
+        if (chain.strips[i].type == BRIDGE_RECEIVE) {
+            rack.split(i);
+        }
+    }
+
+    int64_t frames = n + SETTLE_FRAMES;
+    for (const StripSpec &s : chain.strips) {
+        frames = std::max(frames, s.silentUntil + n + SETTLE_FRAMES);
+    }
+    for (int64_t f = 0; f < frames; f++) {
+        for (int i = 0; i < n; i++) {
+            const StripSpec &s = chain.strips[i];
+            if (s.type == CHANNEL) {
+                DaisyChannel2* m = static_cast<DaisyChannel2*>(strips[i]);
+                patchInput(m->inputs[DaisyChannel2::CH_INPUT_1], s.channelsL, i, 0, chain, f);
+                patchInput(m->inputs[DaisyChannel2::CH_INPUT_2], s.channelsR, i, 1, chain, f);
+                patchInput(m->inputs[DaisyChannel2::LVL_CV_INPUT], s.channelsCv, i, 2, chain, f);
+            }
+        }
+
+        rack.step();
+
+        if (f + 1 == chain.idleBy) {
+            for (int i = 0; i < n; i++) {
+                if (chain.strips[i].type == CHANNEL) {
+                    check.count("strip " + std::to_string(i + 1) + " idle", f, 1,
+                                static_cast<DaisyChannel2*>(strips[i])->idle);
+                }
+            }
+        }
+
+        // Master: the solo bus replaces the mix while any soloed strip is
+        // on it; the mix comes back up from the chain's 1 / DAISY_DIVISOR
+        const RefSignal solo = referenceBus(chain, n, f, [](const StripSpec & s) {
+            return (s.mute < VALUE_OFF) ? 1.0 : -1.0;
+        });
+        const RefSignal mix = referenceBus(chain, n, f, [](const StripSpec & s) {
+            return 1.0;
+        });
+        check.stereo("master", f, masterL, masterR, (solo.channels > 0) ? solo : mix, DAISY_BUS_LIMIT, chain.masterLevel);
+
+        // Sends: the aux group's sum of the strips to the left
+        for (int i = 0; i < n; i++) {
+            const StripSpec &s = chain.strips[i];
+            if (s.type != SENDS) {
+                continue;
+            }
+            const int group = s.group;
+            const RefSignal aux = referenceBus(chain, i, f, [group](const StripSpec & strip) {
+                return static_cast<double>(group == 1 ? strip.aux1 : strip.aux2);
+            });
+            check.stereo("sends " + std::to_string(i + 1), f, strips[i]->outputs[DaisyChannelSends2::CH_OUTPUT_1],
+                         strips[i]->outputs[DaisyChannelSends2::CH_OUTPUT_2], aux, 1e30, 1.0);
+        }
+    }
+
+    // Once the control data has crossed the chain, each channel strip is
+    // numbered after the channel strips to its left
+    while (rack.frame < (n + 1) * DAISY_CONTROL_DIVISION) {
+        rack.step();
+    }
+    int expectedId = 1;
+    for (int i = 0; i < n; i++) {
+        if (chain.strips[i].type == CHANNEL) {
+            check.count("strip " + std::to_string(i + 1) + " id", rack.frame, expectedId,
+                        static_cast<DaisyChannel2*>(strips[i])->channelStripId);
+            expectedId++;
+        }
+    }
+
+    // Stepped like the engine, no hop sees a bad message
+    for (size_t i = 0; i < rack.modules.size(); i++) {
+        const MessageCheck* hop = messageCheckOf(rack.modules[i]);
+        const std::string what = "module " + std::to_string(i + 1);
+        check.count(what + " torn reads", rack.frame, 0, hop->torn);
+        check.count(what + " stale reads", rack.frame, 0, hop->stale);
+        check.count(what + " skipped flips", rack.frame, 0, hop->skipped);
+    }
+}
+
+/**
+ * Muting a strip mutes the others in its mute group on both sides of it,
+ * once the control data has been to the end of the chain and back; with
+ * `bridged`, the chain is split across two rows by a bridge
+ */
+static void checkMuteGroups(uint32_t seed, Checker &check, bool bridged) {
+    TestRack rack(seed);
+    std::vector<DaisyChannel2*> strips;
+    size_t receive = 0;
+    for (int i = 0; i < 5; i++) {
+        strips.push_back(static_cast<DaisyChannel2*>(rack.add(modelDaisyChannel2)));
+        if (i == 2 && bridged) {
+            rack.add(modelDaisyBridgeSend);
+            receive = rack.modules.size();
+            rack.add(modelDaisyBridgeReceive);
+        } else if (i == 2) {
+            rack.add(modelDaisyChannelVu);
+        }
+    }
+    rack.add(modelDaisyMaster2);
+    rack.connect();
+    if (bridged) {
+        rack.split(receive);
+    }
+    strips[0]->muteGroup = 1;
+    strips[1]->muteGroup = 2;
+    strips[3]->muteGroup = 1;
+    strips[4]->muteGroup = 1;
+
+    const int64_t roundTrip = 2 * (rack.modules.size() + 1) * DAISY_CONTROL_DIVISION;
+    auto settle = [&]() {
+        for (int64_t f = 0; f < roundTrip; f++) {
+            rack.step();
+        }
+    };
+
+    strips[3]->params[DaisyChannel2::MUTE_PARAM].setValue(VALUE_MUTE);
+    settle();
+    const int mutedByGroup[5] = {1, 0, 0, 1, 1};
+    for (int i = 0; i < 5; i++) {
+        check.count(std::string(bridged ? "bridged " : "") + "group muted strip " + std::to_string(i + 1), rack.frame,
+                    mutedByGroup[i], strips[i]->muted);
+    }
+
+    strips[3]->params[DaisyChannel2::MUTE_PARAM].setValue(VALUE_OFF);
+    settle();
+    for (int i = 0; i < 5; i++) {
+        check.count(std::string(bridged ? "bridged " : "") + "group unmuted strip " + std::to_string(i + 1), rack.frame,
+                    0, strips[i]->muted);
+    }
+}
+
+/**
+ * A strip leading a VCA group sets the level of the others in it on both
+ * sides, and a group with no lead leaves its strips alone. With `bridged`,
+ * the chain is split across two rows by a bridge
+ */
+static void checkVcaGroups(uint32_t seed, Checker &check, bool bridged) {
+    TestRack rack(seed);
+    std::vector<DaisyChannel2*> strips;
+    size_t receive = 0;
+    for (int i = 0; i < 5; i++) {
+        strips.push_back(static_cast<DaisyChannel2*>(rack.add(modelDaisyChannel2)));
+        if (i == 2 && bridged) {
+            rack.add(modelDaisyBridgeSend);
+            receive = rack.modules.size();
+            rack.add(modelDaisyBridgeReceive);
+        }
+    }
+    rack.add(modelDaisyMaster2);
+    rack.connect();
+    if (bridged) {
+        rack.split(receive);
+    }
+    for (DaisyChannel2* strip : strips) {
+        strip->params[DaisyChannel2::CH_LVL_PARAM].setValue(1.f);
+        strip->params[DaisyChannel2::PAN_PARAM].setValue(0.f);
+        strip->params[DaisyChannel2::MUTE_PARAM].setValue(VALUE_OFF);
+        strip->inputs[DaisyChannel2::CH_INPUT_1].channels = 1;
+        strip->inputs[DaisyChannel2::CH_INPUT_1].voltages[0] = 1.f;
+        strip->outputs[DaisyChannel2::CH_OUTPUT_1].channels = 1;
+    }
+    strips[0]->vcaGroup = 1;
+    strips[1]->vcaGroup = 2;
+    strips[3]->vcaGroup = 1;
+    strips[3]->vcaLead = true;
+    strips[4]->vcaGroup = 1;
+
+    // A round trip of the control data, then long enough to slew
+    const int64_t settle = 2 * (rack.modules.size() + 1) * DAISY_CONTROL_DIVISION + APP->engine->getSampleRate() * 0.01f;
+    auto expectLevels = [&](const std::string & what, const float* levels) {
+        for (int i = 0; i < 5; i++) {
+            // Equal power centre pan
+            const float expected = levels[i] * levels[i] * std::sqrt(0.5f);
+            check.checks++;
+            if (std::fabs(strips[i]->outputs[DaisyChannel2::CH_OUTPUT_1].voltages[0] - expected) > 1e-5f) {
+                check.fail(std::string(bridged ? "bridged " : "") + what + " strip " + std::to_string(i + 1), rack.frame,
+                           expected, strips[i]->outputs[DaisyChannel2::CH_OUTPUT_1].voltages[0]);
+            }
+        }
+    };
+
+    strips[3]->params[DaisyChannel2::CH_LVL_PARAM].setValue(0.5f);
+    for (int64_t f = 0; f < settle; f++) {
+        rack.step();
+    }
+    const float led[5] = {0.5f, 1.f, 1.f, 0.5f, 0.5f};
+    expectLevels("VCA level", led);
+
+    strips[3]->vcaLead = false;
+    for (int64_t f = 0; f < settle; f++) {
+        rack.step();
+    }
+    const float unled[5] = {1.f, 1.f, 1.f, 0.5f, 1.f};
+    expectLevels("unled VCA level", unled);
+}
+
+/**
+ * D-MX2 captures and recalls mixer scenes of the strips along its chain,
+ * across a bridge, morphs between two of them with a mute as a fade to 0
+ * and a solo changing halfway, and keeps them in its patch data
+ */
+static void checkScenes(uint32_t seed, Checker &check) {
+    TestRack rack(seed);
+    std::vector<DaisyChannel2*> strips;
+    for (int i = 0; i < 3; i++) {
+        strips.push_back(static_cast<DaisyChannel2*>(rack.add(modelDaisyChannel2)));
+    }
+    rack.add(modelDaisyBridgeSend);
+    const size_t receive = rack.modules.size();
+    rack.add(modelDaisyBridgeReceive);
+    strips.push_back(static_cast<DaisyChannel2*>(rack.add(modelDaisyChannel2)));
+    DaisyMaster2* master = static_cast<DaisyMaster2*>(rack.add(modelDaisyMaster2));
+    rack.connect();
+    rack.split(receive);
+    // Let the bridge pair up
+    for (int f = 0; f < DAISY_CONTROL_DIVISION; f++) {
+        rack.step();
+    }
+
+    auto near = [&](const std::string & what, double expected, double actual) {
+        check.checks++;
+        if (std::fabs(expected - actual) > 1e-6) {
+            check.fail(what, rack.frame, expected, actual);
+        }
+    };
+    auto set = [&](int i, float level, float pan, float mute, float aux1, float aux2) {
+        strips[i]->params[DaisyChannel2::CH_LVL_PARAM].setValue(level);
+        strips[i]->params[DaisyChannel2::PAN_PARAM].setValue(pan);
+        strips[i]->params[DaisyChannel2::MUTE_PARAM].setValue(mute);
+        strips[i]->aux1_send_amt = aux1;
+        strips[i]->aux2_send_amt = aux2;
+    };
+    auto expect = [&](const std::string & what, int i, float level, float pan, float mute, float aux1, float aux2) {
+        const std::string strip = what + " strip " + std::to_string(i + 1);
+        near(strip + " level", level, strips[i]->params[DaisyChannel2::CH_LVL_PARAM].getValue());
+        near(strip + " pan", pan, strips[i]->params[DaisyChannel2::PAN_PARAM].getValue());
+        near(strip + " mute", mute, strips[i]->params[DaisyChannel2::MUTE_PARAM].getValue());
+        near(strip + " aux 1", aux1, strips[i]->aux1_send_amt);
+        near(strip + " aux 2", aux2, strips[i]->aux2_send_amt);
+    };
+    auto morphTo = [&](float position) {
+        master->params[DaisyMaster2::MORPH_PARAM].setValue(position);
+        for (int f = 0; f < DAISY_CONTROL_DIVISION; f++) {
+            rack.step();
+        }
+    };
+
+    master->scenes.resize(2);
+    set(0, 0.8f, -0.5f, VALUE_MUTE, 0.2f, 0.f);
+    set(1, 0.6f, 0.f, VALUE_OFF, 0.f, 1.f);
+    set(2, 1.f, 0.5f, VALUE_OFF, 0.4f, 0.4f);
+    set(3, 0.3f, 1.f, VALUE_OFF, 0.f, 0.f);
+    master->captureScene(master->scenes[0]);
+    set(0, 0.5f, 0.5f, VALUE_OFF, 0.6f, 0.f);
+    set(1, 0.2f, 0.f, VALUE_MUTE, 0.f, 0.5f);
+    set(2, 1.f, -0.5f, VALUE_SOLO, 0.f, 0.4f);
+    set(3, 0.7f, 0.f, VALUE_OFF, 1.f, 0.f);
+    master->captureScene(master->scenes[1]);
+    check.count("scene strips", 0, 4, master->scenes[0].strips.size());
+
+    master->recallScene(master->scenes[0]);
+    expect("recalled", 0, 0.8f, -0.5f, VALUE_MUTE, 0.2f, 0.f);
+    expect("recalled", 1, 0.6f, 0.f, VALUE_OFF, 0.f, 1.f);
+    expect("recalled", 2, 1.f, 0.5f, VALUE_OFF, 0.4f, 0.4f);
+    expect("recalled", 3, 0.3f, 1.f, VALUE_OFF, 0.f, 0.f);
+
+    master->morphFrom = 0;
+    master->morphTo = 1;
+    master->sceneMorphChanged = true;
+    master->updateSceneMorph();
+
+    morphTo(0.25f);
+    expect("morph 25%", 0, 0.125f, -0.25f, VALUE_OFF, 0.3f, 0.f);
+    expect("morph 25%", 1, 0.45f, 0.f, VALUE_OFF, 0.f, 0.875f);
+    expect("morph 25%", 2, 1.f, 0.25f, VALUE_OFF, 0.3f, 0.4f);
+    expect("morph 25%", 3, 0.4f, 0.75f, VALUE_OFF, 0.25f, 0.f);
+
+    morphTo(0.75f);
+    expect("morph 75%", 1, 0.15f, 0.f, VALUE_OFF, 0.f, 0.625f);
+    expect("morph 75%", 2, 1.f, -0.25f, VALUE_SOLO, 0.1f, 0.4f);
+
+    morphTo(1.f);
+    expect("morph 100%", 0, 0.5f, 0.5f, VALUE_OFF, 0.6f, 0.f);
+    expect("morph 100%", 1, 0.2f, 0.f, VALUE_MUTE, 0.f, 0.5f);
+    expect("morph 100%", 2, 1.f, -0.5f, VALUE_SOLO, 0.f, 0.4f);
+
+    morphTo(0.f);
+    expect("morph 0%", 0, 0.8f, -0.5f, VALUE_MUTE, 0.2f, 0.f);
+
+    // Scenes survive saving and loading the patch
+    json_t* rootJ = master->dataToJson();
+    DaisyMaster2 loaded;
+    loaded.dataFromJson(rootJ);
+    json_decref(rootJ);
+    check.count("loaded scenes", 0, 2, loaded.scenes.size());
+    check.count("loaded morph to", 0, 1, loaded.morphTo);
+    check.count("loaded morph", 0, 1, loaded.sceneMorph.load() != nullptr);
+    if (loaded.scenes.size() == 2) {
+        const quantal::StripSettings &settings = loaded.scenes[1].strips[strips[1]->id];
+        near("loaded level", 0.2f, settings.level);
+        check.count("loaded mute", 0, 1, settings.muted);
+    }
+}
+
+/**
+ * A v1 cable chain is found from any of its modules, its cables are mapped
+ * to the ports of the replacements, and a replacement strip sounds like
+ * the v1 strip on its left output
+ */
+static void checkMigration(uint32_t seed, Checker &check) {
+    TestRack rack(seed);
+    Module* source = rack.add(modelDaisyBlank);
+    std::vector<Module*> v1;
+    for (int i = 0; i < 3; i++) {
+        v1.push_back(rack.add(modelDaisyChannel));
+    }
+    v1.push_back(rack.add(modelDaisyMaster));
+    Module* loose = rack.add(modelDaisyChannel);
+
+    std::vector<Cable> patch;
+    auto patchCable = [&](Module * out, int outputId, Module * in, int inputId) {
+        Cable cable;
+        cable.id = patch.size() + 1;
+        cable.outputModule = out;
+        cable.outputId = outputId;
+        cable.inputModule = in;
+        cable.inputId = inputId;
+        patch.push_back(cable);
+    };
+    for (int i = 0; i < 3; i++) {
+        const int chainInput = (i < 2) ? static_cast<int>(DaisyChannel::CHAIN_INPUT) : static_cast<int>(DaisyMaster::CHAIN_INPUT);
+        patchCable(v1[i], DaisyChannel::CHAIN_OUTPUT, v1[i + 1], chainInput);
+        patchCable(source, 0, v1[i], DaisyChannel::CH_INPUT);
+    }
+    patchCable(source, 1, v1[1], DaisyChannel::LVL_CV_INPUT);
+    patchCable(v1[0], DaisyChannel::CH_OUTPUT, v1[2], DaisyChannel::LVL_CV_INPUT);
+    patchCable(v1[3], DaisyMaster::MIX_OUTPUT, source, 0);
+    patchCable(source, 1, v1[3], DaisyMaster::MIX_CV_INPUT);
+    // Dropped: a chain output patched elsewhere too
+    patchCable(v1[2], DaisyChannel::CHAIN_OUTPUT, source, 1);
+    std::vector<Cable*> cables;
+    for (Cable &cable : patch) {
+        cables.push_back(&cable);
+    }
+
+    for (Module* from : {v1[0], v1[2], v1[3]}) {
+        const std::vector<Module*> chain = findV1DaisyChain(from, cables);
+        check.count("v1 chain length", 0, 4, chain.size());
+        check.count("v1 chain order", 0, 1, chain == v1);
+    }
+    check.count("v1 chain without a master", 0, 0, findV1DaisyChain(loose, cables).size());
+
+    struct Expected {
+        int outputIndex;
+        int outputId;
+        int inputIndex;
+        int inputId;
+    };
+    const std::vector<Expected> expected = {
+        {-1, 0, 0, DaisyChannel2::CH_INPUT_1},
+        {-1, 0, 1, DaisyChannel2::CH_INPUT_1},
+        {-1, 0, 2, DaisyChannel2::CH_INPUT_1},
+        {-1, 1, 1, DaisyChannel2::LVL_CV_INPUT},
+        {0, DaisyChannel2::CH_OUTPUT_1, 2, DaisyChannel2::LVL_CV_INPUT},
+        {3, DaisyMaster2::MIX_OUTPUT_1, -1, 0},
+        {-1, 1, 3, DaisyMaster2::MIX_CV_INPUT},
+    };
+    const std::vector<MigratedCable> plan = planV1Migration(v1, cables);
+    check.count("migrated cables", 0, expected.size(), plan.size());
+    for (size_t i = 0; i < std::min(plan.size(), expected.size()); i++) {
+        const std::string what = "migrated cable " + std::to_string(i + 1);
+        check.count(what + " output", 0, expected[i].outputIndex, plan[i].outputIndex);
+        check.count(what + " output port", 0, expected[i].outputId, plan[i].outputId);
+        check.count(what + " input", 0, expected[i].inputIndex, plan[i].inputIndex);
+        check.count(what + " input port", 0, expected[i].inputId, plan[i].inputId);
+    }
+
+    // Panned hard left, the replacement's left output is the v1 strip's
+    v1[1]->params[DaisyChannel::CH_LVL_PARAM].setValue(0.7f);
+    DaisyChannel2 strip;
+    quantal::StripSettings settings;
+    settings.level = getDaisyChannelMigration(v1[1]).level;
+    settings.pan = -1.f;
+    setDaisyStripSettings(&strip, settings);
+    for (Module* m : {v1[1], static_cast<Module*>(&strip)}) {
+        m->inputs[0].channels = 1;
+        m->inputs[0].voltages[0] = 3.f;
+        m->outputs[0].channels = 1;
+    }
+    Module::ProcessArgs args;
+    args.sampleRate = APP->engine->getSampleRate();
+    args.sampleTime = 1.f / args.sampleRate;
+    args.frame = 0;
+    v1[1]->process(args);
+    strip.process(args);
+    check.checks++;
+    if (std::fabs(v1[1]->outputs[DaisyChannel::CH_OUTPUT].voltages[0] - strip.outputs[DaisyChannel2::CH_OUTPUT_1].voltages[0]) > 1e-6) {
+        check.fail("migrated strip output", 0, v1[1]->outputs[DaisyChannel::CH_OUTPUT].voltages[0],
+                   strip.outputs[DaisyChannel2::CH_OUTPUT_1].voltages[0]);
+    }
+}
+
+/**
+ * Strips are delayed to line up with the latest insert along the chain,
+ * across a bridge too, and a strip measures its insert by pinging it
+ */
+static void checkLatency(uint32_t seed, Checker &check, bool bridged) {
+    const std::string where = bridged ? " across a bridge" : "";
+    TestRack rack(seed);
+    std::vector<DaisyChannel2*> strips;
+    for (int i = 0; i < 3; i++) {
+        strips.push_back(static_cast<DaisyChannel2*>(rack.add(modelDaisyChannel2)));
+    }
+    size_t receive = 0;
+    if (bridged) {
+        rack.add(modelDaisyBridgeSend);
+        receive = rack.modules.size();
+        rack.add(modelDaisyBridgeReceive);
+    }
+    strips.push_back(static_cast<DaisyChannel2*>(rack.add(modelDaisyChannel2)));
+    DaisyMaster2* master = static_cast<DaisyMaster2*>(rack.add(modelDaisyMaster2));
+    rack.connect();
+    if (bridged) {
+        rack.split(receive);
+    }
+    for (DaisyChannel2* strip : strips) {
+        strip->params[DaisyChannel2::CH_LVL_PARAM].setValue(1.f);
+        strip->inputs[DaisyChannel2::CH_INPUT_1].channels = 1;
+    }
+    master->params[DaisyMaster2::MIX_LVL_PARAM].setValue(1.f);
+    master->outputs[DaisyMaster2::MIX_OUTPUT_1].channels = 1;
+
+    const int latency = 30;
+    strips[1]->latency = latency;
+    // Control data takes a control frame per module each way
+    for (int f = 0; f < 2 * static_cast<int>(rack.modules.size() + 1) * DAISY_CONTROL_DIVISION; f++) {
+        rack.step();
+    }
+    check.count("chain latency" + where, rack.frame, latency, master->control.latency);
+    for (size_t i = 0; i < strips.size(); i++) {
+        check.count("strip " + std::to_string(i + 1) + " compensation" + where, rack.frame,
+                    (i == 1) ? 0 : latency, strips[i]->delayFrames);
+    }
+
+    // Frames from an impulse into a strip until it reaches the mix
+    auto arrival = [&](size_t i) {
+        strips[i]->inputs[DaisyChannel2::CH_INPUT_1].voltages[0] = 5.f;
+        for (int f = 0; f < 4 * latency; f++) {
+            rack.step();
+            strips[i]->inputs[DaisyChannel2::CH_INPUT_1].voltages[0] = 0.f;
+            if (std::fabs(master->outputs[DaisyMaster2::MIX_OUTPUT_1].getVoltage()) > 1e-3f) {
+                // Let the impulse clear the chain before the next
+                for (int g = f; g < 4 * latency; g++) {
+                    rack.step();
+                }
+                return f;
+            }
+        }
+        return -1;
+    };
+    // Each module further from the mix is a frame later getting there; the
+    // compensation leaves that be
+    const int inserted = arrival(1);
+    const int closer = 2 + (bridged ? DAISY_BRIDGE_LATENCY + 1 : 0);
+    check.count("strip 1 aligned" + where, rack.frame, inserted + latency + 1, arrival(0));
+    check.count("strip 4 aligned" + where, rack.frame, inserted + latency - closer, arrival(3));
+
+    // An insert of 12 frames between the direct out and the input comes
+    // back 2 cable frames later, of which one counts against the strip
+    TestRack single(seed);
+    DaisyChannel2* strip = static_cast<DaisyChannel2*>(single.add(modelDaisyChannel2));
+    strip->outputs[DaisyChannel2::CH_OUTPUT_1].channels = 1;
+    for (int insert : {12, -1}) {
+        const std::string what = (insert < 0) ? "unpatched insert" : "measured insert";
+        strip->latency = 7;
+        strip->measureRequested = true;
+        std::vector<float> sent;
+        for (int f = 0; f < DAISY_MAX_LATENCY + 4; f++) {
+            single.step();
+            sent.push_back(strip->outputs[DaisyChannel2::CH_OUTPUT_1].getVoltage());
+            const int back = static_cast<int>(sent.size()) - 2 - insert;
+            strip->inputs[DaisyChannel2::CH_INPUT_1].channels = 1;
+            strip->inputs[DaisyChannel2::CH_INPUT_1].voltages[0] = (insert >= 0 && back >= 0) ? sent[back] * 0.5f : 0.f;
+        }
+        check.count(what + " done", single.frame, 0, strip->measureRequested.load());
+        check.count(what + " heard", single.frame, insert < 0, strip->measureFailed);
+        check.count(what + " latency", single.frame, (insert < 0) ? 7 : insert + 1, strip->latency);
+    }
+}
+
+/**
+ * D-MX2's stem outputs carry each strip in the chosen bank, summed to one
+ * channel a side, across a bridge too
+ */
+static void checkStems(uint32_t seed, Checker &check) {
+    TestRack rack(seed);
+    std::vector<DaisyChannel2*> strips;
+    size_t receive = 0;
+    for (int i = 0; i < 20; i++) {
+        if (i == 10) {
+            rack.add(modelDaisyBridgeSend);
+            receive = rack.modules.size();
+            rack.add(modelDaisyBridgeReceive);
+        }
+        strips.push_back(static_cast<DaisyChannel2*>(rack.add(modelDaisyChannel2)));
+    }
+    DaisyMaster2* master = static_cast<DaisyMaster2*>(rack.add(modelDaisyMaster2));
+    rack.connect();
+    rack.split(receive);
+    for (size_t i = 0; i < strips.size(); i++) {
+        DaisyChannel2* strip = strips[i];
+        strip->params[DaisyChannel2::CH_LVL_PARAM].setValue(0.5f + 0.02f * i);
+        strip->params[DaisyChannel2::PAN_PARAM].setValue(-0.9f + 0.09f * i);
+        strip->params[DaisyChannel2::MUTE_PARAM].setValue((i == 4) ? VALUE_MUTE : VALUE_OFF);
+        strip->inputs[DaisyChannel2::CH_INPUT_1].channels = 1 + i % 3;
+        for (int c = 0; c < 3; c++) {
+            strip->inputs[DaisyChannel2::CH_INPUT_1].voltages[c] = 1.f + 0.1f * i - 0.7f * c;
+        }
+        strip->outputs[DaisyChannel2::CH_OUTPUT_1].channels = 1;
+        strip->outputs[DaisyChannel2::CH_OUTPUT_2].channels = 1;
+    }
+    master->outputs[DaisyMaster2::STEM_OUTPUT_1].channels = 1;
+    master->outputs[DaisyMaster2::STEM_OUTPUT_2].channels = 1;
+
+    for (int bank : {0, 1}) {
+        master->stemBank = bank;
+        // The bank takes a control frame per module to reach the strips
+        for (int f = 0; f < 2 * static_cast<int>(rack.modules.size() + 1) * DAISY_CONTROL_DIVISION; f++) {
+            rack.step();
+        }
+        const int first = bank * DAISY_STEM_BANK_SIZE;
+        const int stems = std::min(static_cast<int>(strips.size()) - first, DAISY_STEM_BANK_SIZE);
+        const std::string what = "stem bank " + std::to_string(bank + 1);
+        check.count(what + " channels", rack.frame, stems, master->outputs[DaisyMaster2::STEM_OUTPUT_1].getChannels());
+        for (int k = 0; k < stems; k++) {
+            DaisyChannel2* strip = strips[first + k];
+            for (int side = 0; side < 2; side++) {
+                float expected = 0.f;
+                Output &direct = strip->outputs[side ? DaisyChannel2::CH_OUTPUT_2 : DaisyChannel2::CH_OUTPUT_1];
+                for (int c = 0; c < direct.getChannels(); c++) {
+                    expected += direct.getVoltage(c);
+                }
+                const float actual = master->outputs[side ? DaisyMaster2::STEM_OUTPUT_2 : DaisyMaster2::STEM_OUTPUT_1].getVoltage(k);
+                check.checks++;
+                if (std::fabs(expected - actual) > 1e-5f) {
+                    check.fail(what + " strip " + std::to_string(first + k + 1) + (side ? " R" : " L"), rack.frame, expected, actual);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * D-MX2 finds room for a whole row of new strips at once, as near to the
+ * left of the chain as they fit, in HP from the left of the rack
+ */
+static void checkSpawnLayout(Checker &check) {
+    const float hp = RACK_GRID_WIDTH;
+    const std::vector<Rect> boxes = {
+        // A chain from 40HP to 50HP, with a 2HP module at 10HP
+        Rect(Vec(40 * hp, 0), Vec(10 * hp, RACK_GRID_HEIGHT)),
+        Rect(Vec(10 * hp, 0), Vec(2 * hp, RACK_GRID_HEIGHT)),
+        // The next row full up to 100HP
+        Rect(Vec(0, RACK_GRID_HEIGHT), Vec(100 * hp, RACK_GRID_HEIGHT)),
+    };
+    auto spanAt = [&](float row, float right, float width) {
+        return static_cast<int>(DaisyMaster2::findFreeSpan(boxes, Vec(right * hp, row * RACK_GRID_HEIGHT), width * hp) / hp);
+    };
+
+    check.count("spawn next to the chain", 0, 20, spanAt(0, 40, 20));
+    check.count("spawn into a gap just wide enough", 0, 12, spanAt(0, 40, 28));
+    check.count("spawn past a gap too narrow", 0, 50, spanAt(0, 40, 30));
+    check.count("spawn at the end of a full row", 0, 100, spanAt(1, 40, 4));
+    check.count("spawn in an empty row", 0, 36, spanAt(2, 40, 4));
+}
+
+/**
+ * The message checks notice a missed flip and a message changed after it
+ * was stamped
+ */
+static void checkMessageChecks(uint32_t seed, Checker &check) {
+    TestRack rack(seed);
+    for (int i = 0; i < 3; i++) {
+        rack.add(modelDaisyChannel2);
+    }
+    rack.add(modelDaisyMaster2);
+    rack.connect();
+    const MessageCheck* hop = messageCheckOf(rack.modules[2]);
+
+    for (int f = 0; f < 10; f++) {
+        rack.step();
+    }
+    check.count("clean hop", rack.frame, 0, hop->torn + hop->stale + hop->skipped);
+
+    // The strip reads the same message again, then misses the one that was
+    // overwritten
+    rack.skipFlip = &rack.modules[2]->leftExpander;
+    for (int f = 0; f < 10; f++) {
+        rack.step();
+    }
+    check.count("missed flip stale reads", rack.frame, 1, hop->stale);
+    check.count("missed flip skipped flips", rack.frame, 1, hop->skipped);
+    check.count("missed flip torn reads", rack.frame, 0, hop->torn);
+
+    DaisyMessage* message = static_cast<DaisyMessage*>(rack.modules[2]->leftExpander.consumerMessage);
+    message->signals.voltages_l[0] += 1.f;
+    for (int f = 0; f < 10; f++) {
+        rack.step();
+    }
+    check.count("changed message torn reads", rack.frame, 1, hop->torn);
+    check.count("changed message stale reads", rack.frame, 1, hop->stale);
+
+    // The control flag is covered too
+    message = static_cast<DaisyMessage*>(rack.modules[2]->leftExpander.consumerMessage);
+    message->hasControl = !message->hasControl;
+    for (int f = 0; f < 10; f++) {
+        rack.step();
+    }
+    check.count("changed control flag torn reads", rack.frame, 2, hop->torn);
+    check.count("changed control flag stale reads", rack.frame, 1, hop->stale);
+}
+
+static StripSpec randomStrip(std::mt19937 &rng, bool allowSolo) {
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    std::uniform_int_distribution<int> channels(1, 16);
+
+    StripSpec s;
+    const float kind = unit(rng);
+    if (kind < 0.1f) {
+        s.type = VU;
+        return s;
+    }
+    if (kind < 0.25f) {
+        s.type = BLANK;
+        return s;
+    }
+    if (kind < 0.4f) {
+        s.type = SENDS;
+        s.group = (unit(rng) < 0.5f) ? 1 : 2;
+        return s;
+    }
+
+    s.level = unit(rng);
+    s.pan = 2.f * unit(rng) - 1.f;
+    const float mute = unit(rng);
+    if (mute < 0.15f) {
+        s.mute = VALUE_MUTE;
+    } else if (allowSolo && mute < 0.3f) {
+        s.mute = VALUE_SOLO;
+    }
+    s.directOutsPremute = unit(rng) < 0.3f;
+    s.channelsL = (unit(rng) < 0.1f) ? 0 : channels(rng);
+    s.channelsR = (unit(rng) < 0.5f) ? 0 : channels(rng);
+    s.channelsCv = (unit(rng) < 0.7f) ? 0 : channels(rng);
+    if (unit(rng) < 0.5f) {
+        s.aux1 = unit(rng);
+    }
+    if (unit(rng) < 0.5f) {
+        s.aux2 = unit(rng);
+    }
+    return s;
+}
+
+static ChainSpec randomChain(std::mt19937 &rng, int length) {
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+
+    ChainSpec chain;
+    const bool allowSolo = unit(rng) < 0.3f;
+    for (int i = 0; i < length; i++) {
+        chain.strips.push_back(randomStrip(rng, allowSolo));
+    }
+    chain.masterLevel = 2.f * unit(rng);
+    chain.masterVu = unit(rng) < 0.3f;
+    chain.amplitude = 5.f / std::max(1.f, std::sqrt(length / 4.f));
+    return chain;
+}
+
+/**
+ * Hand-picked layouts: the shortest and longest chains, and the edge cases
+ * of the solo and aux buses
+ */
+static std::vector<ChainSpec> fixedChains() {
+    std::vector<ChainSpec> chains;
+
+    ChainSpec single;
+    single.strips.resize(1);
+    chains.push_back(single);
+
+    ChainSpec longest;
+    longest.strips.resize(MAX_STRIPS);
+    for (int i = 0; i < MAX_STRIPS; i++) {
+        longest.strips[i].channelsL = 1 + i % 16;
+        longest.strips[i].level = 0.5f;
+    }
+    longest.amplitude = 0.5f;
+    chains.push_back(longest);
+
+    // A soloed strip with nothing patched still takes over the master
+    ChainSpec silentSolo;
+    silentSolo.strips.resize(3);
+    silentSolo.strips[0].channelsL = 4;
+    silentSolo.strips[1].channelsL = 0;
+    silentSolo.strips[1].mute = VALUE_SOLO;
+    silentSolo.strips[2].channelsL = 2;
+    chains.push_back(silentSolo);
+
+    // Pass-through modules only
+    ChainSpec passive;
+    passive.strips.resize(4);
+    passive.strips[0].type = BLANK;
+    passive.strips[1].type = VU;
+    passive.strips[2].type = SENDS;
+    passive.strips[3].type = BLANK;
+    chains.push_back(passive);
+
+    // Sends before, between and after the strips that feed them
+    ChainSpec sends;
+    sends.strips.resize(6);
+    sends.strips[0].type = SENDS;
+    sends.strips[1].aux1 = 1.f;
+    sends.strips[1].channelsL = 3;
+    sends.strips[2].type = SENDS;
+    sends.strips[3].aux2 = 0.5f;
+    sends.strips[3].channelsR = 5;
+    sends.strips[4].type = SENDS;
+    sends.strips[4].group = 2;
+    sends.strips[5].type = SENDS;
+    chains.push_back(sends);
+
+    // Parked strips idle on a silent chain, and each wakes on the frame its
+    // signal arrives
+    ChainSpec parked;
+    const int64_t wake = 2 * SilenceDetector().holdFrames;
+    parked.strips.resize(7);
+    parked.strips[0].channelsL = 4;
+    parked.strips[0].silentFrom = 100;
+    parked.strips[0].silentUntil = wake;
+    parked.strips[1].channelsL = 0;
+    parked.strips[1].aux1 = 1.f;
+    parked.strips[2].type = VU;
+    parked.strips[3].channelsL = 2;
+    parked.strips[3].mute = VALUE_MUTE;
+    parked.strips[4].type = SENDS;
+    parked.strips[5].type = BLANK;
+    parked.strips[6].channelsL = 3;
+    parked.strips[6].channelsR = 5;
+    parked.strips[6].aux1 = 0.5f;
+    parked.strips[6].silentFrom = 50;
+    parked.strips[6].silentUntil = wake - 3;
+    parked.idleBy = wake - 3;
+    chains.push_back(parked);
+
+    // A chain over two rows, with sends and a solo on the far side of the
+    // bridge from the strips they take
+    ChainSpec bridged;
+    bridged.strips.resize(7);
+    bridged.strips[0].channelsL = 16;
+    bridged.strips[0].aux1 = 1.f;
+    bridged.strips[1].mute = VALUE_SOLO;
+    bridged.strips[1].channelsR = 2;
+    bridged.strips[2].type = BRIDGE_SEND;
+    bridged.strips[3].type = BRIDGE_RECEIVE;
+    bridged.strips[4].type = SENDS;
+    bridged.strips[5].mute = VALUE_SOLO;
+    bridged.strips[5].channelsL = 3;
+    bridged.strips[6].type = VU;
+    chains.push_back(bridged);
+
+    return chains;
+}
+
+int main(int argc, char** argv) {
+    const uint32_t seed = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 1;
+    const int randomChains = (argc > 2) ? std::atoi(argv[2]) : 400;
+
+    initKernels();
+    APP->engine->sampleRate = 48000.f;
+
+    std::mt19937 rng(seed);
+    std::vector<ChainSpec> chains = fixedChains();
+    std::uniform_int_distribution<int> shortLength(1, 16);
+    std::uniform_int_distribution<int> anyLength(1, MAX_STRIPS);
+    for (int i = 0; i < randomChains; i++) {
+        // Mostly rack-sized chains, with some up to the longest, every
+        // fifth ending in a group and every seventh split by a bridge
+        chains.push_back(randomChain(rng, (i % 4 == 0) ? anyLength(rng) : shortLength(rng)));
+        chains.back().group = (i % 5 == 4);
+        if (i % 7 == 6) {
+            std::vector<StripSpec> &strips = chains.back().strips;
+            const int at = std::uniform_int_distribution<int>(0, strips.size())(rng);
+            StripSpec send;
+            send.type = BRIDGE_SEND;
+            StripSpec receive;
+            receive.type = BRIDGE_RECEIVE;
+            strips.insert(strips.begin() + at, {send, receive});
+        }
+    }
+
+    checkDaisyMessages.store(true, std::memory_order_relaxed);
+
+    Checker check;
+    for (size_t i = 0; i < chains.size(); i++) {
+        check.startChain(chains[i], i);
+        runChain(chains[i], seed + i, check);
+    }
+    ChainSpec checks;
+    check.startChain(checks, chains.size());
+    checkMessageChecks(seed, check);
+    checkMuteGroups(seed, check, false);
+    checkMuteGroups(seed, check, true);
+    checkVcaGroups(seed, check, false);
+    checkVcaGroups(seed, check, true);
+    checkSpawnLayout(check);
+    checkScenes(seed, check);
+    checkMigration(seed, check);
+    checkLatency(seed, check, false);
+    checkLatency(seed, check, true);
+    checkStems(seed, check);
+
+    std::printf("%s: %zu chains, %ld checks, %ld failures (seed %u, kernels %s)\n",
+                check.failures ? "FAILED" : "OK", chains.size(), check.checks, check.failures, seed, kernels->name);
+    return check.failures ? 1 : 0;
+}
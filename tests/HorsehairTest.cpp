@@ -0,0 +1,124 @@
+/**
+ * Tests for the Horsehair module's voice and unison state
+ *
+ * Runs Horsehair headless against the Rack API stub and checks what the
+ * engine thread keeps between frames as settings change.
+ *
+ * Usage: horsehair-test
+ */
+
+#include <cstdio>
+#include <string>
+
+// The module is compiled into this file so the tests can reach its members
+#include "Horsehair.cpp"
+
+Plugin* pluginInstance;
+
+static long checks = 0;
+static long failures = 0;
+
+static void check(const std::string &what, bool ok) {
+    checks++;
+    if (!ok) {
+        failures++;
+        std::printf("FAIL: %s\n", what.c_str());
+    }
+}
+
+static bool samePhases(const HorsehairVoiceGroup &a, const HorsehairVoiceGroup &b) {
+    for (int i = 0; i < 4; i++) {
+        if (a.oscillator.phase[i] != b.oscillator.phase[i] || a.oscillator2.phase[i] != b.oscillator2.phase[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Moving the detune or spread retunes the unison copies where they are;
+ * only a new number of copies restarts them at random phases
+ */
+static void checkUnisonPhases() {
+    Horsehair module;
+    Module::ProcessArgs args;
+    args.sampleRate = APP->engine->getSampleRate();
+    args.sampleTime = 1.f / args.sampleRate;
+    args.frame = 0;
+
+    // With no outputs patched the oscillators hold still, so any change of
+    // phase comes from the settings
+    module.setUnison(2);
+    module.process(args);
+    const HorsehairVoiceGroup before = module.voiceGroups[0];
+
+    UnisonQuantity detune(&module, UnisonQuantity::DETUNE);
+    detune.setValue(0.7f);
+    UnisonQuantity spread(&module, UnisonQuantity::SPREAD);
+    spread.setValue(0.1f);
+    module.process(args);
+    check("detune and spread keep the phases", samePhases(before, module.voiceGroups[0]));
+    check("detune reaches the lanes", !module.unisonChanged);
+
+    module.setUnison(4);
+    module.process(args);
+    check("a new unison count restarts the phases", !samePhases(before, module.voiceGroups[0]));
+}
+
+/**
+ * A polyphonic pitch input brings in more voices from process() alone, with
+ * no widget and without allocating, and the voices already running keep
+ * their phases
+ */
+static void checkVoiceGrowth() {
+    Horsehair module;
+    Module::ProcessArgs args;
+    args.sampleRate = APP->engine->getSampleRate();
+    args.sampleTime = 1.f / args.sampleRate;
+    args.frame = 0;
+
+    module.outputs[Horsehair::MIX_OUTPUT].channels = 1;
+    module.process(args);
+    check("one voice group to start", module.activeGroups == 1);
+    const HorsehairVoiceGroup before = module.voiceGroups[0];
+    const HorsehairVoiceGroup* allocated = module.voiceGroups.data();
+    module.voiceGroups[3].oscillator.phase = 0.5f;
+
+    module.inputs[Horsehair::PITCH_INPUT].channels = 16;
+    module.process(args);
+    check("16 channels run 4 voice groups", module.activeGroups == 4);
+    check("more voices don't allocate", module.voiceGroups.data() == allocated && module.voiceGroups.size() == 4);
+    check("a new voice group starts fresh", module.voiceGroups[3].oscillator.phase[0] < 0.5f);
+    check("16 channels are all output", module.outputs[Horsehair::MIX_OUTPUT].getChannels() == 16);
+
+    HorsehairVoiceGroup expected = before;
+    quantal::HorsehairSettings settings;
+    settings.octave[0] = module.params[Horsehair::OCTAVE_PARAM + 0].getValue();
+    settings.octave[1] = module.params[Horsehair::OCTAVE_PARAM + 1].getValue();
+    settings.fine = module.params[Horsehair::PITCH_PARAM].getValue() / 4.0f;
+    settings.pw[0] = module.params[Horsehair::PW_PARAM + 0].getValue();
+    settings.pw[1] = module.params[Horsehair::PW_PARAM + 1].getValue();
+    settings.mix = module.params[Horsehair::MIX_PARAM].getValue();
+    settings.shape[0] = module.params[Horsehair::SHAPE_PARAM + 0].getValue();
+    settings.shape[1] = module.params[Horsehair::SHAPE_PARAM + 1].getValue();
+    quantal::HorsehairInputs in;
+    float4 oscMix;
+    float4 sine;
+    expected.process(settings, args.sampleTime, 4, in, oscMix, sine);
+    check("the first voices carry on where they were", samePhases(expected, module.voiceGroups[0]));
+
+    module.inputs[Horsehair::PITCH_INPUT].channels = 2;
+    module.process(args);
+    check("fewer channels run fewer voice groups", module.activeGroups == 1);
+}
+
+int main() {
+    initKernels();
+    APP->engine->sampleRate = 48000.f;
+
+    checkUnisonPhases();
+    checkVoiceGrowth();
+
+    std::printf("%s: %ld checks, %ld failures\n", failures ? "FAILED" : "OK", checks, failures);
+    return failures ? 1 : 0;
+}
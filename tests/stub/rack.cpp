@@ -0,0 +1,450 @@
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+
+#include <sys/stat.h>
+
+#include "rack.hpp"
+
+struct json_t {
+    enum Type {
+        OBJECT,
+        ARRAY,
+        STRING,
+        INTEGER,
+        REAL,
+        TRUE,
+        FALSE,
+        NUL
+    };
+
+    Type type;
+    double number = 0.0;
+    std::string string;
+    std::map<std::string, json_t*> object;
+    std::vector<json_t*> array;
+
+    explicit json_t(Type type) : type(type) {}
+    ~json_t() {
+        for (auto &member : object) {
+            delete member.second;
+        }
+        for (json_t* item : array) {
+            delete item;
+        }
+    }
+};
+
+json_t* json_object() {
+    return new json_t(json_t::OBJECT);
+}
+
+json_t* json_array() {
+    return new json_t(json_t::ARRAY);
+}
+
+json_t* json_boolean(bool value) {
+    return new json_t(value ? json_t::TRUE : json_t::FALSE);
+}
+
+json_t* json_real(double value) {
+    json_t* json = new json_t(json_t::REAL);
+    json->number = value;
+    return json;
+}
+
+json_t* json_integer(long long value) {
+    json_t* json = new json_t(json_t::INTEGER);
+    json->number = static_cast<double>(value);
+    return json;
+}
+
+json_t* json_string(const char* value) {
+    json_t* json = new json_t(json_t::STRING);
+    json->string = value;
+    return json;
+}
+
+json_t* json_true() {
+    return json_boolean(true);
+}
+
+json_t* json_false() {
+    return json_boolean(false);
+}
+
+json_t* json_null() {
+    return new json_t(json_t::NUL);
+}
+
+int json_object_set_new(json_t* object, const char* key, json_t* value) {
+    if (!object || object->type != json_t::OBJECT) {
+        delete value;
+        return -1;
+    }
+    delete object->object[key];
+    object->object[key] = value;
+    return 0;
+}
+
+int json_array_append_new(json_t* array, json_t* value) {
+    if (!array || array->type != json_t::ARRAY) {
+        delete value;
+        return -1;
+    }
+    array->array.push_back(value);
+    return 0;
+}
+
+json_t* json_object_get(const json_t* object, const char* key) {
+    if (!object || object->type != json_t::OBJECT) {
+        return nullptr;
+    }
+    auto it = object->object.find(key);
+    return it == object->object.end() ? nullptr : it->second;
+}
+
+json_t* json_array_get(const json_t* array, size_t index) {
+    if (!array || array->type != json_t::ARRAY || index >= array->array.size()) {
+        return nullptr;
+    }
+    return array->array[index];
+}
+
+size_t json_array_size(const json_t* array) {
+    return (array && array->type == json_t::ARRAY) ? array->array.size() : 0;
+}
+
+bool json_is_true(const json_t* json) {
+    return json && json->type == json_t::TRUE;
+}
+
+bool json_is_array(const json_t* json) {
+    return json && json->type == json_t::ARRAY;
+}
+
+bool json_is_object(const json_t* json) {
+    return json && json->type == json_t::OBJECT;
+}
+
+double json_real_value(const json_t* json) {
+    return (json && json->type == json_t::REAL) ? json->number : 0.0;
+}
+
+double json_number_value(const json_t* json) {
+    return (json && (json->type == json_t::REAL || json->type == json_t::INTEGER)) ? json->number : 0.0;
+}
+
+long long json_integer_value(const json_t* json) {
+    return (json && json->type == json_t::INTEGER) ? static_cast<long long>(json->number) : 0;
+}
+
+const char* json_string_value(const json_t* json) {
+    return (json && json->type == json_t::STRING) ? json->string.c_str() : nullptr;
+}
+
+void json_decref(json_t* json) {
+    delete json;
+}
+
+static void dumpJson(const json_t* json, std::string &out) {
+    switch (json->type) {
+        case json_t::OBJECT: {
+            out += '{';
+            bool first = true;
+            for (const auto &member : json->object) {
+                if (!first) {
+                    out += ',';
+                }
+                first = false;
+                out += '"' + member.first + "\":";
+                dumpJson(member.second, out);
+            }
+            out += '}';
+            break;
+        }
+        case json_t::ARRAY:
+            out += '[';
+            for (size_t i = 0; i < json->array.size(); i++) {
+                if (i > 0) {
+                    out += ',';
+                }
+                dumpJson(json->array[i], out);
+            }
+            out += ']';
+            break;
+        case json_t::STRING:
+            // Plain strings only, like the modules' own data
+            out += '"' + json->string + '"';
+            break;
+        case json_t::INTEGER:
+            out += std::to_string(static_cast<long long>(json->number));
+            break;
+        case json_t::REAL: {
+            // Like jansson, reals always keep a decimal point or exponent
+            char buf[32];
+            std::snprintf(buf, sizeof(buf), "%.17g", json->number);
+            out += buf;
+            if (!std::strpbrk(buf, ".eEn")) {
+                out += ".0";
+            }
+            break;
+        }
+        case json_t::TRUE:
+            out += "true";
+            break;
+        case json_t::FALSE:
+            out += "false";
+            break;
+        case json_t::NUL:
+            out += "null";
+            break;
+    }
+}
+
+char* json_dumps(const json_t* json, size_t flags) {
+    std::string out;
+    dumpJson(json, out);
+    char* text = static_cast<char*>(std::malloc(out.size() + 1));
+    std::memcpy(text, out.c_str(), out.size() + 1);
+    return text;
+}
+
+NVGcolor nvgRGB(unsigned char r, unsigned char g, unsigned char b) {
+    return nvgRGBA(r, g, b, 255);
+}
+
+NVGcolor nvgRGBA(unsigned char r, unsigned char g, unsigned char b, unsigned char a) {
+    NVGcolor color;
+    color.r = r / 255.f;
+    color.g = g / 255.f;
+    color.b = b / 255.f;
+    color.a = a / 255.f;
+    return color;
+}
+
+void nvgBeginPath(NVGcontext* vg) {}
+void nvgRoundedRect(NVGcontext* vg, float x, float y, float w, float h, float r) {}
+void nvgRect(NVGcontext* vg, float x, float y, float w, float h) {}
+void nvgFillColor(NVGcontext* vg, NVGcolor color) {}
+void nvgFill(NVGcontext* vg) {}
+void nvgFontFaceId(NVGcontext* vg, int font) {}
+void nvgFontSize(NVGcontext* vg, float size) {}
+void nvgTextLetterSpacing(NVGcontext* vg, float spacing) {}
+void nvgTextAlign(NVGcontext* vg, int align) {}
+float nvgText(NVGcontext* vg, float x, float y, const char* string, const char* end) {
+    return x;
+}
+
+namespace rack {
+
+const NVGcolor SCHEME_RED = nvgRGB(0xed, 0x2c, 0x24);
+const NVGcolor SCHEME_GREEN = nvgRGB(0x90, 0xc7, 0x3e);
+const NVGcolor SCHEME_BLUE = nvgRGB(0x29, 0xb2, 0xef);
+const NVGcolor SCHEME_YELLOW = nvgRGB(0xf9, 0xdf, 0x1c);
+
+namespace string {
+std::string f(const char* format, ...) {
+    char buf[1024];
+    va_list args;
+    va_start(args, format);
+    std::vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    return buf;
+}
+}
+
+namespace random {
+static std::mt19937 &generator() {
+    static std::mt19937 g(1);
+    return g;
+}
+float uniform() {
+    return std::uniform_real_distribution<float>(0.f, 1.f)(generator());
+}
+float normal() {
+    return std::normal_distribution<float>(0.f, 1.f)(generator());
+}
+uint32_t u32() {
+    return generator()();
+}
+}
+
+namespace system {
+std::string join(const std::string &path1, const std::string &path2) {
+    return path1 + "/" + path2;
+}
+bool createDirectories(const std::string &path) {
+    for (size_t i = 1; i <= path.size(); i++) {
+        if (i == path.size() || path[i] == '/') {
+            mkdir(path.substr(0, i).c_str(), 0755);
+        }
+    }
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+}
+
+namespace settings {
+bool devMode = false;
+}
+
+namespace asset {
+std::string plugin(plugin::Plugin* plugin, const std::string &filename) {
+    return filename;
+}
+std::string userDir;
+std::string user(const std::string &filename) {
+    return userDir.empty() ? filename : system::join(userDir, filename);
+}
+}
+
+namespace history {
+void State::push(Action* action) {
+    delete action;
+}
+void ModuleAdd::setModule(app::ModuleWidget* mw) {}
+void ModuleRemove::setModule(app::ModuleWidget* mw) {}
+void CableAdd::setCable(app::CableWidget* cw) {}
+void CableRemove::setCable(app::CableWidget* cw) {}
+}
+
+// The stub has no rack of module widgets; the tests work on modules
+namespace app {
+void RackWidget::addModule(ModuleWidget* mw) {}
+void RackWidget::removeModule(ModuleWidget* mw) {}
+bool RackWidget::requestModulePos(ModuleWidget* mw, math::Vec pos) {
+    return true;
+}
+void RackWidget::setModulePosNearest(ModuleWidget* mw, math::Vec pos) {}
+ModuleWidget* RackWidget::getModule(int64_t moduleId) {
+    return nullptr;
+}
+std::vector<ModuleWidget*> RackWidget::getModules() {
+    return {};
+}
+void RackWidget::addCable(CableWidget* cw) {}
+CableWidget* RackWidget::getCable(int64_t cableId) {
+    return nullptr;
+}
+}
+
+namespace engine {
+Module::~Module() {
+    for (ParamQuantity* q : paramQuantities) {
+        delete q;
+    }
+    for (PortInfo* info : inputInfos) {
+        delete info;
+    }
+    for (PortInfo* info : outputInfos) {
+        delete info;
+    }
+    for (LightInfo* info : lightInfos) {
+        delete info;
+    }
+}
+
+void Module::config(int numParams, int numInputs, int numOutputs, int numLights) {
+    params.resize(numParams);
+    inputs.resize(numInputs);
+    outputs.resize(numOutputs);
+    lights.resize(numLights);
+    paramQuantities.resize(numParams, nullptr);
+    inputInfos.resize(numInputs, nullptr);
+    outputInfos.resize(numOutputs, nullptr);
+    lightInfos.resize(numLights, nullptr);
+    // Rack configures every param, so do the same for any left out
+    for (int i = 0; i < numParams; i++) {
+        configParam(i, 0.f, 1.f, 0.f);
+    }
+}
+
+PortInfo* Module::configInput(int portId, std::string name) {
+    delete inputInfos[portId];
+    inputInfos[portId] = new PortInfo;
+    inputInfos[portId]->name = name;
+    return inputInfos[portId];
+}
+
+PortInfo* Module::configOutput(int portId, std::string name) {
+    delete outputInfos[portId];
+    outputInfos[portId] = new PortInfo;
+    outputInfos[portId]->name = name;
+    return outputInfos[portId];
+}
+
+LightInfo* Module::configLight(int lightId, std::string name) {
+    delete lightInfos[lightId];
+    lightInfos[lightId] = new LightInfo;
+    lightInfos[lightId]->name = name;
+    return lightInfos[lightId];
+}
+} // namespace engine
+
+namespace widget {
+Widget::~Widget() {
+    clearChildren();
+}
+
+void Widget::addChild(Widget* child) {
+    child->parent = this;
+    children.push_back(child);
+}
+
+void Widget::removeChild(Widget* child) {
+    child->parent = nullptr;
+    children.remove(child);
+}
+
+void Widget::clearChildren() {
+    for (Widget* child : children) {
+        delete child;
+    }
+    children.clear();
+}
+} // namespace widget
+
+namespace plugin {
+static std::map<std::string, Model*> &models() {
+    // Filled from the modules' static initializers, so it can't be a plain
+    // global
+    static std::map<std::string, Model*> registry;
+    return registry;
+}
+
+void registerModel(Model* model) {
+    models()[model->slug] = model;
+}
+
+Model* getModel(const std::string &pluginSlug, const std::string &slug) {
+    auto it = models().find(slug);
+    return it == models().end() ? nullptr : it->second;
+}
+} // namespace plugin
+
+std::shared_ptr<Font> Window::loadFont(const std::string &filename) {
+    return std::make_shared<Font>();
+}
+
+std::shared_ptr<Svg> Window::loadSvg(const std::string &filename) {
+    return std::make_shared<Svg>();
+}
+
+Context* contextGet() {
+    static engine::Engine engine;
+    static app::Scene scene;
+    static history::State history;
+    static Window window;
+    static Context context;
+    context.engine = &engine;
+    context.scene = &scene;
+    context.history = &history;
+    context.window = &window;
+    return &context;
+}
+
+} // namespace rack
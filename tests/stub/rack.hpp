@@ -0,0 +1,1195 @@
+#pragma once
+
+/**
+ * Minimal stand-in for the VCV Rack 2 SDK, for running modules headless in
+ * the tests
+ *
+ * Only the parts of the API the modules under test touch are declared. The
+ * engine side (ports, params, expanders, config*) behaves like Rack's; the
+ * UI side compiles but does nothing, and model widgets are never created.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define DEPRECATED
+#define WARN(...) ((void)0)
+#define INFO(...) ((void)0)
+#define DEBUG(...) ((void)0)
+#define ENUMS(name, count) name, name ## _LAST = name + (count) - 1
+#define GLFW_RELEASE 0
+#define GLFW_PRESS 1
+#define GLFW_MOUSE_BUTTON_LEFT 0
+#define GLFW_MOD_SHIFT 1
+#define GLFW_MOD_CONTROL 2
+#define RACK_MOD_CTRL 2
+#define RACK_MOD_MASK 15
+
+// jansson: values are kept, but only well enough for dataToJson/dataFromJson
+// round trips of objects with scalar members
+struct json_t;
+json_t* json_object();
+json_t* json_array();
+json_t* json_boolean(bool value);
+json_t* json_real(double value);
+json_t* json_integer(long long value);
+json_t* json_string(const char* value);
+json_t* json_true();
+json_t* json_false();
+json_t* json_null();
+int json_object_set_new(json_t* object, const char* key, json_t* value);
+int json_array_append_new(json_t* array, json_t* value);
+json_t* json_object_get(const json_t* object, const char* key);
+json_t* json_array_get(const json_t* array, size_t index);
+size_t json_array_size(const json_t* array);
+bool json_is_true(const json_t* json);
+bool json_is_array(const json_t* json);
+bool json_is_object(const json_t* json);
+double json_real_value(const json_t* json);
+double json_number_value(const json_t* json);
+long long json_integer_value(const json_t* json);
+const char* json_string_value(const json_t* json);
+void json_decref(json_t* json);
+// Returns text to free() with std::free
+char* json_dumps(const json_t* json, size_t flags);
+#define JSON_COMPACT 0x20
+#define json_array_foreach(array, index, value) \
+    for (index = 0; index < json_array_size(array) && (value = json_array_get(array, index)); index++)
+
+// nanovg
+struct NVGcolor {
+    float r, g, b, a;
+};
+struct NVGcontext;
+NVGcolor nvgRGB(unsigned char r, unsigned char g, unsigned char b);
+NVGcolor nvgRGBA(unsigned char r, unsigned char g, unsigned char b, unsigned char a);
+void nvgBeginPath(NVGcontext* vg);
+void nvgRoundedRect(NVGcontext* vg, float x, float y, float w, float h, float r);
+void nvgRect(NVGcontext* vg, float x, float y, float w, float h);
+void nvgFillColor(NVGcontext* vg, NVGcolor color);
+void nvgFill(NVGcontext* vg);
+void nvgFontFaceId(NVGcontext* vg, int font);
+void nvgFontSize(NVGcontext* vg, float size);
+void nvgTextLetterSpacing(NVGcontext* vg, float spacing);
+void nvgTextAlign(NVGcontext* vg, int align);
+float nvgText(NVGcontext* vg, float x, float y, const char* string, const char* end);
+#define NVG_ALIGN_LEFT 1
+#define NVG_ALIGN_CENTER 2
+
+namespace rack {
+
+namespace plugin {
+struct Model;
+struct Plugin;
+}
+namespace app {
+struct ModuleWidget;
+struct CableWidget;
+}
+
+namespace math {
+inline float clamp(float x, float a = 0.f, float b = 1.f) {
+    return std::fmax(std::fmin(x, b), a);
+}
+inline int clamp(int x, int a, int b) {
+    return std::max(std::min(x, b), a);
+}
+template <typename T>
+T log2(T x) {
+    return std::log2(x);
+}
+inline int log2(int n) {
+    int i = 0;
+    while (n >>= 1) {
+        i++;
+    }
+    return i;
+}
+inline float rescale(float x, float xMin, float xMax, float yMin, float yMax) {
+    return yMin + (x - xMin) / (xMax - xMin) * (yMax - yMin);
+}
+inline float crossfade(float a, float b, float p) {
+    return a + (b - a) * p;
+}
+inline bool isNear(float a, float b, float epsilon = 1e-6f) {
+    return std::fabs(a - b) <= epsilon;
+}
+
+struct Vec {
+    float x = 0.f;
+    float y = 0.f;
+    Vec() {}
+    Vec(float x, float y) : x(x), y(y) {}
+    Vec plus(Vec b) const {
+        return Vec(x + b.x, y + b.y);
+    }
+    Vec minus(Vec b) const {
+        return Vec(x - b.x, y - b.y);
+    }
+    Vec mult(float s) const {
+        return Vec(x * s, y * s);
+    }
+    Vec div(float s) const {
+        return Vec(x / s, y / s);
+    }
+    bool equals(Vec b) const {
+        return x == b.x && y == b.y;
+    }
+    bool isZero() const {
+        return x == 0.f && y == 0.f;
+    }
+};
+
+struct Rect {
+    Vec pos;
+    Vec size;
+    Rect() {}
+    Rect(Vec pos, Vec size) : pos(pos), size(size) {}
+    float getLeft() const {
+        return pos.x;
+    }
+    float getRight() const {
+        return pos.x + size.x;
+    }
+    float getTop() const {
+        return pos.y;
+    }
+    float getBottom() const {
+        return pos.y + size.y;
+    }
+    Vec getTopRight() const {
+        return Vec(getRight(), pos.y);
+    }
+};
+} // namespace math
+using namespace math;
+
+namespace string {
+std::string f(const char* format, ...);
+}
+
+namespace random {
+float uniform();
+float normal();
+uint32_t u32();
+}
+
+namespace system {
+double getTime();
+int64_t getNanoseconds();
+std::string join(const std::string &path1, const std::string &path2);
+bool createDirectories(const std::string &path);
+}
+
+namespace asset {
+// Where user() files go; empty for the working directory
+extern std::string userDir;
+std::string plugin(plugin::Plugin* plugin, const std::string &filename);
+std::string user(const std::string &filename);
+}
+
+namespace dsp {
+inline float amplitudeToDb(float amp) {
+    return 20.f * std::log10(amp);
+}
+inline float dbToAmplitude(float db) {
+    return std::pow(10.f, db / 20.f);
+}
+
+struct ClockDivider {
+    uint32_t clock = 0;
+    uint32_t division = 1;
+    void reset() {
+        clock = 0;
+    }
+    void setDivision(uint32_t division) {
+        this->division = division;
+    }
+    uint32_t getDivision() {
+        return division;
+    }
+    uint32_t getClock() {
+        return clock;
+    }
+    bool process() {
+        if (++clock >= division) {
+            clock = 0;
+            return true;
+        }
+        return false;
+    }
+};
+
+template <typename T = float>
+struct TSchmittTrigger {
+    bool state = true;
+    void reset() {
+        state = true;
+    }
+    bool process(T in, T lowThreshold = 0.f, T highThreshold = 1.f) {
+        if (state) {
+            if (in <= lowThreshold) {
+                state = false;
+            }
+        } else if (in >= highThreshold) {
+            state = true;
+            return true;
+        }
+        return false;
+    }
+    bool isHigh() {
+        return state;
+    }
+};
+typedef TSchmittTrigger<> SchmittTrigger;
+
+struct BooleanTrigger {
+    bool state = true;
+    bool process(bool s) {
+        const bool triggered = s && !state;
+        state = s;
+        return triggered;
+    }
+};
+
+struct PulseGenerator {
+    float remaining = 0.f;
+    void trigger(float duration = 1e-3f) {
+        remaining = std::max(remaining, duration);
+    }
+    bool process(float deltaTime) {
+        if (remaining > 0.f) {
+            remaining -= deltaTime;
+            return true;
+        }
+        return false;
+    }
+};
+
+struct VuMeter2 {
+    enum Mode {
+        PEAK,
+        RMS
+    };
+    Mode mode = PEAK;
+    float v = 0.f;
+    float lambda = 30.f;
+    void reset() {
+        v = 0.f;
+    }
+    void process(float deltaTime, float value) {
+        v = std::fmax(std::fabs(value), v - v * lambda * deltaTime);
+    }
+    float getBrightness(float dbMin, float dbMax) {
+        const float db = amplitudeToDb(v);
+        return clamp(rescale(db, dbMin, dbMax, 0.f, 1.f), 0.f, 1.f);
+    }
+};
+} // namespace dsp
+
+namespace history {
+struct Action {
+    std::string name;
+    virtual ~Action() {}
+    virtual void undo() {}
+    virtual void redo() {}
+};
+struct ModuleAction : Action {
+    int64_t moduleId = -1;
+};
+struct ModuleAdd : ModuleAction {
+    plugin::Model* model = nullptr;
+    math::Vec pos;
+    json_t* moduleJ = nullptr;
+    void setModule(app::ModuleWidget* mw);
+};
+struct ModuleRemove : ModuleAction {
+    void setModule(app::ModuleWidget* mw);
+};
+struct ParamChange : ModuleAction {
+    int paramId = -1;
+    float oldValue = 0.f;
+    float newValue = 0.f;
+};
+struct ModuleChange : ModuleAction {
+    json_t* oldModuleJ = nullptr;
+    json_t* newModuleJ = nullptr;
+};
+struct CableAdd : Action {
+    void setCable(app::CableWidget* cw);
+};
+struct CableRemove : Action {
+    void setCable(app::CableWidget* cw);
+};
+struct ComplexAction : Action {
+    std::vector<Action*> actions;
+    ~ComplexAction() {
+        for (Action* action : actions) {
+            delete action;
+        }
+    }
+    void push(Action* action) {
+        actions.push_back(action);
+    }
+    bool isEmpty() {
+        return actions.empty();
+    }
+};
+struct State {
+    void push(Action* action);
+};
+} // namespace history
+
+namespace engine {
+struct Module;
+
+struct Port {
+    union {
+        float voltages[16] = {};
+        float value;
+    };
+    uint8_t channels = 0;
+
+    float getVoltage(int channel = 0) {
+        return voltages[channel];
+    }
+    void setVoltage(float voltage, int channel = 0) {
+        voltages[channel] = voltage;
+    }
+    float getPolyVoltage(int channel) {
+        return isMonophonic() ? getVoltage(0) : getVoltage(channel);
+    }
+    float getNormalVoltage(float normalVoltage, int channel = 0) {
+        return isConnected() ? getVoltage(channel) : normalVoltage;
+    }
+    float getNormalPolyVoltage(float normalVoltage, int channel) {
+        return isConnected() ? getPolyVoltage(channel) : normalVoltage;
+    }
+    float* getVoltages(int firstChannel = 0) {
+        return &voltages[firstChannel];
+    }
+    void readVoltages(float* v) {
+        for (int c = 0; c < channels; c++) {
+            v[c] = voltages[c];
+        }
+    }
+    void writeVoltages(const float* v) {
+        for (int c = 0; c < channels; c++) {
+            voltages[c] = v[c];
+        }
+    }
+    void clearVoltages() {
+        for (int c = 0; c < 16; c++) {
+            voltages[c] = 0.f;
+        }
+    }
+    float getVoltageSum() {
+        float sum = 0.f;
+        for (int c = 0; c < channels; c++) {
+            sum += voltages[c];
+        }
+        return sum;
+    }
+    int getChannels() {
+        return channels;
+    }
+    bool isConnected() {
+        return channels > 0;
+    }
+    bool isMonophonic() {
+        return channels == 1;
+    }
+    bool isPolyphonic() {
+        return channels > 1;
+    }
+    /**
+     * Like Rack, a disconnected port stays at 0 channels and a connected one
+     * never drops below 1; channels above the new count are zeroed
+     */
+    void setChannels(int channels) {
+        if (this->channels == 0) {
+            return;
+        }
+        for (int c = channels; c < this->channels; c++) {
+            voltages[c] = 0.f;
+        }
+        this->channels = std::max(channels, 1);
+    }
+};
+struct Output : Port {};
+struct Input : Port {};
+
+struct Param {
+    float value = 0.f;
+    float getValue() {
+        return value;
+    }
+    void setValue(float value) {
+        this->value = value;
+    }
+};
+
+struct Light {
+    float value = 0.f;
+    void setBrightness(float brightness) {
+        value = brightness;
+    }
+    float getBrightness() {
+        return value;
+    }
+    void setBrightnessSmooth(float brightness, float deltaTime, float lambda = 30.f) {
+        value = brightness;
+    }
+    void setSmoothBrightness(float brightness, float deltaTime) {
+        value = brightness;
+    }
+};
+
+struct ParamQuantity;
+
+struct PortInfo {
+    std::string name;
+    std::string description;
+};
+
+struct LightInfo {
+    std::string name;
+};
+
+struct Module {
+    plugin::Model* model = nullptr;
+    int64_t id = -1;
+    std::vector<Param> params;
+    std::vector<Input> inputs;
+    std::vector<Output> outputs;
+    std::vector<Light> lights;
+    std::vector<ParamQuantity*> paramQuantities;
+    std::vector<PortInfo*> inputInfos;
+    std::vector<PortInfo*> outputInfos;
+    std::vector<LightInfo*> lightInfos;
+
+    struct Expander {
+        int64_t moduleId = -1;
+        Module* module = nullptr;
+        void* producerMessage = nullptr;
+        void* consumerMessage = nullptr;
+        bool messageFlipRequested = false;
+        void requestMessageFlip() {
+            messageFlipRequested = true;
+        }
+    };
+    Expander leftExpander;
+    Expander rightExpander;
+
+    struct ProcessArgs {
+        float sampleRate;
+        float sampleTime;
+        int64_t frame;
+    };
+    struct SampleRateChangeEvent {
+        float sampleRate;
+        float sampleTime;
+    };
+    struct ResetEvent {};
+    struct AddEvent {};
+    struct RemoveEvent {};
+    struct ExpanderChangeEvent {
+        int side;
+    };
+    struct PortChangeEvent {
+        bool connecting;
+        int type;
+        int portId;
+    };
+
+    Module() {}
+    virtual ~Module();
+
+    void config(int numParams, int numInputs, int numOutputs, int numLights = 0);
+
+    template <class TParamQuantity = ParamQuantity>
+    TParamQuantity* configParam(int paramId, float minValue, float maxValue, float defaultValue, std::string name = "",
+                                std::string unit = "", float displayBase = 0.f, float displayMultiplier = 1.f,
+                                float displayOffset = 0.f);
+    template <class TSwitchQuantity = ParamQuantity>
+    TSwitchQuantity* configSwitch(int paramId, float minValue, float maxValue, float defaultValue, std::string name = "",
+                                  std::vector<std::string> labels = {}) {
+        return configParam<TSwitchQuantity>(paramId, minValue, maxValue, defaultValue, name);
+    }
+    template <class TParamQuantity = ParamQuantity>
+    TParamQuantity* configButton(int paramId, std::string name = "") {
+        return configParam<TParamQuantity>(paramId, 0.f, 1.f, 0.f, name);
+    }
+    PortInfo* configInput(int portId, std::string name = "");
+    PortInfo* configOutput(int portId, std::string name = "");
+    LightInfo* configLight(int lightId, std::string name = "");
+    void configBypass(int inputId, int outputId) {}
+
+    Expander &getLeftExpander() {
+        return leftExpander;
+    }
+    Expander &getRightExpander() {
+        return rightExpander;
+    }
+    Expander &getExpander(uint8_t side) {
+        return side ? rightExpander : leftExpander;
+    }
+    int getNumParams() {
+        return params.size();
+    }
+    int getNumInputs() {
+        return inputs.size();
+    }
+    int getNumOutputs() {
+        return outputs.size();
+    }
+    int64_t getId() {
+        return id;
+    }
+    plugin::Model* getModel() {
+        return model;
+    }
+    Param &getParam(int index) {
+        return params[index];
+    }
+    Input &getInput(int index) {
+        return inputs[index];
+    }
+    Output &getOutput(int index) {
+        return outputs[index];
+    }
+    ParamQuantity* getParamQuantity(int index) {
+        return paramQuantities[index];
+    }
+
+    virtual void process(const ProcessArgs &args) {}
+    virtual json_t* dataToJson() {
+        return nullptr;
+    }
+    virtual void dataFromJson(json_t* rootJ) {}
+    virtual void onAdd(const AddEvent &e) {
+        onAdd();
+    }
+    virtual void onRemove(const RemoveEvent &e) {
+        onRemove();
+    }
+    virtual void onPortChange(const PortChangeEvent &e) {}
+    virtual void onSampleRateChange(const SampleRateChangeEvent &e) {
+        onSampleRateChange();
+    }
+    virtual void onExpanderChange(const ExpanderChangeEvent &e) {}
+    virtual void onReset(const ResetEvent &e) {
+        onReset();
+    }
+    virtual void onAdd() {}
+    virtual void onRemove() {}
+    virtual void onReset() {}
+    virtual void onRandomize() {}
+    virtual void onSampleRateChange() {}
+};
+
+/**
+ * The stub engine only holds the sample rate; tests step modules and flip
+ * expander messages themselves
+ */
+struct Cable {
+    int64_t id = -1;
+    Module* inputModule = nullptr;
+    int inputId = -1;
+    Module* outputModule = nullptr;
+    int outputId = -1;
+};
+
+struct Engine {
+    float sampleRate = 44100.f;
+
+    float getSampleRate() {
+        return sampleRate;
+    }
+    float getSampleTime() {
+        return 1.f / sampleRate;
+    }
+    void addModule(Module* module) {}
+    void removeModule(Module* module) {}
+    Module* getModule(int64_t moduleId) {
+        return nullptr;
+    }
+    std::vector<int64_t> getCableIds() {
+        return {};
+    }
+    Cable* getCable(int64_t cableId) {
+        return nullptr;
+    }
+    void addCable(Cable* cable) {}
+};
+} // namespace engine
+
+using engine::Module;
+using engine::Input;
+using engine::Output;
+using engine::Param;
+using engine::Light;
+using engine::Cable;
+
+namespace widget {
+struct Widget {
+    math::Rect box;
+    Widget* parent = nullptr;
+    std::list<Widget*> children;
+    bool visible = true;
+
+    virtual ~Widget();
+    void addChild(Widget* child);
+    void removeChild(Widget* child);
+    void clearChildren();
+    void show() {
+        visible = true;
+    }
+    void hide() {
+        visible = false;
+    }
+    void setSize(math::Vec size) {
+        box.size = size;
+    }
+    void setPosition(math::Vec pos) {
+        box.pos = pos;
+    }
+    math::Vec getPosition() {
+        return box.pos;
+    }
+    math::Vec getSize() {
+        return box.size;
+    }
+
+    struct DrawArgs {
+        NVGcontext* vg;
+        math::Rect clipBox;
+    };
+    struct BaseEvent {
+        mutable bool consumed = false;
+        void consume(Widget* w) const {
+            consumed = true;
+        }
+    };
+    struct PositionBaseEvent {
+        math::Vec pos;
+    };
+    struct KeyBaseEvent {
+        int key;
+        int scancode;
+        std::string keyName;
+        int action;
+        int mods;
+    };
+    struct HoverKeyEvent : BaseEvent, PositionBaseEvent, KeyBaseEvent {};
+    struct SelectKeyEvent : BaseEvent, KeyBaseEvent {};
+    struct ButtonEvent : BaseEvent, PositionBaseEvent {
+        int button;
+        int action;
+        int mods;
+    };
+    struct DragBaseEvent : BaseEvent {
+        int button;
+    };
+    struct DragStartEvent : DragBaseEvent {};
+    struct DragEndEvent : DragBaseEvent {};
+    struct DragMoveEvent : DragBaseEvent {
+        math::Vec mouseDelta;
+    };
+    struct ActionEvent : BaseEvent {};
+    struct ChangeEvent : BaseEvent {};
+
+    virtual void step() {}
+    virtual void draw(const DrawArgs &args) {}
+    virtual void drawLayer(const DrawArgs &args, int layer) {}
+    virtual void onHoverKey(const HoverKeyEvent &e) {}
+    virtual void onButton(const ButtonEvent &e) {}
+    virtual void onDragStart(const DragStartEvent &e) {}
+    virtual void onDragEnd(const DragEndEvent &e) {}
+    virtual void onDragMove(const DragMoveEvent &e) {}
+    virtual void onAction(const ActionEvent &e) {}
+    virtual void onChange(const ChangeEvent &e) {}
+};
+struct OpaqueWidget : Widget {};
+struct TransparentWidget : Widget {};
+} // namespace widget
+using widget::Widget;
+
+struct Quantity {
+    virtual ~Quantity() {}
+    virtual void setValue(float value) {}
+    virtual float getValue() {
+        return 0.f;
+    }
+    virtual float getMinValue() {
+        return 0.f;
+    }
+    virtual float getMaxValue() {
+        return 1.f;
+    }
+    virtual float getDefaultValue() {
+        return 0.f;
+    }
+    virtual float getDisplayValue() {
+        return getValue();
+    }
+    virtual void setDisplayValue(float displayValue) {
+        setValue(displayValue);
+    }
+    virtual int getDisplayPrecision() {
+        return 5;
+    }
+    virtual std::string getDisplayValueString() {
+        return "";
+    }
+    virtual std::string getLabel() {
+        return "";
+    }
+    virtual std::string getUnit() {
+        return "";
+    }
+    virtual std::string getString() {
+        return "";
+    }
+    virtual void reset() {}
+    virtual void randomize() {}
+};
+
+namespace engine {
+struct ParamQuantity : Quantity {
+    Module* module = nullptr;
+    int paramId = -1;
+    float minValue = 0.f;
+    float maxValue = 1.f;
+    float defaultValue = 0.f;
+    std::string name;
+    std::string unit;
+    std::string description;
+    bool snapEnabled = false;
+    bool randomizeEnabled = true;
+    bool smoothEnabled = false;
+    float displayBase = 0.f;
+    float displayMultiplier = 1.f;
+    float displayOffset = 0.f;
+
+    Param* getParam() {
+        return &module->params[paramId];
+    }
+    void setValue(float value) override {
+        getParam()->setValue(math::clamp(value, minValue, maxValue));
+    }
+    float getValue() override {
+        return getParam()->getValue();
+    }
+    float getMinValue() override {
+        return minValue;
+    }
+    float getMaxValue() override {
+        return maxValue;
+    }
+    float getDefaultValue() override {
+        return defaultValue;
+    }
+    void setImmediateValue(float value) {
+        setValue(value);
+    }
+    float getImmediateValue() {
+        return getValue();
+    }
+};
+struct SwitchQuantity : ParamQuantity {
+    std::vector<std::string> labels;
+};
+
+template <class TParamQuantity>
+TParamQuantity* Module::configParam(int paramId, float minValue, float maxValue, float defaultValue, std::string name,
+                                    std::string unit, float displayBase, float displayMultiplier, float displayOffset) {
+    delete paramQuantities[paramId];
+
+    TParamQuantity* q = new TParamQuantity;
+    q->module = this;
+    q->paramId = paramId;
+    q->minValue = minValue;
+    q->maxValue = maxValue;
+    q->defaultValue = defaultValue;
+    q->name = name;
+    q->unit = unit;
+    q->displayBase = displayBase;
+    q->displayMultiplier = displayMultiplier;
+    q->displayOffset = displayOffset;
+    paramQuantities[paramId] = q;
+
+    params[paramId].value = defaultValue;
+    return q;
+}
+} // namespace engine
+using engine::ParamQuantity;
+
+namespace ui {
+struct MenuEntry : widget::OpaqueWidget {};
+struct MenuItem : MenuEntry {
+    std::string text;
+    std::string rightText;
+    bool disabled = false;
+    virtual ui::MenuEntry* createChildMenu() {
+        return nullptr;
+    }
+};
+struct MenuSeparator : MenuEntry {};
+struct MenuLabel : MenuEntry {
+    std::string text;
+};
+struct Menu : widget::OpaqueWidget {};
+struct Slider : widget::OpaqueWidget {
+    Quantity* quantity = nullptr;
+};
+struct TextField : widget::OpaqueWidget {
+    std::string text;
+    std::string placeholder;
+    bool multiline = false;
+    std::string getText() {
+        return text;
+    }
+    void setText(const std::string &text) {
+        this->text = text;
+    }
+    void selectAll() {}
+};
+struct Label : widget::Widget {
+    std::string text;
+};
+} // namespace ui
+using namespace ui;
+
+namespace settings {
+extern bool devMode;
+}
+
+namespace plugin {
+/**
+ * Look up a model created with createModel() by slug; the plugin slug is
+ * ignored since the tests only load one plugin
+ */
+Model* getModel(const std::string &pluginSlug, const std::string &slug);
+
+struct Plugin {
+    std::string slug;
+    std::string path;
+    void addModel(Model* model) {}
+};
+
+struct Model {
+    std::string slug;
+    std::string name;
+    Plugin* plugin = nullptr;
+    virtual ~Model() {}
+    virtual engine::Module* createModule() = 0;
+    virtual app::ModuleWidget* createModuleWidget(engine::Module* m) = 0;
+};
+
+void registerModel(Model* model);
+} // namespace plugin
+using plugin::Plugin;
+using plugin::Model;
+
+struct Svg {};
+struct Font {
+    int handle = -1;
+};
+
+namespace app {
+struct ParamWidget : widget::OpaqueWidget {
+    engine::Module* module = nullptr;
+    int paramId = -1;
+    ParamQuantity* getParamQuantity() {
+        return module ? module->paramQuantities[paramId] : nullptr;
+    }
+};
+struct Knob : ParamWidget {};
+struct SvgKnob : Knob {};
+struct SliderKnob : Knob {};
+struct SvgSlider : SliderKnob {};
+struct Switch : ParamWidget {
+    bool momentary = false;
+};
+struct SvgSwitch : Switch {};
+struct PortWidget : widget::OpaqueWidget {
+    engine::Module* module = nullptr;
+    int portId = -1;
+    int type = 0;
+};
+struct SvgPort : PortWidget {};
+struct LightWidget : widget::TransparentWidget {
+    NVGcolor color;
+    NVGcolor bgColor;
+    NVGcolor borderColor;
+};
+struct MultiLightWidget : LightWidget {
+    void addBaseColor(NVGcolor baseColor);
+};
+struct ModuleLightWidget : MultiLightWidget {
+    engine::Module* module = nullptr;
+    int firstLightId = -1;
+};
+struct LedDisplay : widget::Widget {};
+struct SvgScrew : widget::Widget {};
+struct SvgPanel : widget::Widget {};
+struct ThemedSvgPanel : SvgPanel {};
+struct CableWidget : widget::OpaqueWidget {
+    NVGcolor color;
+    engine::Cable* cable = nullptr;
+    void setCable(engine::Cable* cable) {
+        this->cable = cable;
+    }
+};
+
+struct ModuleWidget : widget::OpaqueWidget {
+    plugin::Model* model = nullptr;
+    engine::Module* module = nullptr;
+
+    void setModule(engine::Module* module) {
+        this->module = module;
+    }
+    engine::Module* getModule() {
+        return module;
+    }
+    template <class TModule>
+    TModule* getModule() {
+        return dynamic_cast<TModule*>(module);
+    }
+    void setPanel(widget::Widget* panel);
+    void setPanel(std::shared_ptr<Svg> svg);
+    void addParam(ParamWidget* param);
+    void addInput(PortWidget* input);
+    void addOutput(PortWidget* output);
+    virtual void appendContextMenu(ui::Menu* menu) {}
+    void appendDisconnectActions(history::ComplexAction* complexAction) {}
+    json_t* toJson();
+    void fromJson(json_t* moduleJ);
+};
+
+struct RackWidget : widget::OpaqueWidget {
+    void addModule(ModuleWidget* mw);
+    void removeModule(ModuleWidget* mw);
+    void updateModuleOldPositions();
+    history::ComplexAction* getModuleDragAction();
+    bool requestModulePos(ModuleWidget* mw, math::Vec pos);
+    void setModulePosNearest(ModuleWidget* mw, math::Vec pos);
+    void setModulePosForce(ModuleWidget* mw, math::Vec pos);
+    ModuleWidget* getModule(int64_t moduleId);
+    std::vector<ModuleWidget*> getModules();
+    void addCable(CableWidget* cw);
+    CableWidget* getCable(int64_t cableId);
+};
+
+struct Scene : widget::OpaqueWidget {
+    RackWidget* rack = nullptr;
+};
+} // namespace app
+using namespace app;
+
+struct Window {
+    std::shared_ptr<Font> loadFont(const std::string &filename);
+    std::shared_ptr<Svg> loadSvg(const std::string &filename);
+};
+
+struct Context {
+    engine::Engine* engine = nullptr;
+    app::Scene* scene = nullptr;
+    history::State* history = nullptr;
+    Window* window = nullptr;
+};
+Context* contextGet();
+#define APP rack::contextGet()
+
+// Component library
+struct ThemedScrew : app::SvgScrew {};
+struct ThemedPJ301MPort : app::SvgPort {};
+struct RoundSmallBlackKnob : app::SvgKnob {};
+struct RoundBlackKnob : app::SvgKnob {};
+struct RoundLargeBlackKnob : app::SvgKnob {};
+struct RoundBlackSnapKnob : RoundBlackKnob {};
+struct Trimpot : app::SvgKnob {};
+struct LEDSliderGreen : app::SvgSlider {};
+struct CKSS : app::SvgSwitch {};
+struct CKSSThree : app::SvgSwitch {};
+struct LEDButton : app::SvgSwitch {};
+struct VCVButton : app::SvgSwitch {};
+struct TL1105 : app::SvgSwitch {};
+struct VCVLatch : VCVButton {};
+template <typename TLight>
+struct VCVLightLatch : VCVLatch {
+    app::ModuleLightWidget* light = nullptr;
+    app::ModuleLightWidget* getLight() {
+        return light;
+    }
+};
+template <typename TLight>
+struct VCVLightButton : VCVButton {
+    app::ModuleLightWidget* light = nullptr;
+    app::ModuleLightWidget* getLight() {
+        return light;
+    }
+};
+struct GrayModuleLightWidget : app::ModuleLightWidget {};
+template <typename TBase = GrayModuleLightWidget>
+struct TRedLight : TBase {};
+typedef TRedLight<> RedLight;
+template <typename TBase = GrayModuleLightWidget>
+struct TGreenLight : TBase {};
+typedef TGreenLight<> GreenLight;
+template <typename TBase = GrayModuleLightWidget>
+struct TYellowLight : TBase {};
+typedef TYellowLight<> YellowLight;
+template <typename TBase = GrayModuleLightWidget>
+struct TBlueLight : TBase {};
+typedef TBlueLight<> BlueLight;
+template <typename TBase = GrayModuleLightWidget>
+struct TWhiteLight : TBase {};
+typedef TWhiteLight<> WhiteLight;
+template <typename TBase>
+struct TinyLight : TBase {};
+template <typename TBase>
+struct SmallLight : TBase {};
+template <typename TBase>
+struct MediumLight : TBase {};
+template <typename TBase>
+struct MediumSimpleLight : TBase {};
+template <typename TBase>
+struct VCVSliderLight : TBase {};
+extern const NVGcolor SCHEME_RED;
+extern const NVGcolor SCHEME_GREEN;
+extern const NVGcolor SCHEME_BLUE;
+extern const NVGcolor SCHEME_YELLOW;
+
+constexpr float RACK_GRID_WIDTH = 15;
+constexpr float RACK_GRID_HEIGHT = 380;
+static const math::Vec RACK_GRID_SIZE = math::Vec(RACK_GRID_WIDTH, RACK_GRID_HEIGHT);
+
+/**
+ * Models create their module as in Rack; widgets need a window, so none are
+ * created
+ */
+template <class TModule, class TModuleWidget>
+plugin::Model* createModel(std::string slug) {
+    struct TModel : plugin::Model {
+        engine::Module* createModule() override {
+            engine::Module* m = new TModule;
+            m->model = this;
+            return m;
+        }
+        app::ModuleWidget* createModuleWidget(engine::Module* m) override {
+            return nullptr;
+        }
+    };
+
+    TModel* model = new TModel;
+    model->slug = slug;
+    plugin::registerModel(model);
+    return model;
+}
+
+template <class TWidget>
+TWidget* createWidget(math::Vec pos) {
+    TWidget* w = new TWidget;
+    w->box.pos = pos;
+    return w;
+}
+template <class TWidget>
+TWidget* createWidgetCentered(math::Vec pos) {
+    return createWidget<TWidget>(pos);
+}
+ThemedSvgPanel* createPanel(std::string lightSvgPath, std::string darkSvgPath);
+SvgPanel* createPanel(std::string svgPath);
+template <class TParamWidget>
+TParamWidget* createParam(math::Vec pos, engine::Module* module, int paramId) {
+    TParamWidget* w = createWidget<TParamWidget>(pos);
+    w->module = module;
+    w->paramId = paramId;
+    return w;
+}
+template <class TParamWidget>
+TParamWidget* createParamCentered(math::Vec pos, engine::Module* module, int paramId) {
+    return createParam<TParamWidget>(pos, module, paramId);
+}
+template <class TParamWidget>
+TParamWidget* createLightParam(math::Vec pos, engine::Module* module, int paramId, int firstLightId) {
+    return createParam<TParamWidget>(pos, module, paramId);
+}
+template <class TParamWidget>
+TParamWidget* createLightParamCentered(math::Vec pos, engine::Module* module, int paramId, int firstLightId) {
+    return createParam<TParamWidget>(pos, module, paramId);
+}
+template <class TPortWidget>
+TPortWidget* createInput(math::Vec pos, engine::Module* module, int inputId) {
+    TPortWidget* w = createWidget<TPortWidget>(pos);
+    w->module = module;
+    w->portId = inputId;
+    return w;
+}
+template <class TPortWidget>
+TPortWidget* createInputCentered(math::Vec pos, engine::Module* module, int inputId) {
+    return createInput<TPortWidget>(pos, module, inputId);
+}
+template <class TPortWidget>
+TPortWidget* createOutput(math::Vec pos, engine::Module* module, int outputId) {
+    return createInput<TPortWidget>(pos, module, outputId);
+}
+template <class TPortWidget>
+TPortWidget* createOutputCentered(math::Vec pos, engine::Module* module, int outputId) {
+    return createInput<TPortWidget>(pos, module, outputId);
+}
+template <class TModuleLightWidget>
+TModuleLightWidget* createLight(math::Vec pos, engine::Module* module, int firstLightId) {
+    TModuleLightWidget* w = createWidget<TModuleLightWidget>(pos);
+    w->module = module;
+    w->firstLightId = firstLightId;
+    return w;
+}
+template <class TModuleLightWidget>
+TModuleLightWidget* createLightCentered(math::Vec pos, engine::Module* module, int firstLightId) {
+    return createLight<TModuleLightWidget>(pos, module, firstLightId);
+}
+template <class TMenuLabel = ui::MenuLabel>
+TMenuLabel* createMenuLabel(std::string text) {
+    TMenuLabel* label = new TMenuLabel;
+    label->text = text;
+    return label;
+}
+template <class TMenuItem = ui::MenuItem>
+TMenuItem* createMenuItem(std::string text, std::string rightText = "", std::function<void()> action = nullptr,
+                          bool disabled = false, bool alwaysConsume = false) {
+    TMenuItem* item = new TMenuItem;
+    item->text = text;
+    item->rightText = rightText;
+    item->disabled = disabled;
+    return item;
+}
+ui::MenuItem* createCheckMenuItem(std::string text, std::string rightText, std::function<bool()> checked,
+                                  std::function<void()> action, bool disabled = false, bool alwaysConsume = false);
+ui::MenuItem* createBoolMenuItem(std::string text, std::string rightText, std::function<bool()> getter,
+                                 std::function<void(bool)> setter, bool disabled = false, bool alwaysConsume = false);
+template <typename T>
+ui::MenuItem* createBoolPtrMenuItem(std::string text, std::string rightText, T* ptr) {
+    return createMenuItem(text, rightText);
+}
+ui::MenuItem* createSubmenuItem(std::string text, std::string rightText, std::function<void(ui::Menu* menu)> createMenu,
+                                bool disabled = false);
+ui::MenuItem* createIndexSubmenuItem(std::string text, std::vector<std::string> labels, std::function<size_t()> getter,
+                                     std::function<void(size_t val)> setter, bool disabled = false,
+                                     bool alwaysConsume = false);
+template <typename T>
+ui::MenuItem* createIndexPtrSubmenuItem(std::string text, std::vector<std::string> labels, T* ptr) {
+    return createMenuItem(text);
+}
+
+} // namespace rack
@@ -0,0 +1,242 @@
+#if !defined(QUANTAL_TOOLS_JSON_H)
+#define QUANTAL_TOOLS_JSON_H 1
+
+#include <cstdlib>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * Small JSON reader for the tools' config files, so they build without
+ * Rack's copy of jansson
+ *
+ * Parse errors throw std::runtime_error with the offset of the problem.
+ */
+struct JsonValue {
+    enum Type {
+        NUL,
+        BOOLEAN,
+        NUMBER,
+        STRING,
+        ARRAY,
+        OBJECT
+    };
+
+    Type type = NUL;
+    bool boolean = false;
+    double number = 0.0;
+    // Whether the number was written without a fraction or exponent
+    bool integer = false;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::map<std::string, JsonValue> object;
+
+    bool isNumber() const {
+        return type == NUMBER;
+    }
+    bool isArray() const {
+        return type == ARRAY;
+    }
+    bool isObject() const {
+        return type == OBJECT;
+    }
+
+    /**
+     * Member `key` of an object, or null if this isn't an object or has no
+     * such member
+     */
+    const JsonValue* get(const std::string &key) const {
+        if (type != OBJECT) {
+            return nullptr;
+        }
+        auto it = object.find(key);
+        return it == object.end() ? nullptr : &it->second;
+    }
+
+    double getNumber(const std::string &key, double fallback) const {
+        const JsonValue* v = get(key);
+        return (v && v->type == NUMBER) ? v->number : fallback;
+    }
+
+    bool getBool(const std::string &key, bool fallback) const {
+        const JsonValue* v = get(key);
+        return (v && v->type == BOOLEAN) ? v->boolean : fallback;
+    }
+
+    std::string getString(const std::string &key, const std::string &fallback) const {
+        const JsonValue* v = get(key);
+        return (v && v->type == STRING) ? v->string : fallback;
+    }
+
+    static JsonValue parse(const std::string &text) {
+        size_t pos = 0;
+        JsonValue value = parseValue(text, pos);
+        skipSpace(text, pos);
+        if (pos != text.size()) {
+            fail("unexpected trailing characters", pos);
+        }
+        return value;
+    }
+
+private:
+
+    static void fail(const char* message, size_t pos) {
+        throw std::runtime_error(std::string(message) + " at offset " + std::to_string(pos));
+    }
+
+    static void skipSpace(const std::string &text, size_t &pos) {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n' || text[pos] == '\r')) {
+            pos++;
+        }
+    }
+
+    static bool consume(const std::string &text, size_t &pos, const char* word) {
+        const std::string w(word);
+        if (text.compare(pos, w.size(), w) == 0) {
+            pos += w.size();
+            return true;
+        }
+        return false;
+    }
+
+    static std::string parseString(const std::string &text, size_t &pos) {
+        // Opening quote already checked by the caller
+        pos++;
+        std::string out;
+        while (pos < text.size() && text[pos] != '"') {
+            char c = text[pos++];
+            if (c == '\\') {
+                if (pos >= text.size()) {
+                    break;
+                }
+                c = text[pos++];
+                switch (c) {
+                    case 'n':
+                        out += '\n';
+                        break;
+                    case 't':
+                        out += '\t';
+                        break;
+                    case 'r':
+                        out += '\r';
+                        break;
+                    case 'b':
+                        out += '\b';
+                        break;
+                    case 'f':
+                        out += '\f';
+                        break;
+                    case 'u': {
+                        // Only code points below 0x80 are needed for paths and names
+                        const unsigned long code = std::strtoul(text.substr(pos, 4).c_str(), nullptr, 16);
+                        out += code < 0x80 ? static_cast<char>(code) : '?';
+                        pos += 4;
+                        break;
+                    }
+                    default:
+                        out += c;
+                }
+            } else {
+                out += c;
+            }
+        }
+        if (pos >= text.size()) {
+            fail("unterminated string", pos);
+        }
+        pos++;
+        return out;
+    }
+
+    static JsonValue parseValue(const std::string &text, size_t &pos) {
+        skipSpace(text, pos);
+        if (pos >= text.size()) {
+            fail("unexpected end of input", pos);
+        }
+
+        JsonValue v;
+        const char c = text[pos];
+        if (c == '{') {
+            v.type = OBJECT;
+            pos++;
+            skipSpace(text, pos);
+            if (pos < text.size() && text[pos] == '}') {
+                pos++;
+                return v;
+            }
+            while (true) {
+                skipSpace(text, pos);
+                if (pos >= text.size() || text[pos] != '"') {
+                    fail("expected a member name", pos);
+                }
+                const std::string key = parseString(text, pos);
+                skipSpace(text, pos);
+                if (pos >= text.size() || text[pos] != ':') {
+                    fail("expected ':'", pos);
+                }
+                pos++;
+                v.object[key] = parseValue(text, pos);
+                skipSpace(text, pos);
+                if (pos < text.size() && text[pos] == ',') {
+                    pos++;
+                } else if (pos < text.size() && text[pos] == '}') {
+                    pos++;
+                    return v;
+                } else {
+                    fail("expected ',' or '}'", pos);
+                }
+            }
+        }
+        if (c == '[') {
+            v.type = ARRAY;
+            pos++;
+            skipSpace(text, pos);
+            if (pos < text.size() && text[pos] == ']') {
+                pos++;
+                return v;
+            }
+            while (true) {
+                v.array.push_back(parseValue(text, pos));
+                skipSpace(text, pos);
+                if (pos < text.size() && text[pos] == ',') {
+                    pos++;
+                } else if (pos < text.size() && text[pos] == ']') {
+                    pos++;
+                    return v;
+                } else {
+                    fail("expected ',' or ']'", pos);
+                }
+            }
+        }
+        if (c == '"') {
+            v.type = STRING;
+            v.string = parseString(text, pos);
+            return v;
+        }
+        if (consume(text, pos, "true")) {
+            v.type = BOOLEAN;
+            v.boolean = true;
+            return v;
+        }
+        if (consume(text, pos, "false")) {
+            v.type = BOOLEAN;
+            return v;
+        }
+        if (consume(text, pos, "null")) {
+            return v;
+        }
+
+        const char* start = text.c_str() + pos;
+        char* end = nullptr;
+        v.number = std::strtod(start, &end);
+        if (end == start) {
+            fail("unexpected character", pos);
+        }
+        v.type = NUMBER;
+        v.integer = std::string(start, end - start).find_first_of(".eE") == std::string::npos;
+        pos += end - start;
+        return v;
+    }
+};
+
+#endif
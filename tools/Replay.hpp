@@ -0,0 +1,185 @@
+#if !defined(QUANTAL_TOOLS_REPLAY_H)
+#define QUANTAL_TOOLS_REPLAY_H 1
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "QuantalAudio.hpp"
+#include "core/Recording.hpp"
+#include "Json.hpp"
+
+/**
+ * Build the json_t for a module's dataFromJson() from the recorded text
+ */
+inline json_t* toJansson(const JsonValue &v) {
+    switch (v.type) {
+        case JsonValue::BOOLEAN:
+            return json_boolean(v.boolean);
+        case JsonValue::NUMBER:
+            return v.integer ? json_integer(static_cast<long long>(v.number)) : json_real(v.number);
+        case JsonValue::STRING:
+            return json_string(v.string.c_str());
+        case JsonValue::ARRAY: {
+            json_t* arrayJ = json_array();
+            for (const JsonValue &item : v.array) {
+                json_array_append_new(arrayJ, toJansson(item));
+            }
+            return arrayJ;
+        }
+        case JsonValue::OBJECT: {
+            json_t* objectJ = json_object();
+            for (const auto &member : v.object) {
+                json_object_set_new(objectJ, member.first.c_str(), toJansson(member.second));
+            }
+            return objectJ;
+        }
+        default:
+            return json_null();
+    }
+}
+
+struct ReplayModule {
+    Module* module;
+    quantal::RecordedModule info;
+    // Time spent in process(), for --per-module
+    double seconds = 0.0;
+};
+
+/**
+ * The modules of a workload recording, set up side by side as they were
+ * when recording started, for `quantal-replay` and the tests
+ *
+ * The modules are looked up by slug among those registered with the stub's
+ * createModel(), so the module sources must be compiled in.
+ */
+struct Replay {
+    float sampleRate = 0.f;
+    std::vector<ReplayModule> modules;
+    // Offset of the first frame in the recording
+    size_t firstFrame = 0;
+
+    Replay() {}
+    Replay(const Replay &) = delete;
+    Replay &operator=(const Replay &) = delete;
+
+    ~Replay() {
+        for (ReplayModule &m : modules) {
+            delete m.module;
+        }
+    }
+
+    /**
+     * Create the modules listed in the header of `bytes` and set the
+     * engine to the recorded sample rate. Returns false with `error` set if
+     * the recording can't be replayed.
+     */
+    bool load(const std::string &bytes, std::string &error) {
+        quantal::ByteReader header(reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size());
+        std::vector<quantal::RecordedModule> infos;
+        if (!quantal::readRecordingHeader(header, sampleRate, infos) || infos.empty()) {
+            error = "not a workload recording";
+            return false;
+        }
+        firstFrame = header.pos;
+        APP->engine->sampleRate = sampleRate;
+
+        for (const quantal::RecordedModule &info : infos) {
+            Model* model = plugin::getModel("QuantalAudio", info.slug);
+            if (!model) {
+                error = "unknown module " + info.slug;
+                return false;
+            }
+            ReplayModule m;
+            m.module = model->createModule();
+            m.module->id = modules.size() + 1;
+            m.info = info;
+            modules.push_back(m);
+            for (size_t p = 0; p < info.params.size() && p < m.module->params.size(); p++) {
+                m.module->params[p].setValue(info.params[p]);
+            }
+            for (size_t o = 0; o < info.outputsConnected.size() && o < m.module->outputs.size(); o++) {
+                m.module->outputs[o].channels = info.outputsConnected[o] ? 1 : 0;
+            }
+            if (!info.data.empty()) {
+                try {
+                    json_t* dataJ = toJansson(JsonValue::parse(info.data));
+                    m.module->dataFromJson(dataJ);
+                    json_decref(dataJ);
+                } catch (const std::exception &e) {
+                    error = "bad data for " + info.slug + ": " + e.what();
+                    return false;
+                }
+            }
+        }
+
+        // Side by side, left to right, as recorded
+        for (size_t i = 0; i < modules.size(); i++) {
+            Module* left = (i > 0) ? modules[i - 1].module : nullptr;
+            Module* right = (i + 1 < modules.size()) ? modules[i + 1].module : nullptr;
+            modules[i].module->leftExpander.module = left;
+            modules[i].module->leftExpander.moduleId = left ? left->id : -1;
+            modules[i].module->rightExpander.module = right;
+            modules[i].module->rightExpander.moduleId = right ? right->id : -1;
+        }
+        return true;
+    }
+
+    /**
+     * Apply the params and inputs of the frame at `r` to every module.
+     * Returns false at the end of the file.
+     */
+    bool readFrame(quantal::ByteReader &r) {
+        for (ReplayModule &m : modules) {
+            if (!readModuleFrame(r, m)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Pass on the expander messages, as the engine does after every frame
+     */
+    void flipMessages() {
+        for (ReplayModule &m : modules) {
+            flip(m.module->leftExpander);
+            flip(m.module->rightExpander);
+        }
+    }
+
+private:
+
+    static bool readModuleFrame(quantal::ByteReader &r, ReplayModule &m) {
+        const int changed = r.u8();
+        for (int i = 0; i < changed; i++) {
+            const int p = r.u8();
+            const float v = r.f32();
+            if (p < m.module->getNumParams()) {
+                m.module->params[p].setValue(v);
+            }
+        }
+        for (int j = 0; j < m.info.numInputs; j++) {
+            const int channels = std::min(static_cast<int>(r.u8()), 16);
+            if (!r.has(4 * channels)) {
+                return false;
+            }
+            Input &input = m.module->inputs[j];
+            input.channels = channels;
+            std::memcpy(input.voltages, r.data + r.pos, 4 * channels);
+            std::memset(input.voltages + channels, 0, 4 * (16 - channels));
+            r.pos += 4 * channels;
+        }
+        return !r.failed;
+    }
+
+    static void flip(Module::Expander &expander) {
+        if (expander.messageFlipRequested) {
+            std::swap(expander.producerMessage, expander.consumerMessage);
+            expander.messageFlipRequested = false;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,78 @@
+#if !defined(QUANTAL_TOOLS_WAV_H)
+#define QUANTAL_TOOLS_WAV_H 1
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/**
+ * Write interleaved samples in -1 to 1 to a WAV file
+ *
+ * `bits` is 16 or 24 for integer PCM, or 32 for 32-bit float. Returns false
+ * if the file can't be written.
+ */
+inline bool writeWav(const std::string &path, const std::vector<float> &samples, int channels, int sampleRate, int bits) {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+
+    const bool isFloat = (bits == 32);
+    const uint32_t bytesPerSample = bits / 8;
+    const uint32_t dataSize = static_cast<uint32_t>(samples.size()) * bytesPerSample;
+
+    std::vector<uint8_t> out;
+    out.reserve(44 + dataSize);
+    auto put16 = [&out](uint32_t v) {
+        out.push_back(v & 0xff);
+        out.push_back((v >> 8) & 0xff);
+    };
+    auto put32 = [&out](uint32_t v) {
+        for (int i = 0; i < 4; i++) {
+            out.push_back((v >> (8 * i)) & 0xff);
+        }
+    };
+    auto putTag = [&out](const char* tag) {
+        out.insert(out.end(), tag, tag + 4);
+    };
+
+    putTag("RIFF");
+    put32(36 + dataSize);
+    putTag("WAVE");
+    putTag("fmt ");
+    put32(16);
+    put16(isFloat ? 3 : 1);
+    put16(channels);
+    put32(sampleRate);
+    put32(sampleRate * channels * bytesPerSample);
+    put16(channels * bytesPerSample);
+    put16(bits);
+    putTag("data");
+    put32(dataSize);
+
+    for (float x : samples) {
+        if (isFloat) {
+            uint32_t v;
+            std::memcpy(&v, &x, sizeof(v));
+            put32(v);
+            continue;
+        }
+        x = std::fmin(std::fmax(x, -1.f), 1.f);
+        if (bits == 16) {
+            put16(static_cast<uint32_t>(static_cast<int32_t>(std::lrint(x * 32767.f))));
+        } else {
+            const uint32_t v = static_cast<uint32_t>(static_cast<int32_t>(std::lrint(x * 8388607.f)));
+            out.push_back(v & 0xff);
+            out.push_back((v >> 8) & 0xff);
+            out.push_back((v >> 16) & 0xff);
+        }
+    }
+
+    const bool ok = std::fwrite(out.data(), 1, out.size(), file) == out.size();
+    return std::fclose(file) == 0 && ok;
+}
+
+#endif
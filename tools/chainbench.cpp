@@ -0,0 +1,219 @@
+/**
+ * quantal-chain-bench: time a Daisy chain run on several threads the way
+ * Rack's engine runs it
+ *
+ * Usage: quantal-chain-bench [strips] [threads]
+ *
+ * Each frame the threads take the chain's modules one at a time from a shared
+ * counter, so neighbours usually land on different threads, then wait at a
+ * barrier while the expander messages flip. That's where message buffers
+ * sharing a cache line cost the most: a strip writes its neighbour's
+ * producer message while the neighbour reads its consumer on another core.
+ *
+ * The chain runs twice at each thread count: with the modules' own buffers,
+ * each on cache lines of its own, and repointed at buffers packed together
+ * as the modules used to hold them. Thread counts double up to the CPUs, or
+ * up to `threads`, at most 8 by default.
+ */
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+// The modules are compiled into this file, like the tests
+#include "DaisyBlank.cpp"
+#include "DaisyBridge.cpp"
+#include "DaisyChannel.cpp"
+#include "DaisyChannel2.cpp"
+#include "DaisyChannelSends2.cpp"
+#include "DaisyChannelVu.cpp"
+#include "DaisyGroup.cpp"
+#include "DaisyMaster.cpp"
+#include "DaisyMaster2.cpp"
+
+#include "core/Denormals.hpp"
+
+Plugin* pluginInstance;
+
+using Clock = std::chrono::steady_clock;
+
+constexpr float SAMPLE_RATE = 48000.f;
+constexpr int FRAMES = 48000;
+constexpr int RUNS = 3;
+
+/**
+ * Barrier for the threads stepping a frame, spinning for a while before
+ * giving up the core like Rack's
+ */
+struct SpinBarrier {
+    explicit SpinBarrier(int total) : total(total) {}
+
+    void wait() {
+        const int generation = step.load();
+        if (++count == total) {
+            count = 0;
+            step++;
+            return;
+        }
+        for (int spins = 0; step.load() == generation; spins++) {
+            if (spins > 1000) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+private:
+
+    const int total;
+    std::atomic<int> count{0};
+    std::atomic<int> step{0};
+};
+
+/**
+ * A module's expander messages laid out as they were before they moved to
+ * ExpanderMessages: packed in the module next to each other
+ */
+struct PackedMessages {
+    float link_l;
+    DaisyMessage input[2];
+    DaisyReturnMessage output[2];
+};
+
+static void flip(Module::Expander &expander) {
+    if (expander.messageFlipRequested) {
+        std::swap(expander.producerMessage, expander.consumerMessage);
+        expander.messageFlipRequested = false;
+    }
+}
+
+/**
+ * Returns nanoseconds per frame of the chain on `threads` threads
+ */
+static double measure(std::vector<std::unique_ptr<Module>> &chain, int threads) {
+    Module::ProcessArgs args;
+    args.sampleRate = SAMPLE_RATE;
+    args.sampleTime = 1.f / SAMPLE_RATE;
+
+    SpinBarrier start(threads);
+    SpinBarrier done(threads);
+    std::atomic<int> next{0};
+    std::atomic<bool> stop{false};
+
+    auto stepModules = [&]() {
+        const int n = static_cast<int>(chain.size());
+        for (int i = next++; i < n; i = next++) {
+            chain[i]->process(args);
+        }
+    };
+    auto worker = [&]() {
+        quantal::ScopedFlushDenormals flush;
+        while (true) {
+            start.wait();
+            if (stop) {
+                return;
+            }
+            stepModules();
+            done.wait();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; t++) {
+        pool.emplace_back(worker);
+    }
+
+    quantal::ScopedFlushDenormals flush;
+    const Clock::time_point started = Clock::now();
+    for (int f = 0; f < FRAMES; f++) {
+        args.frame = f;
+        next = 0;
+        start.wait();
+        stepModules();
+        done.wait();
+        for (auto &m : chain) {
+            flip(m->leftExpander);
+            flip(m->rightExpander);
+        }
+    }
+    const double ns = std::chrono::duration<double, std::nano>(Clock::now() - started).count() / FRAMES;
+
+    stop = true;
+    start.wait();
+    for (std::thread &t : pool) {
+        t.join();
+    }
+    return ns;
+}
+
+int main(int argc, char** argv) {
+    const int cpus = static_cast<int>(std::thread::hardware_concurrency());
+    const int strips = (argc > 1) ? std::atoi(argv[1]) : 32;
+    const int maxThreads = (argc > 2) ? std::atoi(argv[2]) : std::max(1, std::min(8, cpus));
+    if (strips < 1 || maxThreads < 1) {
+        std::fprintf(stderr, "Usage: %s [strips] [threads]\n", argv[0]);
+        return 2;
+    }
+
+    initKernels();
+    APP->engine->sampleRate = SAMPLE_RATE;
+
+    // Strips of 16 channels, each with a VU meter, into a master
+    std::vector<std::unique_ptr<Module>> chain;
+    for (int i = 0; i < strips; i++) {
+        chain.emplace_back(modelDaisyChannel2->createModule());
+        chain.back()->inputs[DaisyChannel2::CH_INPUT_1].channels = 16;
+        for (int c = 0; c < 16; c++) {
+            chain.back()->inputs[DaisyChannel2::CH_INPUT_1].voltages[c] = 1.f + c * 0.25f;
+        }
+        chain.emplace_back(modelDaisyChannelVu->createModule());
+    }
+    chain.emplace_back(modelDaisyMaster2->createModule());
+    for (size_t i = 0; i < chain.size(); i++) {
+        chain[i]->leftExpander.module = (i > 0) ? chain[i - 1].get() : nullptr;
+        chain[i]->rightExpander.module = (i + 1 < chain.size()) ? chain[i + 1].get() : nullptr;
+    }
+
+    struct Buffers {
+        void* producer[2];
+        void* consumer[2];
+    };
+    std::vector<Buffers> aligned(chain.size());
+    for (size_t i = 0; i < chain.size(); i++) {
+        aligned[i] = {{chain[i]->leftExpander.producerMessage, chain[i]->rightExpander.producerMessage},
+            {chain[i]->leftExpander.consumerMessage, chain[i]->rightExpander.consumerMessage}
+        };
+    }
+    std::vector<PackedMessages> packed(chain.size());
+
+    std::printf("%d modules, %d CPUs\n", static_cast<int>(chain.size()), cpus);
+    std::printf("%-8s %14s %14s %9s\n", "threads", "packed ns", "aligned ns", "speedup");
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        double times[2] = {1e30, 1e30};
+        for (int run = 0; run < RUNS; run++) {
+            for (int layout = 0; layout < 2; layout++) {
+                for (size_t i = 0; i < chain.size(); i++) {
+                    Module::Expander &left = chain[i]->leftExpander;
+                    Module::Expander &right = chain[i]->rightExpander;
+                    if (layout == 0) {
+                        packed[i] = PackedMessages();
+                        left.producerMessage = &packed[i].input[0];
+                        left.consumerMessage = &packed[i].input[1];
+                        right.producerMessage = &packed[i].output[0];
+                        right.consumerMessage = &packed[i].output[1];
+                    } else {
+                        left.producerMessage = aligned[i].producer[0];
+                        left.consumerMessage = aligned[i].consumer[0];
+                        right.producerMessage = aligned[i].producer[1];
+                        right.consumerMessage = aligned[i].consumer[1];
+                    }
+                    left.messageFlipRequested = false;
+                    right.messageFlipRequested = false;
+                }
+                times[layout] = std::min(times[layout], measure(chain, threads));
+            }
+        }
+        std::printf("%-8d %14.1f %14.1f %8.2fx\n", threads, times[0], times[1], times[0] / times[1]);
+    }
+    return 0;
+}
@@ -0,0 +1,198 @@
+/**
+ * quantal-denormal-bench: check that nothing slows down when a loud signal
+ * goes silent
+ *
+ * Usage: quantal-denormal-bench
+ *
+ * Each case runs a loud burst, then several seconds of silence while state
+ * that decays towards zero passes through the denormal range. It compares
+ * the time per frame of the burst with the slowest quarter second of the
+ * silence, with flush-to-zero off and on, keeping the best of a few runs.
+ * Rack's engine threads always run with it on; the core's own state must
+ * stay fast even with it off.
+ *
+ * Exits with 1 if a case that must stay fast slows down by more than half.
+ */
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+
+// The modules are compiled into this file, like the tests
+#include "DaisyBlank.cpp"
+#include "DaisyBridge.cpp"
+#include "DaisyChannel.cpp"
+#include "DaisyChannel2.cpp"
+#include "DaisyChannelSends2.cpp"
+#include "DaisyChannelVu.cpp"
+#include "DaisyGroup.cpp"
+#include "DaisyMaster.cpp"
+#include "DaisyMaster2.cpp"
+#include "Horsehair.cpp"
+
+#include "core/Denormals.hpp"
+
+Plugin* pluginInstance;
+
+using Clock = std::chrono::steady_clock;
+
+constexpr float SAMPLE_RATE = 48000.f;
+constexpr int BURST_FRAMES = 24000;
+constexpr int SILENCE_FRAMES = 192000;
+constexpr int WINDOW_FRAMES = 12000;
+
+// Slowest the silence may run, relative to the burst
+constexpr double MAX_SLOWDOWN = 1.5;
+
+// Each case runs this many times, keeping the fastest, to ride out
+// scheduling noise
+constexpr int RUNS = 3;
+
+struct Case {
+    const char* name;
+    // Whether this case must stay fast without flush-to-zero
+    bool guarded;
+    // Set up fresh state
+    std::function<void()> reset;
+    // Run one frame, with the inputs silent or not
+    std::function<void(bool loud, std::mt19937 &rng)> frame;
+};
+
+static float noise(std::mt19937 &rng) {
+    return std::uniform_real_distribution<float>(-5.f, 5.f)(rng);
+}
+
+/**
+ * Returns nanoseconds per frame of the burst and of the slowest window of
+ * silence
+ */
+static std::pair<double, double> measure(Case &c) {
+    std::mt19937 rng(1);
+    c.reset();
+
+    Clock::time_point start = Clock::now();
+    for (int f = 0; f < BURST_FRAMES; f++) {
+        c.frame(true, rng);
+    }
+    const double loud = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / BURST_FRAMES;
+
+    double silent = 0.0;
+    for (int w = 0; w < SILENCE_FRAMES / WINDOW_FRAMES; w++) {
+        start = Clock::now();
+        for (int f = 0; f < WINDOW_FRAMES; f++) {
+            c.frame(false, rng);
+        }
+        silent = std::max(silent, std::chrono::duration<double, std::nano>(Clock::now() - start).count() / WINDOW_FRAMES);
+    }
+    return std::make_pair(loud, silent);
+}
+
+static void flip(Module::Expander &expander) {
+    if (expander.messageFlipRequested) {
+        std::swap(expander.producerMessage, expander.consumerMessage);
+        expander.messageFlipRequested = false;
+    }
+}
+
+int main() {
+    initKernels();
+    APP->engine->sampleRate = SAMPLE_RATE;
+    Module::ProcessArgs args;
+    args.sampleRate = SAMPLE_RATE;
+    args.sampleTime = 1.f / SAMPLE_RATE;
+    args.frame = 0;
+
+    std::vector<Case> cases;
+
+    // Horsehair's square wave highpass, fed silence directly
+    std::vector<quantal::RCFilter<float4>> filters(64);
+    cases.push_back({"RC highpass", true, [&]() {
+        for (auto &filter : filters) {
+            filter = quantal::RCFilter<float4>();
+            filter.setCutoffFreq(20.f / SAMPLE_RATE);
+        }
+    }, [&](bool loud, std::mt19937 & rng) {
+        const float4 x = loud ? float4(noise(rng)) : float4(0.f);
+        for (auto &filter : filters) {
+            filter.process(x);
+        }
+    }
+                    });
+
+    // 16 voices with loud FM and sync, then none
+    std::unique_ptr<Module> horsehair;
+    cases.push_back({"Horsehair", true, [&]() {
+        horsehair.reset(modelHorsehair->createModule());
+        Horsehair* h = static_cast<Horsehair*>(horsehair.get());
+        h->inputs[Horsehair::PITCH_INPUT].channels = 16;
+        h->inputs[Horsehair::FM_INPUT].channels = 16;
+        h->inputs[Horsehair::SYNC_INPUT].channels = 16;
+        h->outputs[Horsehair::MIX_OUTPUT].channels = 16;
+        h->outputs[Horsehair::SIN_OUTPUT].channels = 16;
+    }, [&](bool loud, std::mt19937 & rng) {
+        for (int c = 0; c < 16; c++) {
+            horsehair->inputs[Horsehair::FM_INPUT].voltages[c] = loud ? noise(rng) : 0.f;
+            horsehair->inputs[Horsehair::SYNC_INPUT].voltages[c] = loud ? noise(rng) : 0.f;
+        }
+        horsehair->process(args);
+    }
+                    });
+
+    // 8 strips of 16 channels with VU meters into a master
+    std::vector<std::unique_ptr<Module>> chain;
+    cases.push_back({"Daisy chain with VU", false, [&]() {
+        chain.clear();
+        for (int i = 0; i < 8; i++) {
+            chain.emplace_back(modelDaisyChannel2->createModule());
+            chain.back()->inputs[DaisyChannel2::CH_INPUT_1].channels = 16;
+            chain.emplace_back(modelDaisyChannelVu->createModule());
+        }
+        chain.emplace_back(modelDaisyMaster2->createModule());
+        for (size_t i = 0; i < chain.size(); i++) {
+            chain[i]->leftExpander.module = (i > 0) ? chain[i - 1].get() : nullptr;
+            chain[i]->rightExpander.module = (i + 1 < chain.size()) ? chain[i + 1].get() : nullptr;
+        }
+    }, [&](bool loud, std::mt19937 & rng) {
+        for (size_t i = 0; i < chain.size(); i += 2) {
+            if (chain[i]->model == modelDaisyChannel2) {
+                for (int c = 0; c < 16; c++) {
+                    chain[i]->inputs[DaisyChannel2::CH_INPUT_1].voltages[c] = loud ? noise(rng) : 0.f;
+                }
+            }
+        }
+        for (auto &m : chain) {
+            m->process(args);
+        }
+        for (auto &m : chain) {
+            flip(m->leftExpander);
+            flip(m->rightExpander);
+        }
+    }
+                    });
+
+    bool ok = true;
+    std::printf("%-22s %-6s %12s %12s %9s\n", "case", "FTZ", "loud ns", "silent ns", "slowdown");
+    for (int ftz = 0; ftz < 2; ftz++) {
+        for (Case &c : cases) {
+            std::pair<double, double> times(1e30, 1e30);
+            for (int run = 0; run < RUNS; run++) {
+                std::pair<double, double> t;
+                if (ftz) {
+                    quantal::ScopedFlushDenormals flush;
+                    t = measure(c);
+                } else {
+                    t = measure(c);
+                }
+                times.first = std::min(times.first, t.first);
+                times.second = std::min(times.second, t.second);
+            }
+            const double slowdown = times.second / times.first;
+            const bool mustStayFast = ftz || c.guarded;
+            const bool pass = !mustStayFast || slowdown <= MAX_SLOWDOWN;
+            ok = ok && pass;
+            std::printf("%-22s %-6s %12.1f %12.1f %8.2fx%s\n", c.name, ftz ? "on" : "off", times.first, times.second,
+                        slowdown, pass ? "" : "  FAIL");
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,289 @@
+/**
+ * quantal-minblep-bench: time Horsehair's MinBLEP discontinuity insertion
+ * against the ways it was done before, across pitch ranges
+ *
+ * Usage: quantal-minblep-bench [samples]
+ *
+ * 16 voices in 4 groups run a square and a saw phase the way Horsehair's
+ * oscillator does, inserting a discontinuity for every lane that wraps,
+ * crosses the pulse width or crosses half a cycle, and reading one sample
+ * back from each generator per frame. The higher the pitch, the more
+ * crossings there are per frame. Each generator runs the same voices:
+ *
+ * - per lane: one pass over the buffer for each crossing lane, as
+ *   dsp::MinBlepGenerator does and Horsehair did at first
+ * - gather: one pass for all crossing lanes, looking the impulse up for
+ *   each lane at every buffer position
+ * - interleaved: one pass for all crossing lanes over a buffer that keeps
+ *   the lanes of a sample together, reading the transposed impulse rows, so
+ *   a sample is read back as one vector
+ * - current: quantal::BatchMinBlepGenerator, as Horsehair runs it, with a
+ *   buffer and one contiguous run per crossing lane
+ *
+ * Times are the best of a few runs, in nanoseconds per frame of all 16
+ * voices. The output of each generator is checked against the per-lane one.
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "core/Denormals.hpp"
+#include "core/Oscillator.hpp"
+
+using quantal::float4;
+
+using Clock = std::chrono::steady_clock;
+
+constexpr float SAMPLE_RATE = 48000.f;
+constexpr int RUNS = 5;
+constexpr int GROUPS = 4;
+// Horsehair's MinBLEP size: 16 zero crossings, 16 times oversampled
+constexpr int Z = 16;
+constexpr int O = 16;
+
+/**
+ * Rack's MinBLEP step table, 2 * Z * O + 1 samples with the last one 1,
+ * shared by the older generators below
+ */
+static const float* getImpulse() {
+    struct Impulse {
+        float table[2 * Z * O + 1];
+        Impulse() {
+            quantal::minBlepImpulse(Z, O, table);
+            table[2 * Z * O] = 1.f;
+        }
+    };
+    static const Impulse impulse;
+    return impulse.table;
+}
+
+/**
+ * One pass over the whole buffer per crossing lane, with the other lanes
+ * masked to zero, as dsp::MinBlepGenerator::insertDiscontinuity()
+ */
+struct PerLaneMinBlep {
+    float4 buf[2 * Z] = {};
+    int pos = 0;
+    const float* impulse = getImpulse();
+
+    void insertDiscontinuities(float4 p, float4 x, int mask) {
+        for (int i = 0; i < 4; i++) {
+            if (mask & (1 << i)) {
+                insertDiscontinuity(p[i], quantal::movemaskInverse(1 << i) & x);
+            }
+        }
+    }
+
+    void insertDiscontinuity(float p, float4 x) {
+        if (!(-1 < p && p <= 0)) {
+            return;
+        }
+        for (int j = 0; j < 2 * Z; j++) {
+            const float minBlepIndex = (static_cast<float>(j) - p) * O;
+            const int index = static_cast<int>(minBlepIndex);
+            const float frac = minBlepIndex - index;
+            const float v = impulse[index] + frac * (impulse[index + 1] - impulse[index]);
+            buf[(pos + j) % (2 * Z)] += x * (v - 1.f);
+        }
+    }
+
+    float4 process() {
+        const float4 v = buf[pos];
+        buf[pos] = 0.f;
+        pos = (pos + 1) % (2 * Z);
+        return v;
+    }
+};
+
+/**
+ * One pass over the buffer for all crossing lanes, gathering each lane's
+ * impulse values from the shared table at every position
+ */
+struct GatherMinBlep {
+    float4 buf[2 * Z] = {};
+    int pos = 0;
+    const float* impulse = getImpulse();
+
+    void insertDiscontinuities(float4 p, float4 x, int mask) {
+        int offset[4] = {};
+        float4 frac = 0.f;
+        for (int i = 0; i < 4; i++) {
+            if (mask & (1 << i)) {
+                const float minBlepIndex = -p[i] * O;
+                offset[i] = std::max(0, std::min(static_cast<int>(minBlepIndex), O - 1));
+                frac[i] = minBlepIndex - offset[i];
+            }
+        }
+        x = quantal::movemaskInverse(mask) & x;
+
+        for (int j = 0; j < 2 * Z; j++) {
+            float4 a;
+            float4 b;
+            for (int i = 0; i < 4; i++) {
+                a[i] = impulse[j * O + offset[i]];
+                b[i] = impulse[j * O + offset[i] + 1];
+            }
+            int index = pos + j;
+            if (index >= 2 * Z) {
+                index -= 2 * Z;
+            }
+            buf[index] += x * (a + frac * (b - a) - 1.f);
+        }
+    }
+
+    float4 process() {
+        const float4 v = buf[pos];
+        buf[pos] = 0.f;
+        pos = (pos + 1) % (2 * Z);
+        return v;
+    }
+};
+
+/**
+ * One pass for all crossing lanes over a buffer holding the 4 lanes of each
+ * sample together, reading the transposed impulse table
+ */
+struct InterleavedMinBlep {
+    float4 buf[2 * Z] = {};
+    int pos = 0;
+    const float* impulseRows = quantal::BatchMinBlepGenerator<Z, O, float4>::getImpulseRows();
+
+    void insertDiscontinuities(float4 p, float4 x, int mask) {
+        const float* rows[4] = {impulseRows, impulseRows, impulseRows, impulseRows};
+        float4 frac = 0.f;
+        for (int i = 0; i < 4; i++) {
+            if (mask & (1 << i)) {
+                const float minBlepIndex = -p[i] * O;
+                const int offset = std::max(0, std::min(static_cast<int>(minBlepIndex), O - 1));
+                rows[i] = &impulseRows[offset * 2 * Z];
+                frac[i] = minBlepIndex - offset;
+            }
+        }
+        x = quantal::movemaskInverse(mask) & x;
+        const float4 wa = x * (1.f - frac);
+        const float4 wb = x * frac;
+
+        const int first = 2 * Z - pos;
+        for (int j = 0; j < 2 * Z; j++) {
+            const float4 a(rows[0][j], rows[1][j], rows[2][j], rows[3][j]);
+            const float4 b(rows[0][j + 2 * Z], rows[1][j + 2 * Z], rows[2][j + 2 * Z], rows[3][j + 2 * Z]);
+            buf[j < first ? pos + j : j - first] += wa * a + wb * b - x;
+        }
+    }
+
+    float4 process() {
+        const float4 v = buf[pos];
+        buf[pos] = 0.f;
+        pos = (pos + 1) % (2 * Z);
+        return v;
+    }
+};
+
+/**
+ * Square and saw phases of 4 voices, band-limited by `Generator`
+ */
+template <typename Generator>
+struct Voices {
+    float4 phase = 0.f;
+    float4 freq = 0.f;
+    float4 pulseWidth = 0.3f;
+    Generator sqr;
+    Generator saw;
+
+    float4 process(float deltaTime) {
+        const float4 deltaPhase = quantal::clamp(freq * deltaTime, 1e-6f, 0.35f);
+        phase += deltaPhase;
+        phase -= quantal::floor(phase);
+
+        const float4 wrapCrossing = (0.f - (phase - deltaPhase)) / deltaPhase;
+        const int wrapMask = quantal::movemask((0.f < wrapCrossing) & (wrapCrossing <= 1.f));
+        if (wrapMask) {
+            sqr.insertDiscontinuities(wrapCrossing - 1.f, 2.f, wrapMask);
+        }
+        const float4 pulseCrossing = (pulseWidth - (phase - deltaPhase)) / deltaPhase;
+        const int pulseMask = quantal::movemask((0.f < pulseCrossing) & (pulseCrossing <= 1.f));
+        if (pulseMask) {
+            sqr.insertDiscontinuities(pulseCrossing - 1.f, -2.f, pulseMask);
+        }
+        const float4 halfCrossing = (0.5f - (phase - deltaPhase)) / deltaPhase;
+        const int halfMask = quantal::movemask((0.f < halfCrossing) & (halfCrossing <= 1.f));
+        if (halfMask) {
+            saw.insertDiscontinuities(halfCrossing - 1.f, -2.f, halfMask);
+        }
+
+        return sqr.process() + saw.process();
+    }
+};
+
+/**
+ * Run 16 voices around `pitch` for `samples` frames, keeping their output
+ * in `out`. Returns nanoseconds per frame.
+ */
+template <typename Generator>
+static double run(float pitch, int samples, std::vector<float> &out) {
+    std::vector<Voices<Generator>> groups(GROUPS);
+    for (int g = 0; g < GROUPS; g++) {
+        for (int i = 0; i < 4; i++) {
+            // Spread the voices a little so they cross at different times
+            const float voice = 4 * g + i;
+            groups[g].freq[i] = quantal::FREQ_C4 * std::exp2(pitch + voice * 0.07f);
+            groups[g].phase[i] = voice / 16.f;
+        }
+    }
+
+    out.resize(static_cast<size_t>(samples) * 4 * GROUPS);
+    const float deltaTime = 1.f / SAMPLE_RATE;
+    float* o = out.data();
+    const Clock::time_point start = Clock::now();
+    for (int s = 0; s < samples; s++) {
+        for (Voices<Generator> &voices : groups) {
+            voices.process(deltaTime).store(o);
+            o += 4;
+        }
+    }
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / samples;
+}
+
+template <typename Generator>
+static double best(float pitch, int samples, std::vector<float> &out) {
+    double ns = 1e30;
+    for (int r = 0; r < RUNS; r++) {
+        ns = std::min(ns, run<Generator>(pitch, samples, out));
+    }
+    return ns;
+}
+
+static float maxDifference(const std::vector<float> &a, const std::vector<float> &b) {
+    float most = 0.f;
+    for (size_t i = 0; i < a.size(); i++) {
+        most = std::max(most, std::abs(a[i] - b[i]));
+    }
+    return most;
+}
+
+int main(int argc, char** argv) {
+    const int samples = (argc > 1) ? std::atoi(argv[1]) : 100000;
+    if (samples < 1) {
+        std::fprintf(stderr, "Usage: %s [samples]\n", argv[0]);
+        return 2;
+    }
+
+    quantal::ScopedFlushDenormals flush;
+
+    std::printf("16 voices, %d samples, best of %d, ns per frame\n", samples, RUNS);
+    std::printf("%-7s %12s %12s %12s %12s %12s\n", "pitch", "per lane", "gather", "interleaved", "current", "max diff");
+    std::vector<float> reference;
+    std::vector<float> out;
+    for (float pitch : {-3.f, 0.f, 2.f, 4.f, 6.f}) {
+        const double perLane = best<PerLaneMinBlep>(pitch, samples, reference);
+        const double gather = best<GatherMinBlep>(pitch, samples, out);
+        float diff = maxDifference(reference, out);
+        const double interleaved = best<InterleavedMinBlep>(pitch, samples, out);
+        diff = std::max(diff, maxDifference(reference, out));
+        const double current = best<quantal::BatchMinBlepGenerator<Z, O, float4>>(pitch, samples, out);
+        diff = std::max(diff, maxDifference(reference, out));
+        std::printf("%+5.0fV %12.1f %12.1f %12.1f %12.1f %12.1e\n", pitch, perLane, gather, interleaved, current, diff);
+    }
+    return 0;
+}
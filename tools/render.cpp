@@ -0,0 +1,397 @@
+/**
+ * quantal-render: render Horsehair voices and Daisy Mix chains described in a
+ * JSON file to WAV, as fast as the CPU allows
+ *
+ * Usage: quantal-render <graph.json>
+ *
+ * Voices are rendered first, one worker per voice, then every chain mixes the
+ * voices on its strips, one worker per chain. See the README for the file
+ * format.
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <thread>
+
+#include "core/Denormals.hpp"
+#include "core/HorsehairVoice.hpp"
+#include "core/Mixing.hpp"
+#include "Json.hpp"
+#include "Wav.hpp"
+
+// Rack's audio interface plays +/-10V at full scale
+constexpr float VOLTS_TO_SAMPLE = 0.1f;
+
+struct PitchStep {
+    // Seconds from the start of the render
+    double time;
+    // V/oct
+    float pitch;
+};
+
+struct Voice {
+    std::string name;
+    // Pitch CV over time, sorted by time
+    std::vector<PitchStep> pitch;
+    quantal::HorsehairSettings settings;
+    int unison = 1;
+    float unisonDetune = 0.2f;
+    float unisonSpread = 0.5f;
+    bool unisonStereo = false;
+    // Take the sine output instead of the oscillator mix (unison off only)
+    bool sine = false;
+    // Seed for the unison copies' starting phases, so renders repeat exactly
+    unsigned seed = 0;
+    // WAV file for this voice alone, if any
+    std::string output;
+
+    // Rendered output, in volts
+    std::vector<float> left;
+    std::vector<float> right;
+};
+
+struct Strip {
+    int voice = 0;
+    float level = 1.f;
+    float pan = 0.f;
+    bool mute = false;
+};
+
+struct Chain {
+    std::string output;
+    // D-MX2 mix level
+    float level = 1.f;
+    std::vector<Strip> strips;
+
+    // Rendered output of the D-MX2, in volts
+    std::vector<float> left;
+    std::vector<float> right;
+};
+
+struct Graph {
+    int sampleRate = 48000;
+    int frames = 0;
+    int blockSize = 256;
+    int bits = 24;
+    int threads = 0;
+    float gain = 1.f;
+    std::vector<Voice> voices;
+    std::vector<Chain> chains;
+};
+
+/**
+ * Read a Horsehair voice, taking its knob values from "params" and its
+ * context menu settings from "data" (as saved in a patch)
+ */
+static Voice readVoice(const JsonValue &v, int index) {
+    Voice voice;
+    voice.name = v.getString("name", "voice" + std::to_string(index + 1));
+    voice.output = v.getString("output", "");
+    voice.seed = static_cast<unsigned>(v.getNumber("seed", index));
+    voice.sine = v.getString("jack", "mix") == "sine";
+
+    const JsonValue* pitchJ = v.get("pitch");
+    if (pitchJ && pitchJ->isArray()) {
+        for (const JsonValue &step : pitchJ->array) {
+            if (step.isArray() && step.array.size() == 2) {
+                voice.pitch.push_back({step.array[0].number, static_cast<float>(step.array[1].number)});
+            }
+        }
+        std::stable_sort(voice.pitch.begin(), voice.pitch.end(), [](const PitchStep & a, const PitchStep & b) {
+            return a.time < b.time;
+        });
+    }
+    if (voice.pitch.empty()) {
+        voice.pitch.push_back({0.0, static_cast<float>(v.getNumber("pitch", 0.0))});
+    }
+
+    quantal::HorsehairSettings &s = voice.settings;
+    const JsonValue empty;
+    const JsonValue* paramsJ = v.get("params");
+    const JsonValue &params = paramsJ ? *paramsJ : empty;
+    s.fine = params.getNumber("pitch", 0.0) / 4.0;
+    s.octave[0] = params.getNumber("octave_a", -2.0);
+    s.octave[1] = params.getNumber("octave_b", -1.0);
+    s.shape[0] = std::min(std::max(params.getNumber("shape_a", 0.0), 0.0), 1.0);
+    s.shape[1] = std::min(std::max(params.getNumber("shape_b", 1.0), 0.0), 1.0);
+    s.pw[0] = params.getNumber("pw_a", 0.5);
+    s.pw[1] = params.getNumber("pw_b", 0.5);
+    s.mix = params.getNumber("mix", 0.5);
+
+    const JsonValue* dataJ = v.get("data");
+    const JsonValue &data = dataJ ? *dataJ : empty;
+    const int unison = static_cast<int>(data.getNumber("unison", 1));
+    voice.unison = (unison == 2 || unison == 4 || unison == 8) ? unison : 1;
+    voice.unisonDetune = data.getNumber("unison_detune", 0.2);
+    voice.unisonSpread = data.getNumber("unison_spread", 0.5);
+    voice.unisonStereo = data.getBool("unison_stereo", false);
+    s.syncBToA = data.getBool("sync_b_to_a", false);
+    s.softSync = data.getBool("soft_sync", false);
+    s.fmAToBIndex = data.getNumber("fm_a_to_b", 0.0) * quantal::FM_A_TO_B_MAX_INDEX;
+    s.throughZeroFm = data.getBool("through_zero_fm", false);
+
+    return voice;
+}
+
+static Graph readGraph(const JsonValue &root) {
+    Graph graph;
+    graph.sampleRate = static_cast<int>(root.getNumber("sample_rate", 48000));
+    graph.frames = static_cast<int>(root.getNumber("length", 1.0) * graph.sampleRate);
+    graph.blockSize = std::max(16, static_cast<int>(root.getNumber("block_size", 256)));
+    graph.bits = static_cast<int>(root.getNumber("bits", 24));
+    graph.threads = static_cast<int>(root.getNumber("threads", 0));
+    graph.gain = root.getNumber("gain", 1.0);
+    if (graph.bits != 16 && graph.bits != 24 && graph.bits != 32) {
+        throw std::runtime_error("bits must be 16, 24 or 32");
+    }
+
+    const JsonValue* voicesJ = root.get("voices");
+    if (voicesJ && voicesJ->isArray()) {
+        for (size_t i = 0; i < voicesJ->array.size(); i++) {
+            graph.voices.push_back(readVoice(voicesJ->array[i], static_cast<int>(i)));
+        }
+    }
+
+    const JsonValue* chainsJ = root.get("chains");
+    if (chainsJ && chainsJ->isArray()) {
+        for (const JsonValue &c : chainsJ->array) {
+            Chain chain;
+            chain.output = c.getString("output", "");
+            chain.level = c.getNumber("level", 1.0);
+            const JsonValue* stripsJ = c.get("strips");
+            if (stripsJ && stripsJ->isArray()) {
+                for (const JsonValue &st : stripsJ->array) {
+                    Strip strip;
+                    const std::string name = st.getString("voice", "");
+                    auto it = std::find_if(graph.voices.begin(), graph.voices.end(), [&name](const Voice & v) {
+                        return v.name == name;
+                    });
+                    if (it == graph.voices.end()) {
+                        throw std::runtime_error("strip refers to unknown voice \"" + name + "\"");
+                    }
+                    strip.voice = static_cast<int>(it - graph.voices.begin());
+                    strip.level = st.getNumber("level", 1.0);
+                    strip.pan = st.getNumber("pan", 0.0);
+                    strip.mute = st.getBool("mute", false);
+                    chain.strips.push_back(strip);
+                }
+            }
+            if (chain.output.empty()) {
+                throw std::runtime_error("every chain needs an output file");
+            }
+            graph.chains.push_back(chain);
+        }
+    }
+
+    return graph;
+}
+
+/**
+ * Render a voice the way a Horsehair with one pitch channel would, block by
+ * block
+ *
+ * The voice is the MIX output, or the SIN output when its jack is "sine",
+ * on both sides. Unison copies take one lane each, spread over as many 4-lane
+ * groups as they need, and are summed with the module's unison gains; in
+ * stereo unison the left and right sides are the MIX and SIN outputs.
+ */
+static void renderVoice(Voice &voice, const Graph &graph) {
+    const int groupCount = (voice.unison + 3) / 4;
+    std::vector<quantal::HorsehairVoiceGroup> groups(groupCount);
+    quantal::HorsehairUnison lanes;
+    lanes.update(voice.unison, voice.unisonDetune, voice.unisonSpread);
+
+    if (voice.unison > 1) {
+        std::mt19937 rng(voice.seed);
+        std::uniform_real_distribution<float> uniform(0.f, 1.f);
+        for (quantal::HorsehairVoiceGroup &group : groups) {
+            for (int i = 0; i < 4; i++) {
+                group.oscillator.phase[i] = uniform(rng);
+                group.oscillator2.phase[i] = uniform(rng);
+            }
+        }
+    }
+
+    voice.left.assign(graph.frames, 0.f);
+    voice.right.assign(graph.frames, 0.f);
+
+    const float deltaTime = 1.f / graph.sampleRate;
+    std::vector<float> mixOut(4 * graph.blockSize);
+    std::vector<float> sinOut(4 * graph.blockSize);
+    size_t step = 0;
+
+    for (int start = 0; start < graph.frames;) {
+        // Run up to the end of the block or the next pitch change
+        while (step + 1 < voice.pitch.size() && voice.pitch[step + 1].time * graph.sampleRate <= start) {
+            step++;
+        }
+        int end = std::min(start + graph.blockSize, graph.frames);
+        if (step + 1 < voice.pitch.size()) {
+            end = std::min(end, std::max(start + 1, static_cast<int>(std::ceil(voice.pitch[step + 1].time * graph.sampleRate))));
+        }
+        const int frames = end - start;
+
+        for (int g = 0; g < groupCount; g++) {
+            const int groupChannels = std::min(voice.unison - 4 * g, 4);
+            quantal::HorsehairInputs in;
+            in.pitch = voice.pitch[step].pitch;
+            if (voice.unison > 1) {
+                in.pitch += quantal::float4::load(&lanes.detune[4 * g]);
+            }
+            groups[g].processBlock(voice.settings, deltaTime, groupChannels, in, mixOut.data(), sinOut.data(), frames);
+
+            for (int f = 0; f < frames; f++) {
+                for (int i = 0; i < groupChannels; i++) {
+                    const int lane = 4 * g + i;
+                    const float mix = mixOut[4 * f + i];
+                    const float sine = sinOut[4 * f + i];
+                    if (voice.unison == 1) {
+                        voice.left[start + f] = voice.sine ? sine : mix;
+                        voice.right[start + f] = voice.left[start + f];
+                    } else if (voice.unisonStereo) {
+                        voice.left[start + f] += mix * lanes.gainL[lane];
+                        voice.right[start + f] += mix * lanes.gainR[lane];
+                    } else {
+                        voice.left[start + f] += mix * lanes.gain[lane];
+                        voice.right[start + f] += mix * lanes.gain[lane];
+                    }
+                }
+            }
+        }
+        start = end;
+    }
+}
+
+/**
+ * Mix a chain the way DC2 strips feeding a D-MX2 would
+ *
+ * The strip and bus functions work on up to 16 channels at once, and every
+ * channel is independent, so 16 consecutive frames are passed as the 16
+ * channels. Like in Rack, each module adds one sample of latency on its way
+ * to the master.
+ */
+static void renderChain(Chain &chain, const std::vector<Voice> &voices, int totalFrames) {
+    chain.left.assign(totalFrames, 0.f);
+    chain.right.assign(totalFrames, 0.f);
+    const int stripCount = static_cast<int>(chain.strips.size());
+
+    for (int start = 0; start < totalFrames; start += 16) {
+        const int frames = std::min(16, totalFrames - start);
+        StereoVoltages bus;
+        bus.channels = frames;
+
+        for (int s = 0; s < stripCount; s++) {
+            const Strip &strip = chain.strips[s];
+            if (strip.mute) {
+                continue;
+            }
+            const Voice &voice = voices[strip.voice];
+            const int latency = stripCount - s;
+
+            StereoVoltages signals;
+            signals.channels = frames;
+            for (int f = 0; f < frames; f++) {
+                const int src = start + f - latency;
+                signals.voltages_l[f] = src >= 0 ? voice.left[src] : 0.f;
+                signals.voltages_r[f] = src >= 0 ? voice.right[src] : 0.f;
+            }
+            stripLevel(signals, strip.level, strip.pan, nullptr);
+            busSend(bus, bus, signals, 1.f / DAISY_DIVISOR, frames);
+        }
+
+        busOutput(bus, DAISY_DIVISOR, chain.level, nullptr);
+        std::copy_n(bus.voltages_l, frames, &chain.left[start]);
+        std::copy_n(bus.voltages_r, frames, &chain.right[start]);
+    }
+}
+
+/**
+ * Call `work(i)` for every `i` below `jobs`, on up to `threads` threads,
+ * each flushing denormals like Rack's engine threads
+ */
+template <typename F>
+static void runParallel(int jobs, int threads, F work) {
+    std::atomic<int> next{0};
+    auto worker = [&]() {
+        quantal::ScopedFlushDenormals flush;
+        for (int i = next++; i < jobs; i = next++) {
+            work(i);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < std::min(threads, jobs); t++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (std::thread &t : pool) {
+        t.join();
+    }
+}
+
+static bool writeStereo(const std::string &path, const std::vector<float> &left, const std::vector<float> &right, const Graph &graph) {
+    std::vector<float> samples(2 * left.size());
+    for (size_t f = 0; f < left.size(); f++) {
+        samples[2 * f] = left[f] * VOLTS_TO_SAMPLE * graph.gain;
+        samples[2 * f + 1] = right[f] * VOLTS_TO_SAMPLE * graph.gain;
+    }
+    return writeWav(path, samples, 2, graph.sampleRate, graph.bits);
+}
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        std::fprintf(stderr, "Usage: %s <graph.json>\n", argv[0]);
+        return 2;
+    }
+
+    Graph graph;
+    try {
+        std::ifstream file(argv[1]);
+        if (!file) {
+            throw std::runtime_error("can't open file");
+        }
+        std::stringstream text;
+        text << file.rdbuf();
+        graph = readGraph(JsonValue::parse(text.str()));
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "%s: %s\n", argv[1], e.what());
+        return 1;
+    }
+
+    initKernels();
+    const int threads = graph.threads > 0 ? graph.threads : std::max(1u, std::thread::hardware_concurrency());
+    const auto started = std::chrono::steady_clock::now();
+
+    runParallel(static_cast<int>(graph.voices.size()), threads, [&graph](int i) {
+        renderVoice(graph.voices[i], graph);
+    });
+
+    runParallel(static_cast<int>(graph.chains.size()), threads, [&graph](int i) {
+        renderChain(graph.chains[i], graph.voices, graph.frames);
+    });
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    int failed = 0;
+    for (const Voice &voice : graph.voices) {
+        if (!voice.output.empty() && !writeStereo(voice.output, voice.left, voice.right, graph)) {
+            std::fprintf(stderr, "Can't write %s\n", voice.output.c_str());
+            failed++;
+        }
+    }
+    for (const Chain &chain : graph.chains) {
+        if (!writeStereo(chain.output, chain.left, chain.right, graph)) {
+            std::fprintf(stderr, "Can't write %s\n", chain.output.c_str());
+            failed++;
+        }
+    }
+
+    const double audioSeconds = static_cast<double>(graph.frames) / graph.sampleRate;
+    std::printf("Rendered %zu voices and %zu chains of %.2f s in %.2f s (%.0fx realtime) on %d threads, %s kernels\n",
+                graph.voices.size(), graph.chains.size(), audioSeconds, seconds,
+                seconds > 0.0 ? audioSeconds / seconds : 0.0, threads, kernels->name);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,134 @@
+/**
+ * quantal-replay: run the modules in a workload recording on the recorded
+ * params and inputs, as fast as the CPU allows
+ *
+ * Usage: quantal-replay [--loops N] [--per-module] <recording.qrec>
+ *
+ * Recordings are made from the context menu of D-MX2 or Horsehair with
+ * Rack's developer mode on. The modules run against the Rack API stub in
+ * ../tests/stub, so the tool builds without the Rack SDK and can run under a
+ * profiler, e.g. `perf record build/quantal-replay FILE`.
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+// The modules are compiled into this file, like the tests; the stub's
+// createModel() registers them for lookup by slug
+#include "DaisyBlank.cpp"
+#include "DaisyBridge.cpp"
+#include "DaisyChannel.cpp"
+#include "DaisyChannel2.cpp"
+#include "DaisyChannelSends2.cpp"
+#include "DaisyChannelVu.cpp"
+#include "DaisyGroup.cpp"
+#include "DaisyMaster.cpp"
+#include "DaisyMaster2.cpp"
+#include "Horsehair.cpp"
+
+#include "core/Denormals.hpp"
+#include "Replay.hpp"
+
+Plugin* pluginInstance;
+
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char** argv) {
+    // Time the modules as Rack's engine threads run them
+    quantal::ScopedFlushDenormals flush;
+
+    int loops = 1;
+    bool perModule = false;
+    const char* path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--loops") == 0 && i + 1 < argc) {
+            loops = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--per-module") == 0) {
+            perModule = true;
+        } else {
+            path = argv[i];
+        }
+    }
+    if (!path) {
+        std::fprintf(stderr, "Usage: quantal-replay [--loops N] [--per-module] <recording.qrec>\n");
+        return 1;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::fprintf(stderr, "Can't open %s\n", path);
+        return 1;
+    }
+    std::stringstream contents;
+    contents << file.rdbuf();
+    const std::string bytes = contents.str();
+
+    initKernels();
+    Replay replay;
+    std::string error;
+    if (!replay.load(bytes, error)) {
+        std::fprintf(stderr, "%s: %s\n", path, error.c_str());
+        return 1;
+    }
+    const float sampleRate = replay.sampleRate;
+    std::vector<ReplayModule> &modules = replay.modules;
+
+    Module::ProcessArgs args;
+    args.sampleRate = sampleRate;
+    args.sampleTime = 1.f / sampleRate;
+    args.frame = 0;
+    int64_t frames = 0;
+    double processSeconds = 0.0;
+
+    for (int loop = 0; loop < loops; loop++) {
+        quantal::ByteReader r(reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size());
+        r.pos = replay.firstFrame;
+        while (r.pos < r.size && replay.readFrame(r)) {
+
+            const Clock::time_point start = Clock::now();
+            if (perModule) {
+                Clock::time_point last = start;
+                for (ReplayModule &m : modules) {
+                    m.module->process(args);
+                    const Clock::time_point now = Clock::now();
+                    m.seconds += std::chrono::duration<double>(now - last).count();
+                    last = now;
+                }
+            } else {
+                for (ReplayModule &m : modules) {
+                    m.module->process(args);
+                }
+            }
+            processSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+
+            replay.flipMessages();
+            args.frame++;
+            frames++;
+        }
+    }
+
+    const double audioSeconds = frames / sampleRate;
+    std::printf("%s: %d modules, %lld frames (%.2f s at %g Hz), kernels %s\n", path, static_cast<int>(modules.size()),
+                static_cast<long long>(frames), audioSeconds, sampleRate, kernels->name);
+    std::printf("process: %.3f s, %.1f ns/frame, %.1fx realtime\n", processSeconds,
+                frames ? 1e9 * processSeconds / frames : 0.0, processSeconds > 0.0 ? audioSeconds / processSeconds : 0.0);
+
+    if (perModule) {
+        // Totals by model, with the clock reads in between included
+        std::map<std::string, std::pair<int, double>> byModel;
+        for (const ReplayModule &m : modules) {
+            byModel[m.info.slug].first++;
+            byModel[m.info.slug].second += m.seconds;
+        }
+        for (const auto &entry : byModel) {
+            std::printf("  %-20s x%-4d %8.1f ns/frame\n", entry.first.c_str(), entry.second.first,
+                        frames ? 1e9 * entry.second.second / frames : 0.0);
+        }
+    }
+
+    return 0;
+}